@@ -0,0 +1,498 @@
+#include <myro.h>
+
+#include "audio/encoders/mp3_encoder.h"
+#include "audio/encoders/opus_encoder.h"
+#include "audio/encoders/speex_encoder.h"
+#include "audio/encoders/vorbis_encoder.h"
+
+#include <AL/al.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <numbers>
+#include <string>
+#include <vector>
+
+#ifndef MYRO_BENCH_VERSION
+#define MYRO_BENCH_VERSION "unknown"
+#endif
+
+namespace
+{
+	using bench_clock = std::chrono::steady_clock;
+
+	struct bench_options
+	{
+		std::filesystem::path output = "myro_bench.json";
+		std::filesystem::path work_dir = "myro_bench_data";
+		uint32_t seconds = 10;
+		uint32_t iterations = 5;
+		uint32_t chunk_frames = 1024;
+		uint32_t multi_load_copies = 4;
+	};
+
+	struct codec_case
+	{
+		const char* name;
+		const char* extension;
+		uint32_t sample_rate;
+		uint16_t channels;
+		std::shared_ptr<myro::IEncoder>(*create_encoder)();
+	};
+
+	const codec_case s_codecs[] =
+	{
+		{ "wav",    ".wav",  48000, 2, []() -> std::shared_ptr<myro::IEncoder> { return myro::wav_encoder::create(); } },
+		{ "flac",   ".flac", 48000, 2, []() -> std::shared_ptr<myro::IEncoder> { return myro::flac_encoder::create(); } },
+		{ "vorbis", ".ogg",  48000, 2, []() -> std::shared_ptr<myro::IEncoder> { return myro::vorbis_encoder::create(); } },
+		{ "mp3",    ".mp3",  48000, 2, []() -> std::shared_ptr<myro::IEncoder> { return myro::mp3_encoder::create(); } },
+		{ "opus",   ".opus", 48000, 2, []() -> std::shared_ptr<myro::IEncoder> { return myro::opus_encoder::create(); } },
+		{ "speex",  ".spx",  32000, 2, []() -> std::shared_ptr<myro::IEncoder> { return myro::speex_encoder::create(); } },
+	};
+
+	struct timing_summary
+	{
+		double min = 0.0;
+		double median = 0.0;
+		double mean = 0.0;
+	};
+
+	struct encode_result
+	{
+		std::string codec;
+		bool ok = false;
+		uint64_t input_bytes = 0;
+		uint64_t output_bytes = 0;
+		double duration = 0.0;
+		timing_summary seconds;
+	};
+
+	struct decode_result
+	{
+		std::string codec;
+		bool ok = false;
+		uint64_t file_bytes = 0;
+		uint64_t pcm_bytes = 0;
+		double duration = 0.0;
+		timing_summary seconds;
+		timing_summary upload_seconds;
+	};
+
+	struct scaling_result
+	{
+		uint32_t threads = 0;
+		size_t files = 0;
+		size_t loaded = 0;
+		timing_summary seconds;
+	};
+
+	double elapsed_seconds(bench_clock::time_point start)
+	{
+		return std::chrono::duration<double>(bench_clock::now() - start).count();
+	}
+
+	timing_summary summarize(std::vector<double> samples)
+	{
+		timing_summary result;
+		if (samples.empty())
+			return result;
+
+		std::ranges::sort(samples);
+		result.min = samples.front();
+		result.median = samples[samples.size() / 2];
+
+		double sum = 0.0;
+		for (double s : samples)
+			sum += s;
+		result.mean = sum / static_cast<double>(samples.size());
+		return result;
+	}
+
+	double mb_per_second(uint64_t bytes, double seconds)
+	{
+		return seconds > 0.0 ? (static_cast<double>(bytes) / (1024.0 * 1024.0)) / seconds : 0.0;
+	}
+
+	double x_realtime(double duration, double seconds)
+	{
+		return seconds > 0.0 ? duration / seconds : 0.0;
+	}
+
+	// Deterministic program material: an exponential sine sweep on the left channel,
+	// a two-tone chord on the right, both with a little LCG noise so lossless codecs
+	// cannot collapse the signal into trivially predictable frames.
+	std::vector<short> generate_signal(uint32_t sample_rate, uint16_t channels, uint32_t seconds)
+	{
+		const size_t frames = static_cast<size_t>(sample_rate) * seconds;
+		std::vector<short> pcm(frames * channels);
+
+		constexpr double two_pi = 2.0 * std::numbers::pi;
+		const double sweep_start = 40.0;
+		const double sweep_end = std::min(16000.0, sample_rate * 0.45);
+		const double sweep_ratio = std::log(sweep_end / sweep_start);
+		const double total = static_cast<double>(frames);
+
+		uint32_t lcg = 0x12345678u;
+		double sweep_phase = 0.0;
+
+		for (size_t i = 0; i < frames; ++i)
+		{
+			const double t = static_cast<double>(i) / sample_rate;
+			const double freq = sweep_start * std::exp(sweep_ratio * (static_cast<double>(i) / total));
+			sweep_phase += two_pi * freq / sample_rate;
+
+			lcg = lcg * 1664525u + 1013904223u;
+			const double noise = (static_cast<double>(lcg >> 8) / static_cast<double>(1u << 24) - 0.5) * 0.02;
+
+			const double left = 0.5 * std::sin(sweep_phase) + noise;
+			const double right = 0.3 * std::sin(two_pi * 440.0 * t) + 0.2 * std::sin(two_pi * 659.25 * t) + noise;
+
+			for (uint16_t c = 0; c < channels; ++c)
+			{
+				const double v = (c % 2 == 0) ? left : right;
+				pcm[i * channels + c] = static_cast<short>(std::clamp(v, -1.0, 1.0) * 32767.0);
+			}
+		}
+
+		return pcm;
+	}
+
+	std::filesystem::path signal_path(const bench_options& options, const codec_case& codec)
+	{
+		return options.work_dir / (std::string("signal_") + codec.name + codec.extension);
+	}
+
+	// Encodes into memory so the timings measure the codec, not the disk; the last run's bytes are
+	// written out afterwards for the decode pass.
+	encode_result bench_encode(const bench_options& options, const codec_case& codec)
+	{
+		encode_result result;
+		result.codec = codec.name;
+
+		const std::vector<short> signal = generate_signal(codec.sample_rate, codec.channels, options.seconds);
+		const size_t frames = signal.size() / codec.channels;
+
+		result.input_bytes = signal.size() * sizeof(short);
+		result.duration = static_cast<double>(frames) / codec.sample_rate;
+
+		std::shared_ptr<myro::memory_output_sink> sink;
+		std::vector<double> samples;
+		for (uint32_t it = 0; it < options.iterations; ++it)
+		{
+			std::shared_ptr<myro::IEncoder> encoder = codec.create_encoder();
+			sink = myro::memory_output_sink::create(result.input_bytes);
+
+			auto start = bench_clock::now();
+			if (!encoder->init(sink, codec.sample_rate, codec.channels))
+			{
+				myro::log::error("[bench] {0} encoder could not be initialized.", codec.name);
+				return result;
+			}
+
+			for (size_t offset = 0; offset < frames; offset += options.chunk_frames)
+			{
+				size_t count = std::min<size_t>(options.chunk_frames, frames - offset);
+				encoder->write(signal.data() + offset * codec.channels, count);
+			}
+
+			encoder->deinit();
+			samples.push_back(elapsed_seconds(start));
+		}
+
+		result.output_bytes = sink->size();
+		result.seconds = summarize(std::move(samples));
+
+		std::ofstream file(signal_path(options, codec), std::ios::binary);
+		file.write(reinterpret_cast<const char*>(sink->data().data()), static_cast<std::streamsize>(sink->size()));
+		result.ok = static_cast<bool>(file);
+		if (!result.ok)
+			myro::log::error("[bench] Could not write {0}.", signal_path(options, codec).string());
+		return result;
+	}
+
+	decode_result bench_decode(const bench_options& options, const codec_case& codec)
+	{
+		decode_result result;
+		result.codec = codec.name;
+
+		const std::filesystem::path path = signal_path(options, codec);
+		std::error_code ec;
+		result.file_bytes = std::filesystem::file_size(path, ec);
+		if (ec)
+			return result;
+
+		std::vector<double> decode_samples;
+		std::vector<double> upload_samples;
+
+		for (uint32_t it = 0; it < options.iterations; ++it)
+		{
+			auto start = bench_clock::now();
+			std::shared_ptr<myro::decoded_audio> audio = myro::audio_engine::decode_audio_file(path);
+			decode_samples.push_back(elapsed_seconds(start));
+
+			if (!audio)
+			{
+				myro::log::error("[bench] {0} loader failed.", codec.name);
+				return result;
+			}
+
+			result.pcm_bytes = audio->samples.size() * sizeof(short);
+			result.duration = static_cast<double>(audio->samples.size() / audio->channels) / audio->sample_rate;
+
+			// AL upload cost, measured on the clip we just decoded.
+			const ALenum format = audio->channels == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+			ALuint buffer = 0;
+			start = bench_clock::now();
+			alGenBuffers(1, &buffer);
+			alBufferData(buffer, format, audio->samples.data(), static_cast<ALsizei>(result.pcm_bytes), static_cast<ALsizei>(audio->sample_rate));
+			upload_samples.push_back(elapsed_seconds(start));
+			alDeleteBuffers(1, &buffer);
+
+			if (alGetError() != AL_NO_ERROR)
+				myro::log::warn("[bench] AL upload reported an error for {0}.", codec.name);
+		}
+
+		result.seconds = summarize(std::move(decode_samples));
+		result.upload_seconds = summarize(std::move(upload_samples));
+		result.ok = true;
+		return result;
+	}
+
+	std::vector<scaling_result> bench_multi_load(const bench_options& options, const std::vector<encode_result>& encoded)
+	{
+		std::vector<std::filesystem::path> files;
+		for (uint32_t copy = 0; copy < options.multi_load_copies; ++copy)
+		{
+			for (size_t i = 0; i < std::size(s_codecs); ++i)
+			{
+				if (encoded[i].ok)
+					files.push_back(signal_path(options, s_codecs[i]));
+			}
+		}
+
+		std::vector<uint32_t> thread_counts;
+		const uint32_t max_threads = myro::audio_engine::get_max_thread_count();
+		for (uint32_t n = 1; n < max_threads; n *= 2)
+			thread_counts.push_back(n);
+		thread_counts.push_back(std::max<uint32_t>(max_threads, 1));
+
+		std::vector<scaling_result> results;
+
+		// thread_pool only grows reliably, so walk the counts in ascending order.
+		for (uint32_t threads : thread_counts)
+		{
+			myro::audio_engine::set_thread_count(threads);
+
+			scaling_result result;
+			result.threads = myro::audio_engine::get_thread_count();
+			result.files = files.size();
+
+			std::vector<double> samples;
+			for (uint32_t it = 0; it < options.iterations; ++it)
+			{
+				auto start = bench_clock::now();
+				auto sources = myro::audio_engine::multi_load_audio_source(files);
+				samples.push_back(elapsed_seconds(start));
+
+				result.loaded = static_cast<size_t>(std::ranges::count_if(sources, [](const auto& s) { return s != nullptr; }));
+				myro::audio_engine::multi_unload_audio_source(sources);
+			}
+			myro::audio_engine::cleanup_expired_sources();
+
+			result.seconds = summarize(std::move(samples));
+			results.push_back(result);
+		}
+
+		return results;
+	}
+
+	void write_timing(std::ostream& out, const char* key, const timing_summary& t)
+	{
+		out << "\"" << key << "\": { \"min\": " << t.min << ", \"median\": " << t.median << ", \"mean\": " << t.mean << " }";
+	}
+
+	bool write_report(const bench_options& options,
+		const std::vector<encode_result>& encoded,
+		const std::vector<decode_result>& decoded,
+		const std::vector<scaling_result>& scaling)
+	{
+		std::ofstream out(options.output);
+		if (!out)
+		{
+			myro::log::error("[bench] Could not open report file: {0}", options.output.string());
+			return false;
+		}
+
+		out.precision(9);
+
+		out << "{\n";
+		out << "  \"schema\": 1,\n";
+		out << "  \"myro_version\": \"" << MYRO_BENCH_VERSION << "\",\n";
+#if defined(MYRO_DEBUG)
+		out << "  \"build\": \"debug\",\n";
+#elif defined(MYRO_DIST)
+		out << "  \"build\": \"dist\",\n";
+#else
+		out << "  \"build\": \"release\",\n";
+#endif
+		out << "  \"timestamp\": " << static_cast<int64_t>(std::time(nullptr)) << ",\n";
+		out << "  \"hardware_threads\": " << myro::audio_engine::get_max_thread_count() << ",\n";
+		out << "  \"config\": { \"seconds\": " << options.seconds
+			<< ", \"iterations\": " << options.iterations
+			<< ", \"chunk_frames\": " << options.chunk_frames
+			<< ", \"multi_load_copies\": " << options.multi_load_copies << " },\n";
+
+		out << "  \"encode\": [\n";
+		for (size_t i = 0; i < encoded.size(); ++i)
+		{
+			const encode_result& r = encoded[i];
+			out << "    { \"codec\": \"" << r.codec << "\", \"ok\": " << (r.ok ? "true" : "false")
+				<< ", \"input_bytes\": " << r.input_bytes
+				<< ", \"output_bytes\": " << r.output_bytes
+				<< ", \"audio_seconds\": " << r.duration
+				<< ", \"mb_per_sec\": " << mb_per_second(r.input_bytes, r.seconds.median)
+				<< ", \"x_realtime\": " << x_realtime(r.duration, r.seconds.median) << ", ";
+			write_timing(out, "seconds", r.seconds);
+			out << " }" << (i + 1 < encoded.size() ? "," : "") << "\n";
+		}
+		out << "  ],\n";
+
+		out << "  \"decode\": [\n";
+		for (size_t i = 0; i < decoded.size(); ++i)
+		{
+			const decode_result& r = decoded[i];
+			out << "    { \"codec\": \"" << r.codec << "\", \"ok\": " << (r.ok ? "true" : "false")
+				<< ", \"file_bytes\": " << r.file_bytes
+				<< ", \"pcm_bytes\": " << r.pcm_bytes
+				<< ", \"audio_seconds\": " << r.duration
+				<< ", \"mb_per_sec\": " << mb_per_second(r.pcm_bytes, r.seconds.median)
+				<< ", \"x_realtime\": " << x_realtime(r.duration, r.seconds.median) << ", ";
+			write_timing(out, "seconds", r.seconds);
+			out << ", \"al_upload\": { \"mb_per_sec\": " << mb_per_second(r.pcm_bytes, r.upload_seconds.median) << ", ";
+			write_timing(out, "seconds", r.upload_seconds);
+			out << " } }" << (i + 1 < decoded.size() ? "," : "") << "\n";
+		}
+		out << "  ],\n";
+
+		const double single_thread = scaling.empty() ? 0.0 : scaling.front().seconds.median;
+
+		out << "  \"multi_load\": [\n";
+		for (size_t i = 0; i < scaling.size(); ++i)
+		{
+			const scaling_result& r = scaling[i];
+			const double loads_per_sec = r.seconds.median > 0.0 ? static_cast<double>(r.loaded) / r.seconds.median : 0.0;
+			const double speedup = r.seconds.median > 0.0 ? single_thread / r.seconds.median : 0.0;
+
+			out << "    { \"threads\": " << r.threads
+				<< ", \"files\": " << r.files
+				<< ", \"loaded\": " << r.loaded
+				<< ", \"loads_per_sec\": " << loads_per_sec
+				<< ", \"speedup\": " << speedup << ", ";
+			write_timing(out, "seconds", r.seconds);
+			out << " }" << (i + 1 < scaling.size() ? "," : "") << "\n";
+		}
+		out << "  ]\n";
+		out << "}\n";
+
+		return static_cast<bool>(out);
+	}
+
+	void print_usage()
+	{
+		std::cout <<
+			"usage: myro_bench [options]\n"
+			"  --output <file>      JSON report path (default: myro_bench.json)\n"
+			"  --work-dir <dir>     directory for the generated test files (default: myro_bench_data)\n"
+			"  --seconds <n>        length of the generated signal (default: 10)\n"
+			"  --iterations <n>     repetitions per measurement (default: 5)\n"
+			"  --chunk <frames>     frames per IEncoder::write call (default: 1024)\n"
+			"  --copies <n>         copies of each file for multi_load_audio_source (default: 4)\n";
+	}
+
+	bool parse_options(int argc, char** argv, bench_options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const bool has_value = i + 1 < argc;
+
+			if (arg == "--help" || arg == "-h")
+				return false;
+			if (!has_value)
+			{
+				std::cerr << "missing value for " << arg << "\n";
+				return false;
+			}
+
+			const char* value = argv[++i];
+			if (arg == "--output")			options.output = value;
+			else if (arg == "--work-dir")	options.work_dir = value;
+			else if (arg == "--seconds")	options.seconds = static_cast<uint32_t>(std::max(1, std::atoi(value)));
+			else if (arg == "--iterations")	options.iterations = static_cast<uint32_t>(std::max(1, std::atoi(value)));
+			else if (arg == "--chunk")		options.chunk_frames = static_cast<uint32_t>(std::max(1, std::atoi(value)));
+			else if (arg == "--copies")		options.multi_load_copies = static_cast<uint32_t>(std::max(1, std::atoi(value)));
+			else
+			{
+				std::cerr << "unknown option " << arg << "\n";
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	bench_options options;
+	if (!parse_options(argc, argv, options))
+	{
+		print_usage();
+		return 1;
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(options.work_dir, ec);
+	if (ec)
+	{
+		std::cerr << "could not create " << options.work_dir << ": " << ec.message() << "\n";
+		return 1;
+	}
+
+	myro::audio_engine::init();
+	myro::log::set_logger_activity(myro::log::level_error | myro::log::level_warn);
+
+	std::vector<encode_result> encoded;
+	for (const codec_case& codec : s_codecs)
+	{
+		std::cout << "encode " << codec.name << "..." << std::endl;
+		encoded.push_back(bench_encode(options, codec));
+	}
+
+	std::vector<decode_result> decoded;
+	for (size_t i = 0; i < std::size(s_codecs); ++i)
+	{
+		if (!encoded[i].ok)
+			continue;
+		std::cout << "decode " << s_codecs[i].name << "..." << std::endl;
+		decoded.push_back(bench_decode(options, s_codecs[i]));
+	}
+
+	std::cout << "multi_load_audio_source scaling..." << std::endl;
+	std::vector<scaling_result> scaling = bench_multi_load(options, encoded);
+
+	const bool written = write_report(options, encoded, decoded, scaling);
+
+	myro::audio_engine::shutdown();
+
+	if (!written)
+		return 1;
+
+	std::cout << "report written to " << options.output.string() << std::endl;
+	return 0;
+}
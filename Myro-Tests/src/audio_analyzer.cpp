@@ -0,0 +1,115 @@
+#include "test.h"
+
+#include "audio/audio_analyzer.h"
+
+#include <algorithm>
+#include <numbers>
+#include <vector>
+
+namespace
+{
+	std::vector<short> sine(double frequency, double amplitude, uint32_t rate, size_t frames, uint16_t channels)
+	{
+		std::vector<short> samples(frames * channels);
+		for (size_t i = 0; i < frames; ++i)
+		{
+			const double value = amplitude * 32767.0 * std::sin(2.0 * std::numbers::pi * frequency * static_cast<double>(i) / rate);
+			for (uint16_t c = 0; c < channels; ++c)
+				samples[i * channels + c] = static_cast<short>(std::lrint(value));
+		}
+		return samples;
+	}
+
+	size_t loudest_bin(const myro::audio_analysis& analysis)
+	{
+		return static_cast<size_t>(std::max_element(analysis.spectrum_db.begin(), analysis.spectrum_db.end()) - analysis.spectrum_db.begin());
+	}
+
+	// A tone centred on a bin reads its level there, the peak and RMS follow the amplitude.
+	void test_levels()
+	{
+		auto analyzer = myro::audio_analyzer::create({ 2048, 20 });
+		analyzer->configure(48000, 2);
+
+		const double frequency = 48000.0 / 2048.0 * 100.0;
+		const std::vector<short> pcm = sine(frequency, 0.5, 48000, 48000 / 2, 2);
+		analyzer->process(pcm.data(), 1000);
+		analyzer->process(pcm.data() + 2000, pcm.size() / 2 - 1000);
+
+		const myro::audio_analysis& analysis = analyzer->poll();
+		MYRO_CHECK(analysis.sequence == 25);
+		MYRO_CHECK(analysis.channels == 2);
+		MYRO_CHECK(loudest_bin(analysis) == 100);
+		MYRO_CHECK_NEAR(analysis.spectrum_db[100], -6.02, 0.1);
+		MYRO_CHECK_NEAR(analysis.peak_db[0], -6.02, 0.1);
+		MYRO_CHECK_NEAR(analysis.rms_db[1], -9.03, 0.1);
+	}
+
+	// A hop of 4800 frames is longer than the 2048 frame FFT: the spectrum only sees the newest frames.
+	void test_hop_longer_than_fft()
+	{
+		auto analyzer = myro::audio_analyzer::create({ 2048, 100 });
+		analyzer->configure(48000, 1);
+
+		// Low tone first, then a high one for the second half of the hop.
+		std::vector<short> pcm = sine(48000.0 / 2048.0 * 20.0, 0.5, 48000, 4800, 1);
+		const std::vector<short> high = sine(48000.0 / 2048.0 * 300.0, 0.5, 48000, 2400, 1);
+		std::copy(high.begin(), high.end(), pcm.begin() + 2400);
+
+		analyzer->process(pcm.data(), pcm.size());
+		const myro::audio_analysis& analysis = analyzer->poll();
+		MYRO_CHECK(analysis.sequence == 1);
+		MYRO_CHECK(loudest_bin(analysis) == 300);
+		MYRO_CHECK(analysis.spectrum_db[20] < -60.0f);
+
+		// Several hops in one call, split unevenly.
+		const std::vector<short> longer = sine(1000.0, 0.25, 48000, 48000, 1);
+		analyzer->process(longer.data(), 7001);
+		analyzer->process(longer.data() + 7001, longer.size() - 7001);
+		MYRO_CHECK(analyzer->poll().sequence == 11);
+		MYRO_CHECK_NEAR(analyzer->poll().peak_db[0], -12.04, 0.1);
+	}
+
+	std::vector<short> surround_tone(size_t frames, uint16_t channels, uint16_t channel, double amplitude)
+	{
+		const std::vector<short> mono = sine(1000.0, amplitude, 48000, frames, 1);
+		std::vector<short> pcm(frames * channels, 0);
+		for (size_t i = 0; i < frames; ++i)
+			pcm[i * channels + channel] = mono[i];
+		return pcm;
+	}
+
+	float momentary_lufs(uint16_t channels, const std::vector<short>& pcm)
+	{
+		auto analyzer = myro::audio_analyzer::create({ 1024, 100 });
+		analyzer->configure(48000, channels);
+		analyzer->process(pcm.data(), pcm.size() / channels);
+		return analyzer->poll().momentary_lufs;
+	}
+
+	// BS.1770 channel weights: the LFE does not count, the surrounds count 1.41 (+1.5 dB).
+	void test_surround_loudness()
+	{
+		const size_t frames = 48000 / 2;
+		const float front = momentary_lufs(6, surround_tone(frames, 6, 0, 0.25));
+
+		std::vector<short> with_lfe = surround_tone(frames, 6, 0, 0.25);
+		const std::vector<short> lfe = surround_tone(frames, 6, 3, 0.9);
+		for (size_t i = 0; i < with_lfe.size(); ++i)
+			with_lfe[i] = static_cast<short>(with_lfe[i] + lfe[i]);
+		MYRO_CHECK_NEAR(momentary_lufs(6, with_lfe), front, 1e-3);
+		MYRO_CHECK(momentary_lufs(6, surround_tone(frames, 6, 3, 0.9)) == myro::audio_analysis::silence_db);
+
+		MYRO_CHECK_NEAR(momentary_lufs(6, surround_tone(frames, 6, 4, 0.25)) - front, 10.0 * std::log10(1.41), 0.01);
+		MYRO_CHECK_NEAR(momentary_lufs(8, surround_tone(frames, 8, 7, 0.25)) - front, 10.0 * std::log10(1.41), 0.01);
+		MYRO_CHECK_NEAR(momentary_lufs(2, surround_tone(frames, 2, 1, 0.25)), front, 0.01);
+	}
+}
+
+int main()
+{
+	test_levels();
+	test_hop_longer_than_fft();
+	test_surround_loudness();
+	return MYRO_TEST_RESULT("audio_analyzer");
+}
@@ -0,0 +1,110 @@
+#include "test.h"
+
+#include "internal/convolver.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+	std::vector<float> noise(size_t count, uint32_t seed)
+	{
+		std::mt19937 generator(seed);
+		std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+		std::vector<float> samples(count);
+		for (float& sample : samples)
+			sample = distribution(generator);
+		return samples;
+	}
+
+	std::vector<float> direct(const std::vector<float>& in, const std::vector<float>& response)
+	{
+		std::vector<float> out(in.size(), 0.0f);
+		for (size_t i = 0; i < in.size(); ++i)
+		{
+			double sum = 0.0;
+			for (size_t k = 0; k < response.size() && k <= i; ++k)
+				sum += static_cast<double>(in[i - k]) * response[k];
+			out[i] = static_cast<float>(sum);
+		}
+		return out;
+	}
+
+	std::vector<float> convolve(myro::partitioned_convolver& convolver, const std::vector<float>& in)
+	{
+		const size_t block = convolver.block_size();
+		std::vector<float> out(in.size());
+		for (size_t i = 0; i + block <= in.size(); i += block)
+			convolver.process(in.data() + i, out.data() + i);
+		return out;
+	}
+
+	double max_error(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		double error = 0.0;
+		for (size_t i = 0; i < a.size(); ++i)
+			error = std::max(error, std::fabs(static_cast<double>(a[i]) - b[i]));
+		return error;
+	}
+
+	// Several levels, the last one cut short, and a signal long enough to wrap every delay line.
+	void test_matches_direct()
+	{
+		const size_t lengths[] = { 1, 64, 100, 5000, 20000 };
+		for (const size_t length : lengths)
+		{
+			std::vector<float> response = noise(length, 1);
+			for (float& tap : response)
+				tap *= 0.05f;
+			const std::vector<float> in = noise(64 * 800, 2);
+
+			myro::partitioned_convolver convolver;
+			convolver.reset(response.data(), response.size(), 64, 1024);
+			const std::vector<float> expected = direct(in, response);
+			MYRO_CHECK(max_error(convolve(convolver, in), expected) < 1e-4);
+		}
+	}
+
+	void test_in_place()
+	{
+		const std::vector<float> response = noise(3000, 3);
+		const std::vector<float> in = noise(128 * 100, 4);
+
+		myro::partitioned_convolver separate;
+		separate.reset(response.data(), response.size(), 128, 512);
+		const std::vector<float> expected = convolve(separate, in);
+
+		myro::partitioned_convolver aliased;
+		aliased.reset(response.data(), response.size(), 128, 512);
+		std::vector<float> out = in;
+		for (size_t i = 0; i < out.size(); i += 128)
+			aliased.process(out.data() + i, out.data() + i);
+		MYRO_CHECK(out == expected);
+	}
+
+	// After clear() the convolver behaves as if freshly reset, including a job spread over blocks.
+	void test_clear()
+	{
+		const std::vector<float> response = noise(10000, 5);
+		const std::vector<float> in = noise(64 * 300, 6);
+
+		myro::partitioned_convolver convolver;
+		convolver.reset(response.data(), response.size(), 64, 1024);
+		MYRO_CHECK(convolver.level_count() > 2);
+		const std::vector<float> expected = convolve(convolver, in);
+
+		// Stop in the middle of a partition so every level has work in flight.
+		const std::vector<float> other = noise(64 * 37, 7);
+		convolve(convolver, other);
+		convolver.clear();
+		MYRO_CHECK(convolve(convolver, in) == expected);
+	}
+}
+
+int main()
+{
+	test_matches_direct();
+	test_in_place();
+	test_clear();
+	return MYRO_TEST_RESULT("convolver");
+}
@@ -0,0 +1,271 @@
+#include "test.h"
+
+#include "audio/dsp_chain.h"
+#include "core/ring_buffer.h"
+#include "internal/stream_position.h"
+
+#include <algorithm>
+#include <numbers>
+#include <vector>
+
+namespace
+{
+	std::vector<float> sine(double frequency, uint32_t rate, size_t frames, uint16_t channels)
+	{
+		std::vector<float> samples(frames * channels);
+		for (size_t i = 0; i < frames; ++i)
+			for (uint16_t c = 0; c < channels; ++c)
+				samples[i * channels + c] = static_cast<float>(0.5 * std::sin(2.0 * std::numbers::pi * frequency * static_cast<double>(i) / rate));
+		return samples;
+	}
+
+	float peak(const std::vector<float>& samples, size_t from)
+	{
+		float level = 0.0f;
+		for (size_t i = from; i < samples.size(); ++i)
+			level = std::max(level, std::fabs(samples[i]));
+		return level;
+	}
+
+	// Gain of a settled tone through a fresh copy of the node, in dB.
+	double tone_gain_db(const std::shared_ptr<myro::dsp_node>& node, double frequency, uint16_t channels)
+	{
+		std::vector<float> samples = sine(frequency, 48000, 48000 / 2, channels);
+		node->prepare(48000, channels);
+		node->process(samples.data(), samples.size() / channels);
+		return 20.0 * std::log10(peak(samples, samples.size() / 2) / 0.5);
+	}
+
+	void test_biquad()
+	{
+		auto low_pass = myro::biquad_node::create(myro::biquad_type::low_pass, 1000.0f);
+		MYRO_CHECK_NEAR(tone_gain_db(low_pass, 100.0, 1), 0.0, 0.1);
+		MYRO_CHECK_NEAR(tone_gain_db(low_pass, 1000.0, 2), -3.01, 0.1);
+		MYRO_CHECK(tone_gain_db(low_pass, 10000.0, 2) < -38.0);
+
+		auto high_pass = myro::biquad_node::create(myro::biquad_type::high_pass, 1000.0f);
+		MYRO_CHECK(tone_gain_db(high_pass, 100.0, 1) < -38.0);
+		MYRO_CHECK_NEAR(tone_gain_db(high_pass, 10000.0, 1), 0.0, 0.1);
+
+		auto peaking = myro::biquad_node::create(myro::biquad_type::peaking, 2000.0f, 1.0f, 6.0f);
+		MYRO_CHECK_NEAR(tone_gain_db(peaking, 2000.0, 2), 6.0, 0.1);
+		peaking->set_gain_db(-6.0f);
+		MYRO_CHECK_NEAR(tone_gain_db(peaking, 2000.0, 2), -6.0, 0.1);
+
+		// Channels keep separate state: a silent right channel stays silent.
+		std::vector<float> stereo = sine(500.0, 48000, 4800, 2);
+		for (size_t i = 1; i < stereo.size(); i += 2)
+			stereo[i] = 0.0f;
+		low_pass->prepare(48000, 2);
+		low_pass->process(stereo.data(), 4800);
+		float right = 0.0f;
+		for (size_t i = 1; i < stereo.size(); i += 2)
+			right = std::max(right, std::fabs(stereo[i]));
+		MYRO_CHECK(right == 0.0f);
+		MYRO_CHECK(peak(stereo, 0) > 0.3f);
+	}
+
+	void test_compressor()
+	{
+		// A constant level settles at threshold + (level - threshold) / ratio.
+		auto compressor = myro::compressor_node::create(-20.0f, 4.0f, 1.0f, 10.0f);
+		compressor->prepare(48000, 2);
+		std::vector<float> level(4800 * 2, 0.4f);
+		compressor->process(level.data(), 4800);
+		const double input_db = 20.0 * std::log10(0.4);
+		const double expected_db = -20.0 + (input_db + 20.0) / 4.0;
+		MYRO_CHECK_NEAR(20.0 * std::log10(level.back()), expected_db, 0.05);
+		MYRO_CHECK_NEAR(compressor->get_reduction_db(), input_db - expected_db, 0.05);
+
+		// Below the threshold nothing changes.
+		std::vector<float> quiet(480, 0.05f);
+		compressor->reset();
+		compressor->process(quiet.data(), 240);
+		MYRO_CHECK(std::ranges::all_of(quiet, [](float s) { return s == 0.05f; }));
+
+		// The limiter catches the first sample already.
+		auto limiter = myro::compressor_node::limiter(-6.0f);
+		limiter->prepare(48000, 1);
+		std::vector<float> loud = sine(1000.0, 48000, 4800, 1);
+		for (float& s : loud)
+			s *= 2.0f;
+		limiter->process(loud.data(), loud.size());
+		MYRO_CHECK(peak(loud, 0) <= std::pow(10.0f, -6.0f / 20.0f) * 1.001f);
+	}
+
+	// A callback may edit the chain it runs in; the edit applies from the next block.
+	void test_callback_edits_chain()
+	{
+		auto chain = myro::dsp_chain::create();
+		chain->prepare(48000, 1);
+
+		size_t calls = 0;
+		chain->add(myro::callback_node::create([&](float*, size_t, uint16_t)
+		{
+			if (calls++ == 0)
+				chain->add(myro::callback_node::create([](float* samples, size_t frames, uint16_t) { std::fill_n(samples, frames, 0.25f); }));
+		}));
+
+		std::vector<float> block(64, 1.0f);
+		chain->process(block.data(), 64);
+		MYRO_CHECK(block[0] == 1.0f);
+		chain->process(block.data(), 64);
+		MYRO_CHECK(block[0] == 0.25f);
+		MYRO_CHECK(calls == 2);
+	}
+
+	struct opaque_node : myro::dsp_node
+	{
+		void prepare(uint32_t, uint16_t) override {}
+		void process(float*, size_t) override {}
+		void reset() override {}
+	};
+
+	void test_bake()
+	{
+		auto chain = myro::dsp_chain::create({ .block_frames = 100, .bake_tail_ms = 10 });
+		chain->add(myro::biquad_node::create(myro::biquad_type::low_pass, 2000.0f));
+		chain->add(myro::compressor_node::limiter(-3.0f));
+
+		std::vector<short> clip(1000 * 2);
+		for (size_t i = 0; i < clip.size(); ++i)
+			clip[i] = static_cast<short>((i % 7) * 3000 - 9000);
+
+		// The reference: the same nodes run offline over the clip plus its silent tail.
+		const size_t frames = 1000 + 480;
+		std::vector<float> expected(frames * 2, 0.0f);
+		for (size_t i = 0; i < clip.size(); ++i)
+			expected[i] = static_cast<float>(clip[i]) / 32768.0f;
+		auto reference = chain->clone();
+		reference->prepare(48000, 2);
+		reference->process(expected.data(), frames);
+
+		std::vector<short> baked = clip;
+		MYRO_CHECK(chain->bake(baked, 48000, 2));
+		MYRO_CHECK(baked.size() == frames * 2);
+		bool matches = true;
+		for (size_t i = 0; i < baked.size(); ++i)
+			matches &= std::abs(baked[i] - std::lrint(std::clamp(expected[i], -1.0f, 1.0f) * 32768.0f)) <= 1;
+		MYRO_CHECK(matches);
+
+		// Baking leaves the chain itself unprepared and untouched.
+		MYRO_CHECK(!chain->is_attached());
+
+		chain->add(std::make_shared<opaque_node>());
+		std::vector<short> untouched = clip;
+		MYRO_CHECK(!chain->bake(untouched, 48000, 2));
+		MYRO_CHECK(untouched == clip);
+		MYRO_CHECK(!chain->clone());
+	}
+
+	void test_stream_position()
+	{
+		myro::stream_position position;
+		uint64_t shortfall = 0;
+		position.written = 1000;
+		position.read = 400;
+		MYRO_CHECK(position.pending(shortfall) == 600);
+		MYRO_CHECK(shortfall == 0);
+
+		// Stale frames count as consumed.
+		position.mark_stale();
+		MYRO_CHECK(position.pending(shortfall) == 0);
+		position.written = 1200;
+		MYRO_CHECK(position.pending(shortfall) == 200);
+
+		// A reader ahead of the writer is an empty queue, not 2^64 - n frames.
+		position.read = 1500;
+		MYRO_CHECK(position.pending(shortfall) == 0);
+		MYRO_CHECK(shortfall == 300);
+	}
+
+	// The attached chain's worker and OpenAL callback, reduced to the ring and stream_position
+	// protocol they share; the clip's frames hold their own index.
+	struct restart_stream
+	{
+		myro::stream_position position;
+		myro::spsc_ring_buffer<short> ring;
+		uint64_t cursor = 0;
+
+		restart_stream() { ring.allocate(256); }
+
+		void render(size_t frames)
+		{
+			for (size_t i = 0; i < frames; ++i)
+			{
+				const short sample = static_cast<short>(cursor++);
+				ring.write(&sample, 1);
+			}
+			position.written.store(position.written.load() + frames);
+		}
+
+		// What _dsp_chain_data::render_loop does before its next fill.
+		void serve(size_t frames)
+		{
+			uint64_t frame = 0;
+			uint64_t request = 0;
+			if (!position.restart_pending(frame, request))
+				return;
+			cursor = frame;
+			position.mark_stale();
+			render(frames);
+			position.finish_restart(request);
+		}
+
+		std::vector<short> pull(size_t wanted)
+		{
+			std::vector<short> out(wanted, -1);
+			if (position.restarting())
+				std::fill(out.begin(), out.end(), short{ 0 });
+			else
+			{
+				bool caught_up = false;
+				out.resize(position.read_frames(ring, out.data(), wanted, 1, caught_up));
+			}
+			return out;
+		}
+	};
+
+	void test_restart()
+	{
+		restart_stream stream;
+		stream.render(64);
+		MYRO_CHECK(stream.pull(16).front() == 0);
+		MYRO_CHECK(stream.pull(16).front() == 16);
+
+		// stop() then play() before the worker wakes: silence, never the old frames or a short read.
+		stream.position.request_restart(0);
+		stream.position.request_restart(0);
+		const std::vector<short> waiting = stream.pull(16);
+		MYRO_CHECK(waiting.size() == 16);
+		MYRO_CHECK(std::ranges::all_of(waiting, [](short sample) { return sample == 0; }));
+
+		// Once served, playback starts at frame 0 with the stale frames skipped.
+		stream.serve(32);
+		MYRO_CHECK(!stream.position.restarting());
+		const std::vector<short> restarted = stream.pull(8);
+		MYRO_CHECK(restarted.size() == 8);
+		MYRO_CHECK(restarted.front() == 0 && restarted.back() == 7);
+
+		// A seek lands where it was asked to.
+		stream.position.request_restart(100);
+		stream.serve(32);
+		MYRO_CHECK(stream.pull(1).front() == 100);
+
+		// A reset on attach drops requests made for the previous source.
+		stream.position.request_restart(5);
+		stream.position.reset();
+		MYRO_CHECK(!stream.position.restarting());
+	}
+}
+
+int main()
+{
+	test_biquad();
+	test_compressor();
+	test_callback_edits_chain();
+	test_bake();
+	test_stream_position();
+	test_restart();
+	return MYRO_TEST_RESULT("dsp_chain");
+}
@@ -0,0 +1,73 @@
+#include "test.h"
+
+#include "utility/formatter.h"
+
+#include <string>
+
+namespace
+{
+	// The same parser backs the compile-time check; it rejects what would fail to compile.
+	constexpr bool valid(std::string_view fmt, size_t arg_count)
+	{
+		return myro::detail::parse_format(fmt, arg_count, [](std::string_view) {}, [](size_t, myro::format_spec) {}) == nullptr;
+	}
+
+	static_assert(valid("{} and {}", 2));
+	static_assert(valid("{1} before {0}", 2));
+	static_assert(valid("{0,8} {0,-8} {:.2}", 1));
+	static_assert(valid("{{literal}} }", 0));
+	static_assert(!valid("{} and {}", 1));
+	static_assert(!valid("{2}", 2));
+	static_assert(!valid("{0", 1));
+	static_assert(!valid("{0x}", 1));
+
+	struct streamable
+	{
+		int value = 0;
+	};
+
+	std::ostream& operator<<(std::ostream& os, const streamable& s)
+	{
+		return os << "streamable(" << s.value << ")";
+	}
+
+	void test_values()
+	{
+		using myro::formatter;
+		MYRO_CHECK(formatter::format("{} {} {}", 42, -7, 18446744073709551615ull) == "42 -7 18446744073709551615");
+		MYRO_CHECK(formatter::format("{} {}", true, 'x') == "1 x");
+		MYRO_CHECK(formatter::format("{} {:.2} {:.0}", 0.1f, 3.14159, 2.5) == "0.1 3.14 2");
+		MYRO_CHECK(formatter::format("{}", 1234567.0) == "1.23457e+06");
+		MYRO_CHECK(formatter::format("{} {}", "text", std::string("string")) == "text string");
+		MYRO_CHECK(formatter::format("{}", std::filesystem::path("a") / "b") == (std::filesystem::path("a") / "b").string());
+		MYRO_CHECK(formatter::format("{}", streamable{ 3 }) == "streamable(3)");
+		MYRO_CHECK(formatter::format("{}", static_cast<void*>(nullptr)) == "0x0");
+	}
+
+	void test_fields()
+	{
+		using myro::formatter;
+		MYRO_CHECK(formatter::format("{1}-{0}-{1}", 'a', 'b') == "b-a-b");
+		MYRO_CHECK(formatter::format("[{0,5}] [{0,-5}]", 42) == "[   42] [42   ]");
+		MYRO_CHECK(formatter::format("[{0,2}]", 12345) == "[12345]");
+		MYRO_CHECK(formatter::format("{{{}}} }", 1) == "{1} }");
+	}
+
+	// Output longer than the stack buffer is cut off, never overruns it.
+	void test_truncation()
+	{
+		const std::string long_text(myro::format_buffer::capacity + 100, 'x');
+		myro::format_buffer buffer;
+		const std::string_view result = myro::formatter::format_to(buffer, "{}{0,2000}{}", long_text, 12);
+		MYRO_CHECK(result.size() == myro::format_buffer::capacity);
+		MYRO_CHECK(result.find_first_not_of('x') == std::string_view::npos);
+	}
+}
+
+int main()
+{
+	test_values();
+	test_fields();
+	test_truncation();
+	return MYRO_TEST_RESULT("formatter");
+}
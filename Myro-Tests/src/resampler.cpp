@@ -0,0 +1,96 @@
+#include "test.h"
+
+#include "internal/resampler.h"
+
+#include <numbers>
+#include <vector>
+
+namespace
+{
+	std::vector<float> sine(double frequency, uint32_t rate, size_t frames, uint16_t channels)
+	{
+		std::vector<float> samples(frames * channels);
+		for (size_t i = 0; i < frames; ++i)
+			for (uint16_t c = 0; c < channels; ++c)
+				samples[i * channels + c] = static_cast<float>(0.5 * std::sin(2.0 * std::numbers::pi * frequency * static_cast<double>(i) / rate));
+		return samples;
+	}
+
+	// Largest deviation from the ideal tone at the output rate, skipping the edges where the filter sees silence.
+	double tone_error(const std::vector<float>& out, double frequency, uint32_t rate, uint16_t channels, size_t margin)
+	{
+		const size_t frames = out.size() / channels;
+		double error = 0.0;
+		for (size_t i = margin; i + margin < frames; ++i)
+		{
+			const double expected = 0.5 * std::sin(2.0 * std::numbers::pi * frequency * static_cast<double>(i) / rate);
+			for (uint16_t c = 0; c < channels; ++c)
+				error = std::max(error, std::fabs(out[i * channels + c] - expected));
+		}
+		return error;
+	}
+
+	double peak(const std::vector<float>& out, size_t margin)
+	{
+		double level = 0.0;
+		for (size_t i = margin; i + margin < out.size(); ++i)
+			level = std::max(level, static_cast<double>(std::fabs(out[i])));
+		return level;
+	}
+
+	void test_passband()
+	{
+		// Common ratios, an exact polyphase one and one that interpolates between table phases.
+		const uint32_t rates[][2] = { { 48000, 44100 }, { 44100, 48000 }, { 48000, 16000 }, { 16000, 48000 }, { 44056, 48000 } };
+		for (const auto& rate : rates)
+		{
+			const std::vector<float> in = sine(1000.0, rate[0], rate[0] / 4, 2);
+			const std::vector<float> out = myro::sinc_resampler::resample(in.data(), in.size() / 2, 2, rate[0], rate[1]);
+			MYRO_CHECK(out.size() / 2 == (static_cast<uint64_t>(in.size() / 2) * rate[1] + rate[0] - 1) / rate[0]);
+			MYRO_CHECK(tone_error(out, 1000.0, rate[1], 2, 256) < 1e-3);
+		}
+	}
+
+	void test_alias_rejection()
+	{
+		// 20 kHz does not fit below 8 kHz; a linear resampler would fold it to 4 kHz almost unattenuated.
+		const std::vector<float> in = sine(20000.0, 48000, 48000 / 4, 1);
+		const std::vector<float> out = myro::sinc_resampler::resample(in.data(), in.size(), 1, 48000, 16000);
+		MYRO_CHECK(peak(out, 256) < 0.5 * 1e-4);
+	}
+
+	// Odd-sized chunks give the same output as one call.
+	void test_streaming()
+	{
+		const std::vector<float> in = sine(440.0, 44100, 10000, 2);
+		myro::sinc_resampler whole;
+		MYRO_CHECK(whole.init(44100, 48000, 2));
+		std::vector<float> expected(whole.max_output_frames(10000) * 2);
+		MYRO_CHECK(whole.process(in.data(), 10000, expected.data()) == expected.size() / 2);
+
+		myro::sinc_resampler chunked;
+		MYRO_CHECK(chunked.init(44100, 48000, 2));
+		std::vector<float> out;
+		size_t offset = 0;
+		while (offset < 10000)
+		{
+			const size_t frames = std::min<size_t>(333, 10000 - offset);
+			std::vector<float> block(chunked.max_output_frames(frames) * 2);
+			const size_t produced = chunked.process(in.data() + offset * 2, frames, block.data());
+			MYRO_CHECK(produced * 2 == block.size());
+			out.insert(out.end(), block.begin(), block.end());
+			offset += frames;
+		}
+		MYRO_CHECK(out == expected);
+
+		MYRO_CHECK(!chunked.init(0, 48000, 2));
+	}
+}
+
+int main()
+{
+	test_passband();
+	test_alias_rejection();
+	test_streaming();
+	return MYRO_TEST_RESULT("resampler");
+}
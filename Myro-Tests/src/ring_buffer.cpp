@@ -0,0 +1,110 @@
+#include "test.h"
+
+#include "core/ring_buffer.h"
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+	void test_wrap_around()
+	{
+		myro::spsc_ring_buffer<int> ring(6);
+		MYRO_CHECK(ring.capacity() == 6);
+		MYRO_CHECK(ring.size() == 0);
+		MYRO_CHECK(ring.write_available() == 6);
+
+		const int first[4] = { 1, 2, 3, 4 };
+		MYRO_CHECK(ring.write(first, 4) == 4);
+
+		int out[6] = {};
+		MYRO_CHECK(ring.read(out, 3) == 3);
+		MYRO_CHECK(out[0] == 1 && out[1] == 2 && out[2] == 3);
+
+		// Crosses the end of the storage: the visitor sees two regions.
+		const int second[5] = { 5, 6, 7, 8, 9 };
+		MYRO_CHECK(ring.write(second, 5) == 5);
+		MYRO_CHECK(ring.size() == 6);
+		MYRO_CHECK(ring.write_available() == 0);
+
+		size_t regions = 0;
+		std::vector<int> seen;
+		MYRO_CHECK(ring.read(6, [&](const int* data, size_t count)
+		{
+			++regions;
+			seen.insert(seen.end(), data, data + count);
+		}) == 6);
+		MYRO_CHECK(regions == 2);
+		MYRO_CHECK((seen == std::vector<int>{ 4, 5, 6, 7, 8, 9 }));
+		MYRO_CHECK(ring.size() == 0);
+	}
+
+	void test_full_and_empty()
+	{
+		myro::spsc_ring_buffer<short> ring(4);
+		const short data[6] = { 1, 2, 3, 4, 5, 6 };
+
+		// A full ring accepts only what fits and reports it.
+		MYRO_CHECK(ring.write(data, 6) == 4);
+		MYRO_CHECK(ring.write(data, 1) == 0);
+
+		short out[6] = {};
+		MYRO_CHECK(ring.skip(1) == 1);
+		MYRO_CHECK(ring.read(out, 6) == 3);
+		MYRO_CHECK(out[0] == 2 && out[2] == 4);
+		MYRO_CHECK(ring.read(out, 1) == 0);
+
+		ring.reset();
+		MYRO_CHECK(ring.size() == 0);
+		MYRO_CHECK(ring.write_available() == 4);
+	}
+
+	// One producer, one consumer, stereo frames of odd-sized chunks: every sample arrives once, in order.
+	void test_threaded_transfer()
+	{
+		constexpr size_t channels = 2;
+		constexpr uint32_t total = 200000;
+		myro::spsc_ring_buffer<uint32_t> ring(97 * channels);
+
+		std::thread producer([&]()
+		{
+			uint32_t next = 0;
+			uint32_t chunk[13 * channels];
+			while (next < total)
+			{
+				const size_t frames = std::min<size_t>(13, (total - next) / channels);
+				for (size_t i = 0; i < frames * channels; ++i)
+					chunk[i] = next + static_cast<uint32_t>(i);
+
+				size_t written = 0;
+				while (written < frames * channels)
+					written += ring.write(chunk + written, frames * channels - written);
+				next += static_cast<uint32_t>(frames * channels);
+			}
+		});
+
+		uint32_t expected = 0;
+		bool in_order = true;
+		while (expected < total)
+		{
+			ring.read(ring.capacity(), [&](const uint32_t* data, size_t count)
+			{
+				for (size_t i = 0; i < count; ++i)
+					in_order &= data[i] == expected++;
+			});
+		}
+		producer.join();
+
+		MYRO_CHECK(in_order);
+		MYRO_CHECK(expected == total);
+		MYRO_CHECK(ring.size() == 0);
+	}
+}
+
+int main()
+{
+	test_wrap_around();
+	test_full_and_empty();
+	test_threaded_transfer();
+	return MYRO_TEST_RESULT("ring_buffer");
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cmath>
+#include <cstdio>
+
+// Minimal checks for the CTest executables: a failed check is reported and counted, and
+// MYRO_TEST_RESULT turns the count into the exit code.
+namespace myro::test
+{
+	inline int& failures()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	inline void fail(const char* file, int line, const char* expression)
+	{
+		std::printf("%s:%d: check failed: %s\n", file, line, expression);
+		++failures();
+	}
+
+	inline int result(const char* name)
+	{
+		if (failures() == 0)
+			std::printf("%s: all checks passed\n", name);
+		else
+			std::printf("%s: %d check(s) failed\n", name, failures());
+		return failures() == 0 ? 0 : 1;
+	}
+}
+
+#define MYRO_CHECK(expression) \
+	do { if (!(expression)) ::myro::test::fail(__FILE__, __LINE__, #expression); } while (false)
+
+#define MYRO_CHECK_NEAR(a, b, tolerance) \
+	do { if (!(std::fabs(static_cast<double>(a) - static_cast<double>(b)) <= static_cast<double>(tolerance))) ::myro::test::fail(__FILE__, __LINE__, #a " ~= " #b); } while (false)
+
+#define MYRO_TEST_RESULT(name) ::myro::test::result(name)
@@ -0,0 +1,77 @@
+#include "test.h"
+
+#include "core/triple_buffer.h"
+
+#include <atomic>
+#include <thread>
+
+namespace
+{
+	struct snapshot
+	{
+		uint64_t sequence = 0;
+		uint64_t check = 0;	// always sequence * 3; a torn read would break it
+	};
+
+	void test_latest_value()
+	{
+		myro::triple_buffer<int> buffer;
+		MYRO_CHECK(buffer.read() == 0);
+
+		buffer.write_buffer() = 1;
+		buffer.publish();
+		buffer.write_buffer() = 2;
+		buffer.publish();
+		MYRO_CHECK(buffer.read() == 2);
+
+		// Nothing new: the last value is returned again.
+		MYRO_CHECK(buffer.read() == 2);
+
+		buffer.write_buffer() = 3;
+		buffer.publish();
+		MYRO_CHECK(buffer.read() == 3);
+	}
+
+	// The reader never sees a half written value nor goes back in time.
+	void test_threaded()
+	{
+		myro::triple_buffer<snapshot> buffer;
+		constexpr uint64_t total = 200000;
+		std::atomic<bool> done{ false };
+
+		std::thread producer([&]()
+		{
+			for (uint64_t i = 1; i <= total; ++i)
+			{
+				snapshot& next = buffer.write_buffer();
+				next.sequence = i;
+				next.check = i * 3;
+				buffer.publish();
+			}
+			done.store(true, std::memory_order_release);
+		});
+
+		bool consistent = true;
+		bool monotonic = true;
+		uint64_t last = 0;
+		while (!done.load(std::memory_order_acquire))
+		{
+			const snapshot& value = buffer.read();
+			consistent &= value.check == value.sequence * 3;
+			monotonic &= value.sequence >= last;
+			last = value.sequence;
+		}
+		producer.join();
+
+		MYRO_CHECK(consistent);
+		MYRO_CHECK(monotonic);
+		MYRO_CHECK(buffer.read().sequence == total);
+	}
+}
+
+int main()
+{
+	test_latest_value();
+	test_threaded();
+	return MYRO_TEST_RESULT("triple_buffer");
+}
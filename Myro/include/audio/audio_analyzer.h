@@ -0,0 +1,68 @@
+#pragma once
+
+#include "audio_source.h"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace myro
+{
+	struct _audio_analyzer_data;
+
+	struct analyzer_options
+	{
+		uint32_t fft_size = 2048;			// power of two, 64 .. 32768
+		uint32_t update_interval_ms = 20;	// how often a new result is published
+	};
+
+	// Levels are in dBFS, floored at audio_analysis::silence_db.
+	struct audio_analysis
+	{
+		static constexpr size_t max_channels = 8;
+		static constexpr float silence_db = -120.0f;
+
+		uint64_t sequence = 0;				// 0 until the first result, then increments per update
+		uint32_t sample_rate = 0;
+		uint16_t channels = 0;				// entries used in peak_db / rms_db (at most max_channels)
+		std::array<float, max_channels> peak_db{};	// over the last update interval
+		std::array<float, max_channels> rms_db{};
+		float momentary_lufs = silence_db;	// ITU-R BS.1770 K-weighted loudness over the last 400 ms, LFE excluded
+		std::vector<float> spectrum_db;		// fft_size / 2 + 1 bins of the channel mix; bin i is at i * sample_rate / fft_size Hz
+	};
+
+	// Level metering and spectrum analysis for a capture stream or a playing source.
+	// Results are published through a triple buffer: the feeding thread never waits for the reader,
+	// and poll() is lock-free, so a UI can read at any rate.
+	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+	class audio_analyzer
+	{
+	public:
+		static std::shared_ptr<audio_analyzer> create(const analyzer_options& options = {}) { return std::make_shared<audio_analyzer>(options); }
+
+		explicit audio_analyzer(const analyzer_options& options);
+		~audio_analyzer();
+
+		audio_analyzer(const audio_analyzer&) = delete;
+		audio_analyzer& operator=(const audio_analyzer&) = delete;
+
+		// Feeding side, one thread at a time. audio_capture::add_analyzer and attach() drive these;
+		// they can also be called directly.
+		void configure(uint32_t sample_rate, uint16_t channels);
+		void process(const short* pcm_frames, size_t frame_count);
+
+		// Follows the play position of a source on a worker thread of its own. The source must have been
+		// loaded with audio_engine::set_retain_pcm(true), since OpenAL cannot read a buffer back.
+		bool attach(const std::shared_ptr<audio_source>& source);
+		void detach();
+		[[nodiscard]] bool is_attached() const;
+
+		// Reading side, one thread. The reference stays valid until the next poll().
+		const audio_analysis& poll();
+
+		[[nodiscard]] const analyzer_options& get_options() const;
+	private:
+		_audio_analyzer_data* m_data;
+	};
+}
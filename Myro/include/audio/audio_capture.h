@@ -1,13 +1,104 @@
 #pragma once
 
 #include "encoders/iencoder.h"
+#include "encoders/segmented_encoder.h"
 #include "audio_file_format.h"
+#include "audio_analyzer.h"
+#include "audio_source.h"
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace myro
 {
 	struct _audio_capture_data;
 
+	struct capture_statistics
+	{
+		uint64_t frames_captured = 0;	// frames delivered by the device
+		uint64_t frames_encoded = 0;	// frames handed to this encoder by its worker thread, at the encoder's rate
+		uint64_t dropped_frames = 0;	// frames lost because the ring buffer was full
+		uint64_t overruns = 0;			// device callbacks that had to drop frames
+		uint64_t underruns = 0;			// device callbacks that delivered no input
+		uint64_t gated_frames = 0;		// frames the voice gate kept from this encoder
+		size_t buffered_frames = 0;		// device frames waiting for the encoder right now
+		size_t peak_buffered_frames = 0;	// as sampled by the encoder worker each time it wakes
+		size_t capacity_frames = 0;
+		float conversion_latency_ms = 0.0f;	// delay added by the sample rate converter, 0 when the encoder matches the device
+	};
+
+	enum class voice_gate_mode
+	{
+		skip,	// silent stretches are dropped; the recording only contains speech
+		gap		// silent stretches go to IEncoder::write_gap, keeping the timeline (DTX for Opus and Speex)
+	};
+
+	struct voice_gate_options
+	{
+		bool enabled = false;
+		float threshold_db = -45.0f;	// block RMS in dBFS that opens the gate
+		uint32_t block_ms = 10;			// analysis window
+		uint32_t hangover_ms = 500;		// how long the gate stays open after the level drops
+		uint32_t pre_roll_ms = 200;		// audio before the gate opened that is still recorded
+		voice_gate_mode mode = voice_gate_mode::gap;
+	};
+
+	struct capture_device_info
+	{
+		std::string name;
+		bool is_default = false;
+	};
+
+	enum class capture_performance_profile
+	{
+		low_latency,	// small periods, the backend's most responsive mode
+		conservative	// larger periods, fewer wakeups and glitches under load
+	};
+
+	enum class capture_share_mode
+	{
+		shared,
+		exclusive		// bypasses the OS mixer where the backend supports it (WASAPI), lowest latency
+	};
+
+	struct capture_device_options
+	{
+		std::string device_name;		// empty = system default, otherwise a name from get_capture_devices()
+		uint32_t period_frames = 0;		// 0 = backend default; takes precedence over period_ms
+		uint32_t period_ms = 0;			// 0 = backend default
+		uint32_t period_count = 0;		// 0 = backend default
+		capture_performance_profile profile = capture_performance_profile::low_latency;
+		capture_share_mode share_mode = capture_share_mode::shared;
+	};
+
+	// What the backend actually granted, which can differ from the request.
+	struct capture_device_latency
+	{
+		std::string device_name;
+		uint32_t sample_rate = 0;
+		uint32_t period_frames = 0;
+		uint32_t period_count = 0;
+		float period_ms = 0.0f;			// delay between a sample arriving and the callback seeing it
+		float buffer_ms = 0.0f;			// all periods together
+	};
+
+	struct monitor_options
+	{
+		uint32_t buffer_ms = 20;	// captured audio kept ahead of the mixer; more survives more scheduling jitter
+		float gain = 1.0f;
+	};
+
+	struct monitor_statistics
+	{
+		float capture_period_ms = 0.0f;	// input device period
+		float buffered_ms = 0.0f;		// captured audio waiting for the mixer right now
+		float output_ms = 0.0f;			// OpenAL's output latency
+		float total_ms = 0.0f;			// microphone to speaker
+		uint64_t underruns = 0;			// mixer pulls that ran out of captured audio
+		uint64_t overruns = 0;			// device callbacks that found the ring full and dropped frames
+		uint64_t trimmed_frames = 0;	// frames skipped to keep the latency bounded when the two clocks drift
+	};
+
 	class audio_capture
 	{
 	public:
@@ -20,19 +111,65 @@ namespace myro
 		audio_capture& operator=(audio_capture&&) = delete;
 
 		bool init(const std::shared_ptr<IEncoder>& encoder);
+		// Feeds one device stream to every encoder. The device runs at its native rate and channel count;
+		// each encoder gets its own converter, so encoders may use any (and differing) formats.
+		// If the device or a converter cannot be set up, every encoder is finalized (deinit) before returning false.
+		bool init(const std::vector<std::shared_ptr<IEncoder>>& encoders);
 		bool init(const std::filesystem::path& output_filepath, uint32_t sample_rate, uint32_t channels);
 		bool init(const std::filesystem::path& output_filepath, audio_file_format format, uint32_t sample_rate, uint32_t channels);
+		// Continuous recording cut into fixed length files, see segmented_encoder.
+		bool init_segmented(const segmented_encoder_options& options, uint32_t sample_rate, uint32_t channels);
 		void deinit(bool deinit_device = true);
 
+		// Attaches another encoder to the running stream. Only allowed while the capture is stopped.
+		bool add_encoder(const std::shared_ptr<IEncoder>& encoder);
+		// Meters the captured stream at the device format, see audio_analyzer. The analyzer takes an encoder
+		// slot (it counts in get_encoder_count / get_statistics) and gets its own ring and worker, so the
+		// device callback only pays for one more ring write. Needs an initialized, stopped capture.
+		bool add_analyzer(const std::shared_ptr<audio_analyzer>& analyzer);
+		[[nodiscard]] size_t get_encoder_count() const;
+		[[nodiscard]] std::shared_ptr<IEncoder> get_encoder(size_t index) const;
+
 		bool start() const;
 		void stop() const;
 
-	protected:
-		void write(const short* pcm_frames, size_t frame_count) const;
+		static std::vector<capture_device_info> get_capture_devices();
+
+		// Device selection and period tuning. Takes effect on the next init.
+		void set_device_options(const capture_device_options& options);
+		[[nodiscard]] const capture_device_options& get_device_options() const;
+		// Valid after init; also logged every time the device is opened.
+		[[nodiscard]] capture_device_latency get_device_latency() const;
+
+		// Size of each encoder's ring buffer between the device callback and its worker thread.
+		// Takes effect on the next init. Default: 2000 ms.
+		void set_buffer_duration(uint32_t milliseconds);
+		[[nodiscard]] uint32_t get_buffer_duration() const;
+
+		// Optional energy gate in front of every encoder, run on the encoder's worker thread.
+		// Applies to encoders attached afterwards (init / add_encoder). Disabled by default.
+		void set_voice_gate(const voice_gate_options& options);
+		[[nodiscard]] const voice_gate_options& get_voice_gate() const;
+
+		[[nodiscard]] capture_statistics get_statistics(size_t encoder_index = 0) const;
+
+		// Plays the captured stream back through OpenAL while capturing. Needs an active audio_engine
+		// and an initialized capture; can be toggled while the capture runs.
+		bool start_monitoring(const monitor_options& options = {});
+		void stop_monitoring();
+		[[nodiscard]] bool is_monitoring() const;
+		// The playback source, e.g. to change its gain or attach effects. nullptr while not monitoring.
+		[[nodiscard]] std::shared_ptr<audio_source> get_monitor_source() const;
+		[[nodiscard]] monitor_statistics get_monitor_statistics() const;
+
+		// The device's native format, valid after init.
+		[[nodiscard]] uint32_t get_device_sample_rate() const;
+		[[nodiscard]] uint16_t get_device_channels() const;
+
 	private:
 		bool init_device();
+		bool add_sink(const std::shared_ptr<IEncoder>& encoder, bool gated = true);
 		
 		_audio_capture_data* m_data;
-		std::shared_ptr<IEncoder> m_encoder;
 	};
 }
\ No newline at end of file
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <initializer_list>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "audio_source.h"
 
@@ -20,9 +24,89 @@ namespace myro
 		ring_modulator
 	};
 
+	// Each parameter belongs to one effect type.
+	enum class effect_param : uint8_t
+	{
+		reverb_decay_time,
+		reverb_density,
+		reverb_diffusion,
+		reverb_gain,
+		reverb_gain_hf,
+		echo_delay,
+		echo_lr_delay,
+		echo_damping,
+		echo_feedback,
+		chorus_rate,
+		chorus_depth,
+		chorus_feedback,
+		distortion_edge,
+		distortion_gain,
+		distortion_lowpass_cutoff,
+		flanger_rate,
+		flanger_depth,
+		flanger_feedback,
+		equalizer_low_gain,
+		equalizer_mid_gain,
+		equalizer_high_gain,
+		frequency_shifter_frequency,
+		frequency_shifter_direction,
+		autowah_attack_time,
+		autowah_release_time,
+		autowah_resonance,
+		ring_modulator_frequency,
+		ring_modulator_highpass_cutoff
+	};
+
+	// How much of a source reaches a bus. gain_hf below 1 low-passes the send only, the dry signal is untouched.
+	struct bus_send
+	{
+		float gain = 1.0f;
+		float gain_hf = 1.0f;
+	};
+
+	// An EFX effect in its own auxiliary slot. Sources attach to it through auxiliary sends (up to
+	// ALC_MAX_AUXILIARY_SENDS per source, openal_backend requests 4), and any number of sources can
+	// share one instance. set_param updates the effect in place, so modulating it every frame
+	// creates no OpenAL objects.
+	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+	class audio_effect_instance
+	{
+	public:
+		static std::shared_ptr<audio_effect_instance> create(audio_effect type) { return std::make_shared<audio_effect_instance>(type); }
+
+		explicit audio_effect_instance(audio_effect type);
+		~audio_effect_instance();
+
+		audio_effect_instance(const audio_effect_instance&) = delete;
+		audio_effect_instance& operator=(const audio_effect_instance&) = delete;
+
+		// False when the parameter belongs to another effect type.
+		bool set_param(effect_param param, float value);
+		void set_gain(float gain);
+
+		// Attaching an attached source again only updates its send.
+		bool attach(const std::shared_ptr<audio_source>& source, const bus_send& send = {});
+		void detach(const std::shared_ptr<audio_source>& source);
+		void detach_all();
+
+		audio_effect get_type() const { return m_type; }
+		bool is_valid() const { return m_slot != 0; }
+		size_t get_attached_count() const { return m_sources.size(); }
+	private:
+		void detach(uint32_t source_handle);
+
+		uint32_t m_slot = 0;
+		uint32_t m_effect = 0;
+		audio_effect m_type = audio_effect::unknown;
+		std::vector<uint32_t> m_sources;
+
+		friend class audio_effect_manager;
+	};
+
 	class audio_effect_manager
 	{
 	public:
+		// Each source keeps one instance per effect type: applying a type again updates its parameters in place.
 		static void apply_reverb(const std::shared_ptr<audio_source>& source, float decay_time, float density);
 		static void apply_echo(const std::shared_ptr<audio_source>& source, float delay, float damping);
 		static void apply_chorus(const std::shared_ptr<audio_source>& source, float rate, float depth, float feedback);
@@ -34,5 +118,27 @@ namespace myro
 		static void apply_ring_modulator(const std::shared_ptr<audio_source>& source, float frequency, float highpass_cutoff);
 
 		static void remove_effect(const std::shared_ptr<audio_source>& source, audio_effect type);
+		// The instance apply_* made for this source and type, or null.
+		static std::shared_ptr<audio_effect_instance> get_effect(const std::shared_ptr<audio_source>& source, audio_effect type);
+
+		// Named effect buses: instances registered under a name, so a room full of emitters costs a single reverb.
+		static bool create_bus(const std::string& name, audio_effect type);
+		static void destroy_bus(const std::string& name);
+		static bool has_bus(const std::string& name);
+		static std::shared_ptr<audio_effect_instance> get_bus(const std::string& name);
+		static bool set_bus_param(const std::string& name, effect_param param, float value);
+		static void set_bus_gain(const std::string& name, float gain);
+
+		static bool attach_to_bus(const std::shared_ptr<audio_source>& source, const std::string& name, const bus_send& send = {});
+		static void detach_from_bus(const std::shared_ptr<audio_source>& source, const std::string& name);
+	private:
+		static void apply_effect(const std::shared_ptr<audio_source>& source, audio_effect type, std::initializer_list<std::pair<effect_param, float>> params, const char* name);
+
+		// Frees the source's sends and its apply_* instances; called by audio_source::unload.
+		static void release_source(uint32_t source_handle);
+		static void shutdown();
+
+		friend class audio_source;
+		friend class audio_engine;
 	};
-}
\ No newline at end of file
+}
@@ -6,10 +6,21 @@
 
 #include "audio_source.h"
 #include "audio_state.h"
+#include "engine_stats.h"
 #include "core/buffer.h"
 
 namespace myro
 {
+	class dsp_chain;
+
+	// Samples decoded without creating a source, see audio_engine::decode_audio_file.
+	struct decoded_audio
+	{
+		std::vector<short> samples;	// interleaved 16-bit
+		uint32_t sample_rate = 0;
+		uint16_t channels = 0;
+	};
+
 	class audio_engine
 	{
 	public:
@@ -22,14 +33,28 @@ namespace myro
 		static uint32_t get_thread_count();
 		static uint32_t get_max_thread_count();
 
-		static std::shared_ptr<audio_source> load_audio_source(const std::filesystem::path& filepath);
-		static std::vector<std::shared_ptr<audio_source>> multi_load_audio_source(const std::vector<std::filesystem::path>& filepaths);
+		// bake renders the chain into the samples before they are uploaded (dsp_chain::bake), so the
+		// sound plays without any runtime processing. multi_load_audio_source bakes on the pool workers.
+		// A clip that fails to bake is not loaded: null, or a null entry from multi_load_audio_source.
+		static std::shared_ptr<audio_source> load_audio_source(const std::filesystem::path& filepath, const std::shared_ptr<const dsp_chain>& bake = nullptr);
+		static std::vector<std::shared_ptr<audio_source>> multi_load_audio_source(const std::vector<std::filesystem::path>& filepaths, const std::shared_ptr<const dsp_chain>& bake = nullptr);
 
 		static void unload_audio_source(const std::shared_ptr<audio_source>& source);
 		static void multi_unload_audio_source(const std::vector<std::shared_ptr<audio_source>>& sources);
 
 		static void cleanup_expired_sources();
 
+		// Runs the same loaders as load_audio_source but keeps the samples on the CPU, e.g. for impulse responses.
+		static std::shared_ptr<decoded_audio> decode_audio_file(const std::filesystem::path& filepath);
+
+		// Keeps a copy of the decoded samples on every source loaded afterwards, so an audio_analyzer
+		// can follow its playback. Costs the size of the PCM per source. Off by default.
+		static void set_retain_pcm(bool retain);
+		static bool get_retain_pcm();
+
+		// Counters and histograms for monitoring; cheap enough to sample every frame. See engine_stats.h for export.
+		static engine_stats get_stats();
+
 		static void play(const std::shared_ptr<audio_source>& source);
 		static void stop(const std::shared_ptr<audio_source>& source);
 		static void pause(const std::shared_ptr<audio_source>& source);
@@ -41,6 +66,11 @@ namespace myro
 
 		static audio_state state_of(const std::shared_ptr<audio_source>& source);
 	private:
-		static std::shared_ptr<audio_source> load_audio_source_al(raw_buffer buf);
+		// baked replaces the decoded samples when it is not empty.
+		static std::shared_ptr<audio_source> load_audio_source_al(raw_buffer buf, std::vector<short> baked);
+		// Sources made outside the loaders, e.g. a reverb's output, are unloaded on shutdown too.
+		static void track_source(const std::shared_ptr<audio_source>& source);
+
+		friend class convolution_reverb;
 	};
 }
\ No newline at end of file
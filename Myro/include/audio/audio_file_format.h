@@ -20,4 +20,6 @@ namespace myro
 
 	audio_file_format get_file_format(const std::filesystem::path& filepath);
 	audio_file_format get_file_format(const std::string& filepath);
+	// ".wav", ".flac", ... or an empty string for unknown.
+	std::string get_file_extension(audio_file_format format);
 }
\ No newline at end of file
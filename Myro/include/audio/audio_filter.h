@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "audio_source.h"
 
@@ -13,11 +14,65 @@ namespace myro
 		high_pass_filter
 	};
 
+	enum class filter_param : uint8_t
+	{
+		gain,
+		gain_hf,	// low-pass only
+		gain_lf		// high-pass only
+	};
+
+	// An EFX filter used as the direct filter of any number of sources. Sources copy filter
+	// parameters, so set_param re-applies the same object to each of them instead of making new ones.
+	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+	class audio_filter_instance
+	{
+	public:
+		static std::shared_ptr<audio_filter_instance> create(audio_filter type) { return std::make_shared<audio_filter_instance>(type); }
+
+		explicit audio_filter_instance(audio_filter type);
+		~audio_filter_instance();
+
+		audio_filter_instance(const audio_filter_instance&) = delete;
+		audio_filter_instance& operator=(const audio_filter_instance&) = delete;
+
+		// False when the parameter does not belong to the filter type.
+		bool set_param(filter_param param, float value);
+
+		// Replaces whatever direct filter the source had.
+		bool apply(const std::shared_ptr<audio_source>& source);
+		void remove(const std::shared_ptr<audio_source>& source);
+		void remove_all();
+
+		audio_filter get_type() const { return m_type; }
+		bool is_valid() const { return m_filter != 0; }
+		size_t get_applied_count() const { return m_sources.size(); }
+	private:
+		void remove(uint32_t source_handle);
+
+		uint32_t m_filter = 0;
+		audio_filter m_type = audio_filter::unknown;
+		std::vector<uint32_t> m_sources;
+
+		friend class audio_filter_manager;
+	};
+
 	class audio_filter_manager
 	{
 	public:
+		// Each source keeps one filter instance: applying again updates it in place.
 		static void apply_low_pass_filter(const std::shared_ptr<audio_source>& source, float gain, float gainHF);
 		static void apply_high_pass_filter(const std::shared_ptr<audio_source>& source, float gain, float gainLF);
 		static void remove_filter(const std::shared_ptr<audio_source>& source, audio_filter type);
+		// The instance apply_* made for this source, or null.
+		static std::shared_ptr<audio_filter_instance> get_filter(const std::shared_ptr<audio_source>& source);
+	private:
+		static void apply_filter(const std::shared_ptr<audio_source>& source, audio_filter type, filter_param second_param, float gain, float second_gain);
+
+		// Drops the source's filter bookkeeping; called by audio_source::unload.
+		static void release_source(uint32_t source_handle);
+		static void shutdown();
+
+		friend class audio_source;
+		friend class audio_engine;
 	};
-}
\ No newline at end of file
+}
@@ -5,6 +5,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace myro 
 {
@@ -43,6 +44,8 @@ namespace myro
 		timestamp get_timestamp() const;
 
 		bool is_loaded() const { return m_loaded; }
+		// True when the decoded samples were kept at load time, see audio_engine::set_retain_pcm.
+		bool has_pcm() const { return m_pcm != nullptr; }
 
 		static std::shared_ptr<audio_source> load_from_file(const std::filesystem::path& filepath, bool spitial = false);
 	private:
@@ -54,6 +57,7 @@ namespace myro
 		bool m_loaded = false;
 
 		float m_total_duration = 0.0f; // in seconds
+		uint64_t m_buffer_bytes = 0; // PCM uploaded to the AL buffer, 0 for sources not loaded by the engine
 
 		// attributes
 		vec3 m_position;
@@ -62,8 +66,20 @@ namespace myro
 		bool m_loop = false;
 		bool m_spitial = false;
 
+		// Interleaved 16-bit copy of the buffer, only kept when audio_engine::set_retain_pcm is on.
+		std::shared_ptr<const std::vector<short>> m_pcm;
+		uint32_t m_sample_rate = 0;
+		uint16_t m_channels = 0;
+
 		friend class audio_engine;
+		friend class audio_capture;
 		friend class audio_effect_manager;
 		friend class audio_filter_manager;
+		friend class audio_effect_instance;
+		friend class audio_filter_instance;
+		friend struct _audio_analyzer_data;
+		friend class audio_analyzer;
+		friend class dsp_chain;
+		friend class convolution_reverb;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "dsp_chain.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+namespace myro
+{
+	struct _convolution_reverb_data;
+	struct _convolution_send_data;
+
+	struct convolution_reverb_options
+	{
+		uint32_t block_frames = 256;		// power of two; the head partition, and the latency of the wet signal
+		uint32_t max_partition = 16384;		// largest FFT partition used for the tail of long responses
+		uint32_t latency_ms = 40;			// wet audio rendered ahead of OpenAL
+		uint32_t sample_rate = 0;			// 0 runs at the response's own rate; otherwise it is resampled
+		bool normalize = true;				// scale the response to unit energy
+		float gain = 1.0f;					// of the wet output source
+	};
+
+	// Feeds a source into a convolution_reverb. Add it to the source's dsp_chain: it passes the audio
+	// through untouched and copies a mono mix of it to the reverb. One chain per send. It has no
+	// clone(): an offline copy would feed the live reverb, so a chain holding a send cannot be baked.
+	class convolution_send : public dsp_node
+	{
+	public:
+		explicit convolution_send(std::shared_ptr<_convolution_send_data> data) : m_data(std::move(data)) {}
+
+		void set_gain(float gain);
+		[[nodiscard]] float get_gain() const;
+
+		void prepare(uint32_t sample_rate, uint16_t channels) override;
+		void process(float* samples, size_t frames) override;
+		void reset() override {}
+	private:
+		std::shared_ptr<_convolution_send_data> m_data;
+		uint16_t m_channels = 0;
+		bool m_rate_matches = false;
+	};
+
+	// Convolution with a measured impulse response, loaded through the regular loaders. It works as a
+	// bus: any number of sources feed it through convolution_send nodes, a worker thread of its own
+	// mixes them and runs one partitioned FFT convolution per response channel, and the wet signal
+	// plays on an output source of its own.
+	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+	class convolution_reverb
+	{
+	public:
+		static std::shared_ptr<convolution_reverb> create(const std::filesystem::path& impulse_response, const convolution_reverb_options& options = {})
+		{
+			return std::make_shared<convolution_reverb>(impulse_response, options);
+		}
+
+		convolution_reverb(const std::filesystem::path& impulse_response, const convolution_reverb_options& options);
+		~convolution_reverb();
+
+		convolution_reverb(const convolution_reverb&) = delete;
+		convolution_reverb& operator=(const convolution_reverb&) = delete;
+
+		[[nodiscard]] bool is_valid() const;
+
+		// Sends must run at the reverb's sample rate; others are ignored with a warning.
+		std::shared_ptr<convolution_send> create_send(float gain = 1.0f);
+
+		// The non-spatial source playing the wet signal; set its gain, or apply EFX filters to it.
+		[[nodiscard]] std::shared_ptr<audio_source> get_output() const;
+		[[nodiscard]] uint32_t get_sample_rate() const;
+		[[nodiscard]] uint16_t get_channels() const;
+		[[nodiscard]] float get_length() const;	// of the response, in seconds
+
+		[[nodiscard]] dsp_chain_stats get_stats() const;
+	private:
+		_convolution_reverb_data* m_data;
+	};
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "audio_source.h"
+#include "core/histogram.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace myro
+{
+	struct _dsp_chain_data;
+
+	// A block processor in a dsp_chain. Samples are interleaved floats in [-1, 1].
+	// process() runs on the chain's worker; setters on the nodes below may be called from any thread.
+	class dsp_node
+	{
+	public:
+		virtual ~dsp_node() = default;
+
+		virtual void prepare(uint32_t sample_rate, uint16_t channels) = 0;
+		virtual void process(float* samples, size_t frames) = 0;
+		// Clears filter and envelope state, e.g. when playback starts over.
+		virtual void reset() = 0;
+		// Same settings, fresh state; lets a chain bake on several threads at once. Null when the node
+		// cannot be copied, which makes its chains unbakeable.
+		[[nodiscard]] virtual std::shared_ptr<dsp_node> clone() const { return nullptr; }
+	};
+
+	enum class biquad_type : uint8_t
+	{
+		low_pass,
+		high_pass,
+		band_pass,
+		notch,
+		peaking,
+		low_shelf,
+		high_shelf
+	};
+
+	// RBJ cookbook biquad. gain_db only matters for peaking and the shelves.
+	class biquad_node : public dsp_node
+	{
+	public:
+		static std::shared_ptr<biquad_node> create(biquad_type type, float frequency, float q = 0.7071f, float gain_db = 0.0f)
+		{
+			return std::make_shared<biquad_node>(type, frequency, q, gain_db);
+		}
+
+		biquad_node(biquad_type type, float frequency, float q, float gain_db);
+
+		void set(biquad_type type, float frequency, float q, float gain_db);
+		void set_frequency(float frequency);
+		void set_gain_db(float gain_db);
+
+		void prepare(uint32_t sample_rate, uint16_t channels) override;
+		void process(float* samples, size_t frames) override;
+		void reset() override;
+		[[nodiscard]] std::shared_ptr<dsp_node> clone() const override;
+	private:
+		void update_coefficients();
+
+		std::atomic<biquad_type> m_type;
+		std::atomic<float> m_frequency;
+		std::atomic<float> m_q;
+		std::atomic<float> m_gain_db;
+		std::atomic<bool> m_dirty{ true };
+
+		uint32_t m_sample_rate = 48000;
+		uint16_t m_channels = 0;
+		float m_coefficients[5] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+		std::vector<float> m_z1;
+		std::vector<float> m_z2;
+	};
+
+	// Feed-forward peak compressor; the detector is linked across channels so the stereo image holds.
+	class compressor_node : public dsp_node
+	{
+	public:
+		static std::shared_ptr<compressor_node> create(float threshold_db, float ratio, float attack_ms = 5.0f, float release_ms = 80.0f, float makeup_db = 0.0f)
+		{
+			return std::make_shared<compressor_node>(threshold_db, ratio, attack_ms, release_ms, makeup_db);
+		}
+		// Infinite ratio and instant attack: nothing leaves above ceiling_db.
+		static std::shared_ptr<compressor_node> limiter(float ceiling_db = -0.3f, float release_ms = 50.0f)
+		{
+			return create(ceiling_db, 0.0f, 0.0f, release_ms);
+		}
+
+		// ratio <= 0 means infinity.
+		compressor_node(float threshold_db, float ratio, float attack_ms, float release_ms, float makeup_db);
+
+		void set(float threshold_db, float ratio, float attack_ms, float release_ms, float makeup_db);
+		// Current gain reduction, in dB (>= 0).
+		[[nodiscard]] float get_reduction_db() const { return m_reduction_db.load(std::memory_order_relaxed); }
+
+		void prepare(uint32_t sample_rate, uint16_t channels) override;
+		void process(float* samples, size_t frames) override;
+		void reset() override;
+		[[nodiscard]] std::shared_ptr<dsp_node> clone() const override;
+	private:
+		std::atomic<float> m_threshold_db;
+		std::atomic<float> m_ratio;
+		std::atomic<float> m_attack_ms;
+		std::atomic<float> m_release_ms;
+		std::atomic<float> m_makeup_db;
+		std::atomic<float> m_reduction_db{ 0.0f };
+
+		uint32_t m_sample_rate = 48000;
+		uint16_t m_channels = 0;
+		float m_envelope_db = 0.0f;	// smoothed gain reduction
+	};
+
+	// Runs user code on each block. Clones share the callback, so a baked chain may run it on several
+	// threads at once.
+	class callback_node : public dsp_node
+	{
+	public:
+		using callback = std::function<void(float* samples, size_t frames, uint16_t channels)>;
+
+		static std::shared_ptr<callback_node> create(callback fn) { return std::make_shared<callback_node>(std::move(fn)); }
+
+		explicit callback_node(callback fn) : m_callback(std::move(fn)) {}
+
+		void prepare(uint32_t /*sample_rate*/, uint16_t channels) override { m_channels = channels; }
+		void process(float* samples, size_t frames) override
+		{
+			if (m_callback)
+				m_callback(samples, frames, m_channels);
+		}
+		void reset() override {}
+		[[nodiscard]] std::shared_ptr<dsp_node> clone() const override { return create(m_callback); }
+	private:
+		callback m_callback;
+		uint16_t m_channels = 0;
+	};
+
+	struct dsp_chain_options
+	{
+		uint32_t block_frames = 256;	// frames per process() call
+		uint32_t latency_ms = 40;		// processed audio kept ahead of OpenAL
+		uint32_t bake_tail_ms = 0;		// silence rendered after the clip by bake(), for reverb and delay tails
+	};
+
+	struct dsp_chain_stats
+	{
+		uint64_t blocks = 0;
+		uint64_t underruns = 0;			// OpenAL asked for more than the worker had ready
+		double cpu_load = 0.0;			// processing time / audio time, 1.0 = one core kept busy
+		histogram block_time_us;		// one process() pass over every node
+	};
+
+	// Software processing between a source's samples and OpenAL. Attached, a worker thread renders
+	// the source's retained PCM through the nodes in blocks, and OpenAL pulls the result through an
+	// AL_SOFT_callback_buffer. Nodes can also be run offline with process().
+	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+	class dsp_chain
+	{
+	public:
+		static std::shared_ptr<dsp_chain> create(const dsp_chain_options& options = {}) { return std::make_shared<dsp_chain>(options); }
+
+		explicit dsp_chain(const dsp_chain_options& options);
+		~dsp_chain();
+
+		dsp_chain(const dsp_chain&) = delete;
+		dsp_chain& operator=(const dsp_chain&) = delete;
+
+		// Nodes run in the order they were added. Safe while attached, also from a node's own callback;
+		// the edit takes effect from the next block.
+		void add(const std::shared_ptr<dsp_node>& node);
+		void remove(const std::shared_ptr<dsp_node>& node);
+		void clear();
+
+		// Offline use: prepare once, then process blocks of any size on one thread. Not while attached.
+		void prepare(uint32_t sample_rate, uint16_t channels);
+		void process(float* samples, size_t frames);
+
+		// Renders interleaved 16-bit samples through copies of the nodes, in place; the chain itself is
+		// untouched, so one chain can bake on several threads. See also audio_engine::load_audio_source.
+		bool bake(std::vector<short>& samples, uint32_t sample_rate, uint16_t channels) const;
+		// Null when a node cannot be cloned.
+		[[nodiscard]] std::shared_ptr<dsp_chain> clone() const;
+
+		// The source must have been loaded with audio_engine::set_retain_pcm(true). Attaching stops
+		// the source; play it again afterwards. detach() puts the original buffer back. Unloading the
+		// source detaches the chain.
+		bool attach(const std::shared_ptr<audio_source>& source);
+		void detach();
+		[[nodiscard]] bool is_attached() const;
+
+		[[nodiscard]] dsp_chain_stats get_stats() const;
+		[[nodiscard]] const dsp_chain_options& get_options() const;
+	private:
+		// Detaches every chain attached to the source; called by audio_source::unload.
+		static void release_source(uint32_t source_handle);
+		// Chains attached to the source render from seconds on, before the source plays another frame;
+		// called by audio_engine's play, stop, rewind and seek.
+		static void restart_source(uint32_t source_handle, float seconds);
+
+		_dsp_chain_data* m_data;
+
+		friend class audio_source;
+		friend class audio_engine;
+	};
+}
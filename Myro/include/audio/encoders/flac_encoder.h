@@ -7,16 +7,26 @@ namespace myro
 {
 	struct _flac_encoder_data;
 
+	struct flac_encoder_options
+	{
+		uint32_t compression_level = 5;	// 0 (fastest) .. 8 (smallest)
+		bool verify = true;				// decode every frame back and compare; roughly doubles CPU cost
+		uint32_t blocksize = 0;			// 0 = chosen by the compression level
+		uint16_t bits_per_sample = 16;	// 16 or 24
+		uint32_t thread_count = 1;		// > 1 opts into libFLAC 1.5+ multithreading, 0 = one per hardware thread
+	};
+
 	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
 	class flac_encoder : public IEncoder
 	{
 	public:
-		static std::shared_ptr<flac_encoder> create() { return std::make_shared<flac_encoder>(); }
+		static std::shared_ptr<flac_encoder> create(const flac_encoder_options& options = {}) { return std::make_shared<flac_encoder>(options); }
 
-		flac_encoder();
+		explicit flac_encoder(const flac_encoder_options& options = {});
 		~flac_encoder() override;
 
-		bool init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels) override;
+		using IEncoder::init;
+		bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels) override;
 		void deinit() override;
 
 		[[nodiscard]] bool initialized() const override;
@@ -24,8 +34,16 @@ namespace myro
 		[[nodiscard]] uint32_t get_sample_rate() const override;
 		[[nodiscard]] uint16_t get_channels() const override;
 		[[nodiscard]] uint16_t get_bits_per_sample() const override;
-	private:
+
+		using IEncoder::write;
 		void write(const short* pcm_frames, size_t frame_count) override;
+		void write(const float* pcm_frames, size_t frame_count) override;
+		void write(const int32_t* const* channels, size_t frame_count) override;
+
+		// Takes effect on the next init.
+		void set_options(const flac_encoder_options& options);
+		[[nodiscard]] const flac_encoder_options& get_options() const;
+	private:
 		void deinit_impl();
 		
 		friend class audio_capture;
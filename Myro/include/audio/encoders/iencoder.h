@@ -1,16 +1,68 @@
 #pragma once
 
+#include "output_sink.h"
+#include "audio/audio_file_format.h"
+
 #include <filesystem>
+#include <memory>
+#include <vector>
 
 namespace myro
 {
+    enum class encoder_output_mode
+    {
+        container,      // the codec's normal file format (Ogg, FLAC, WAV, ...)
+        raw_packets     // bare codec packets through IOutputSink::write_packet, no container framing
+    };
+
+    enum class bitrate_mode
+    {
+        codec_default,  // whatever the encoder did before options existed
+        vbr,            // quality driven variable bitrate
+        cbr,            // constant bitrate
+        abr             // variable bitrate averaging to `bitrate` (Opus: constrained VBR)
+    };
+
+    // Shared tuning knobs. Encoders ignore what their codec does not support and
+    // leave "unset" fields (0 / negative) at the codec's own default.
+    struct encoder_options
+    {
+        bitrate_mode mode = bitrate_mode::codec_default;
+        uint32_t bitrate = 0;           // bits per second, used by cbr / abr and as the Opus target
+        float quality = -1.0f;          // 0.0 (smallest) .. 1.0 (best), used by vbr
+        int complexity = -1;            // 0 (cheapest) .. 10 (slowest, best)
+        float frame_duration_ms = 0.0f; // Opus: 2.5, 5, 10, 20, 40 or 60
+        bool dtx = false;               // discontinuous transmission during silence (Opus, Speex)
+        bool fec = false;               // in-band forward error correction (Opus)
+        uint32_t packet_loss_percent = 0; // expected loss the FEC is tuned for (Opus)
+    };
+
     // NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
     class IEncoder
     {
     public:
         virtual ~IEncoder() = default;
 
-        virtual bool init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels) = 0;
+        bool init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels)
+        {
+            std::shared_ptr<async_file_output_sink> sink = async_file_output_sink::create(output_filepath);
+            return sink && init(sink, sample_rate, channels);
+        }
+
+        bool init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels, const encoder_options& options)
+        {
+            set_encoder_options(options);
+            return init(output_filepath, sample_rate, channels);
+        }
+
+        bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels, const encoder_options& options)
+        {
+            set_encoder_options(options);
+            return init(sink, sample_rate, channels);
+        }
+
+        // The encoder keeps the sink until deinit(), which flushes and closes it.
+        virtual bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels) = 0;
         virtual void deinit() = 0;
 
         [[nodiscard]] virtual bool initialized() const = 0;
@@ -19,13 +71,54 @@ namespace myro
         [[nodiscard]] virtual uint16_t get_channels() const = 0;
         [[nodiscard]] virtual uint16_t get_bits_per_sample() const = 0;
 
-        [[nodiscard]] explicit operator bool() const 
-        { 
-            return initialized(); 
-        }
-    protected:
+        // Encodes interleaved 16-bit frames. audio_capture drives this from the device,
+        // but it can also be fed directly (offline rendering, benchmarks, ...).
         virtual void write(const short* pcm_frames, size_t frame_count) = 0;
 
-        friend class audio_capture;
+        // Interleaved float frames in [-1, 1].
+        virtual void write(const float* pcm_frames, size_t frame_count);
+
+        // Planar input: channels[c] points at frame_count samples of channel c.
+        // int32 samples are right aligned at get_bits_per_sample() (e.g. +-8388608 for 24-bit).
+        virtual void write(const float* const* channels, size_t frame_count);
+        virtual void write(const int32_t* const* channels, size_t frame_count);
+
+        // Marks frame_count frames of silence the caller chose not to send, e.g. a closed voice gate.
+        // The default encodes digital silence; codecs with discontinuous transmission emit their
+        // cheap silence packets instead, so the timeline is kept at almost no cost.
+        virtual void write_gap(size_t frame_count);
+
+        [[nodiscard]] virtual bool supports_raw_packets() const { return false; }
+
+        // Takes effect on the next init.
+        bool set_output_mode(encoder_output_mode mode)
+        {
+            if (mode == encoder_output_mode::raw_packets && !supports_raw_packets())
+                return false;
+
+            m_output_mode = mode;
+            return true;
+        }
+
+        [[nodiscard]] encoder_output_mode get_output_mode() const { return m_output_mode; }
+
+        // Takes effect on the next init.
+        void set_encoder_options(const encoder_options& options) { m_options = options; }
+        [[nodiscard]] const encoder_options& get_encoder_options() const { return m_options; }
+
+        [[nodiscard]] explicit operator bool() const
+        {
+            return initialized();
+        }
+    protected:
+        encoder_output_mode m_output_mode = encoder_output_mode::container;
+        encoder_options m_options;
+    private:
+        // Only used by the converting fallbacks above; encoders with a native path never touch them.
+        std::vector<short> m_short_scratch;
+        std::vector<float> m_float_scratch;
     };
-}
\ No newline at end of file
+
+    // Default configured encoder for a container format, or nullptr for unknown.
+    std::shared_ptr<IEncoder> create_encoder(audio_file_format format);
+}
@@ -16,7 +16,8 @@ namespace myro
         mp3_encoder();
         ~mp3_encoder() override;
 
-        bool init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels) override;
+        using IEncoder::init;
+        bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels) override;
         void deinit() override;
 
         [[nodiscard]] bool initialized() const override;
@@ -25,10 +26,13 @@ namespace myro
         [[nodiscard]] uint16_t get_channels() const override;
         [[nodiscard]] uint16_t get_bits_per_sample() const override;
 
-    protected:
+        using IEncoder::write;
         void write(const short* pcm_frames, size_t frame_count) override;
+        void write(const float* pcm_frames, size_t frame_count) override;
+        void write(const float* const* channels, size_t frame_count) override;
 
     private:
+        void write_encoded(int bytes_written);
         void deinit_impl();
 
         _mp3_encoder_data* m_data = nullptr;
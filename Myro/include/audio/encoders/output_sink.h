@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace myro
+{
+    // Byte destination for encoders. Encoders only need write(); seek() is used when available
+    // to patch headers (WAV sizes, FLAC STREAMINFO) once the stream is finished.
+    // NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+    class IOutputSink
+    {
+    public:
+        virtual ~IOutputSink() = default;
+
+        virtual bool write(const void* data, size_t size) = 0;
+        virtual bool seek(uint64_t /*position*/) { return false; }
+        [[nodiscard]] virtual uint64_t tell() const = 0;
+        [[nodiscard]] virtual bool can_seek() const { return false; }
+
+        virtual void flush() {}
+        virtual void close() {}
+
+        // Receives one encoded packet in encoder_output_mode::raw_packets.
+        // The default frames every packet as a 4 byte little endian length followed by the payload.
+        virtual bool write_packet(const void* data, size_t size, int64_t granule_position);
+    };
+
+    class file_output_sink : public IOutputSink
+    {
+    public:
+        // Returns nullptr if the file could not be opened.
+        static std::shared_ptr<file_output_sink> create(const std::filesystem::path& path);
+
+        explicit file_output_sink(FILE* file) : m_file(file) {}
+        ~file_output_sink() override;
+
+        file_output_sink(const file_output_sink&) = delete;
+        file_output_sink& operator=(const file_output_sink&) = delete;
+        file_output_sink(file_output_sink&&) = delete;
+        file_output_sink& operator=(file_output_sink&&) = delete;
+
+        bool write(const void* data, size_t size) override;
+        bool seek(uint64_t position) override;
+        [[nodiscard]] uint64_t tell() const override { return m_position; }
+        [[nodiscard]] bool can_seek() const override { return m_file != nullptr; }
+
+        void flush() override;
+        void close() override;
+    private:
+        FILE* m_file = nullptr;
+        uint64_t m_position = 0;
+    };
+
+    struct _async_file_output_sink_data;
+
+    // When the sink forces data to the disk (fflush + fsync). Until then it sits in stdio's buffer
+    // or the OS cache, and a crash or power loss can take it with it.
+    enum class flush_policy
+    {
+        on_close,       // only on flush() and close()
+        periodic,       // additionally every flush_interval_ms, handing partial blocks to the writer too
+        every_block     // after every block the writer thread writes
+    };
+
+    struct async_file_options
+    {
+        size_t block_size = 1 << 20;        // at least 4 KiB
+        uint32_t block_count = 2;           // blocks in flight; 2 = double buffering
+        flush_policy policy = flush_policy::periodic;
+        uint32_t flush_interval_ms = 1000;
+    };
+
+    // File sink that copies writes into large blocks and hands full blocks to a background
+    // writer thread, so a slow disk only stalls the encoder once every block is in flight.
+    // The default sink for IEncoder::init(path, ...).
+    class async_file_output_sink : public IOutputSink
+    {
+    public:
+        // Returns nullptr if the file could not be opened.
+        static std::shared_ptr<async_file_output_sink> create(const std::filesystem::path& path, const async_file_options& options = {});
+
+        async_file_output_sink(FILE* file, const async_file_options& options);
+        ~async_file_output_sink() override;
+
+        async_file_output_sink(const async_file_output_sink&) = delete;
+        async_file_output_sink& operator=(const async_file_output_sink&) = delete;
+        async_file_output_sink(async_file_output_sink&&) = delete;
+        async_file_output_sink& operator=(async_file_output_sink&&) = delete;
+
+        bool write(const void* data, size_t size) override;
+        // Drains all pending blocks first, so it is meant for header patching, not random access.
+        bool seek(uint64_t position) override;
+        [[nodiscard]] uint64_t tell() const override;
+        [[nodiscard]] bool can_seek() const override;
+
+        void flush() override;
+        void close() override;
+    private:
+        _async_file_output_sink_data* m_data;
+    };
+
+    // Growable in-memory buffer. Seekable, so encoders produce exactly the same bytes as a file.
+    class memory_output_sink : public IOutputSink
+    {
+    public:
+        static std::shared_ptr<memory_output_sink> create(size_t reserve_bytes = 0) { return std::make_shared<memory_output_sink>(reserve_bytes); }
+
+        explicit memory_output_sink(size_t reserve_bytes = 0) { m_buffer.reserve(reserve_bytes); }
+
+        bool write(const void* data, size_t size) override;
+        bool seek(uint64_t position) override;
+        [[nodiscard]] uint64_t tell() const override { return m_position; }
+        [[nodiscard]] bool can_seek() const override { return true; }
+
+        [[nodiscard]] const std::vector<uint8_t>& data() const { return m_buffer; }
+        [[nodiscard]] size_t size() const { return m_buffer.size(); }
+
+        // Moves the encoded bytes out and resets the sink.
+        std::vector<uint8_t> take();
+    private:
+        std::vector<uint8_t> m_buffer;
+        uint64_t m_position = 0;
+    };
+
+    // Forwards bytes (and optionally whole packets) to user code, e.g. a socket or an IPC queue.
+    // Not seekable, so container headers are written in their streaming form.
+    class callback_output_sink : public IOutputSink
+    {
+    public:
+        using write_callback = std::function<bool(const void* data, size_t size)>;
+        using packet_callback = std::function<bool(const void* data, size_t size, int64_t granule_position)>;
+        using close_callback = std::function<void()>;
+
+        static std::shared_ptr<callback_output_sink> create(write_callback on_write, packet_callback on_packet = nullptr, close_callback on_close = nullptr)
+        {
+            return std::make_shared<callback_output_sink>(std::move(on_write), std::move(on_packet), std::move(on_close));
+        }
+
+        callback_output_sink(write_callback on_write, packet_callback on_packet, close_callback on_close)
+            : m_on_write(std::move(on_write)), m_on_packet(std::move(on_packet)), m_on_close(std::move(on_close)) {}
+
+        bool write(const void* data, size_t size) override;
+        [[nodiscard]] uint64_t tell() const override { return m_position; }
+
+        void close() override;
+
+        bool write_packet(const void* data, size_t size, int64_t granule_position) override;
+    private:
+        write_callback m_on_write;
+        packet_callback m_on_packet;
+        close_callback m_on_close;
+        uint64_t m_position = 0;
+    };
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "iencoder.h"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace myro
+{
+	struct _segmented_encoder_data;
+
+	struct segmented_encoder_options
+	{
+		std::filesystem::path directory;			// where segments are written, created if missing
+		std::string base_name = "segment";			// files are named <base_name>_000000<extension>; numbering continues after existing files
+		audio_file_format format = audio_file_format::wav;	// file extension, and the codec unless encoder_factory is set
+		uint32_t segment_duration_ms = 60000;
+		uint32_t retention_count = 0;				// closed segments to keep on disk, counting earlier sessions' files; 0 = keep all
+
+		// Optional: builds the encoder for each segment (e.g. with custom options). Defaults to create_encoder(format).
+		std::function<std::shared_ptr<IEncoder>()> encoder_factory;
+		// Optional: called on the rotation thread once a segment is finalized and readable.
+		std::function<void(const std::filesystem::path&)> on_segment_closed;
+	};
+
+	// Cuts one continuous stream into fixed length files. The next segment is opened ahead of
+	// time on a worker thread, and finished segments are finalized there too, so a rollover on
+	// the writing thread is only a pointer swap and no frame is lost across the cut.
+	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+	class segmented_encoder : public IEncoder
+	{
+	public:
+		static std::shared_ptr<segmented_encoder> create(const segmented_encoder_options& options) { return std::make_shared<segmented_encoder>(options); }
+
+		explicit segmented_encoder(const segmented_encoder_options& options);
+		~segmented_encoder() override;
+
+		bool init(unsigned int sample_rate, unsigned int channels);
+		// Segments open their own files; a single sink cannot be segmented. Always fails.
+		bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels) override;
+		void deinit() override;
+
+		[[nodiscard]] bool initialized() const override;
+
+		[[nodiscard]] uint32_t get_sample_rate() const override;
+		[[nodiscard]] uint16_t get_channels() const override;
+		[[nodiscard]] uint16_t get_bits_per_sample() const override;
+
+		using IEncoder::write;
+		void write(const short* pcm_frames, size_t frame_count) override;
+		void write(const float* pcm_frames, size_t frame_count) override;
+		void write_gap(size_t frame_count) override;
+
+		[[nodiscard]] uint64_t get_segment_index() const;
+		// Rollovers whose new file could not be opened. The stream then stays in the current segment,
+		// which grows past segment_duration_ms until a later attempt succeeds.
+		[[nodiscard]] uint64_t get_rotation_failures() const;
+		[[nodiscard]] std::filesystem::path get_segment_path(uint64_t index) const;
+		[[nodiscard]] const segmented_encoder_options& get_options() const;
+	private:
+		// Calls write_part(IEncoder&, first_frame, frame_count) once per segment the frames fall into.
+		template <class WritePart>
+		void write_segmented(size_t frame_count, WritePart&& write_part);
+		bool rotate();
+
+		_segmented_encoder_data* m_data;
+	};
+}
@@ -16,7 +16,8 @@ namespace myro
         speex_encoder();
         ~speex_encoder() override;
 
-        bool init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels) override;
+        using IEncoder::init;
+        bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels) override;
         void deinit() override;
 
         [[nodiscard]] bool initialized() const override;
@@ -25,10 +26,19 @@ namespace myro
         [[nodiscard]] uint16_t get_channels() const override;
         [[nodiscard]] uint16_t get_bits_per_sample() const override;
 
-    protected:
+        using IEncoder::write;
         void write(const short* pcm_frames, size_t frame_count) override;
+        void write_gap(size_t frame_count) override;
+
+        [[nodiscard]] bool supports_raw_packets() const override { return true; }
 
     private:
+        void configure_encoder();
+        void encode_frame(const short* frame, bool end_of_stream);
+        int encode(const short* frame);
+        void emit_packet(const char* packet, int bytes, bool end_of_stream);
+        void write_silence_frame();
+        void set_dtx(bool enabled);
         void flush_ogg_pages(bool force_flush);
         void deinit_impl();
 
@@ -16,7 +16,8 @@ namespace myro
         vorbis_encoder();
         ~vorbis_encoder() override;
 
-        bool init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels) override;
+        using IEncoder::init;
+        bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels) override;
         void deinit() override;
 
         [[nodiscard]] bool initialized() const override;
@@ -25,8 +26,11 @@ namespace myro
         [[nodiscard]] uint16_t get_channels() const override;
         [[nodiscard]] uint16_t get_bits_per_sample() const override;
 
-    protected:
+        using IEncoder::write;
         void write(const short* pcm_frames, size_t frame_count) override;
+        void write(const float* pcm_frames, size_t frame_count) override;
+        void write(const float* const* channels, size_t frame_count) override;
+        void write(const int32_t* const* channels, size_t frame_count) override;
 
     private:
         void flush_ogg_pages();
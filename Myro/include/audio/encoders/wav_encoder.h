@@ -2,34 +2,67 @@
 
 #include "iencoder.h"
 #include <memory>
+#include <vector>
 
 namespace myro
 {
+	enum class wav_sample_format
+	{
+		pcm16,
+		pcm24,
+		float32
+	};
+
+	struct wav_encoder_options
+	{
+		wav_sample_format format = wav_sample_format::pcm16;
+	};
+
+	// Writes classic RIFF/WAVE and switches the header to RF64 (EBU Tech 3306) when the
+	// data outgrows 4 GB. The switch needs a seekable sink; streamed output keeps the
+	// "unknown length" sizes either way. 24-bit and more than two channels are written as
+	// WAVE_FORMAT_EXTENSIBLE with the usual speaker mask; float output gets a fact chunk.
 	class wav_encoder : public IEncoder
 	{
 	public:
-		static std::shared_ptr<wav_encoder> create() { return std::make_shared<wav_encoder>(); }
+		static std::shared_ptr<wav_encoder> create(const wav_encoder_options& options = {}) { return std::make_shared<wav_encoder>(options); }
 
-		bool init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels) override;
+		explicit wav_encoder(const wav_encoder_options& options = {}) : m_options(options) {}
+
+		using IEncoder::init;
+		bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels) override;
 		void deinit() override;
 
 		[[nodiscard]] bool initialized() const override;
 
 		[[nodiscard]] uint32_t get_sample_rate() const override { return m_sample_rate; }
 		[[nodiscard]] uint16_t get_channels() const override { return m_channels; }
-		[[nodiscard]] uint16_t get_bits_per_sample() const override { return m_bits_per_sample; }
-	private:
+		[[nodiscard]] uint16_t get_bits_per_sample() const override;
+
+		using IEncoder::write;
 		void write(const short* pcm_frames, size_t frame_count) override;
+		void write(const float* pcm_frames, size_t frame_count) override;
+		void write(const int32_t* const* channels, size_t frame_count) override;
+
+		// Takes effect on the next init.
+		void set_options(const wav_encoder_options& options) { m_options = options; }
+		[[nodiscard]] const wav_encoder_options& get_options() const { return m_options; }
+	private:
 		void write_header_placeholder();
 		void update_header();
+		void write_data(const void* bytes, size_t size);
 	private:
 		friend class audio_capture;
 
-		FILE* m_out_file = nullptr;
-		uint32_t m_data_bytes_written = 0;
+		std::shared_ptr<IOutputSink> m_sink;
+		wav_encoder_options m_options;
+		uint64_t m_data_bytes_written = 0;
 		uint32_t m_sample_rate = 0;
 		uint16_t m_channels = 0;
-		uint16_t m_bits_per_sample = 16;
-		char m_header[44]{0};
+		std::vector<uint8_t> m_conversion_buffer;
+		uint8_t m_header[116]{0};	// the largest layout: EXTENSIBLE fmt plus fact
+		size_t m_header_size = 0;
+		size_t m_fact_offset = 0;	// 0 without a fact chunk
+		size_t m_data_offset = 0;
 	};
-}
\ No newline at end of file
+}
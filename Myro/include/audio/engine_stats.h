@@ -0,0 +1,63 @@
+#pragma once
+
+#include "audio_file_format.h"
+#include "core/histogram.h"
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+namespace myro
+{
+	struct codec_stats
+	{
+		audio_file_format format = audio_file_format::unknown;
+		uint64_t loads = 0;
+		uint64_t failures = 0;
+		uint64_t bytes_decoded = 0;			// PCM produced by the decoder
+		histogram decode_time_us;
+	};
+
+	// Snapshot returned by audio_engine::get_stats(). Every field is read from relaxed atomics,
+	// so sampling it every frame is cheap; the fields are not one consistent cut.
+	struct engine_stats
+	{
+		double uptime_seconds = 0.0;		// since audio_engine::init
+
+		// Loading
+		uint64_t loads = 0;					// successful loads since init
+		double loads_per_second = 0.0;		// over the last second or so
+		std::array<codec_stats, 6> codecs;	// ogg, mp3, wav, flac, opus, spx
+		histogram upload_time_us;			// alBufferData and source setup
+
+		// Memory and sources
+		uint64_t resident_pcm_bytes = 0;	// PCM in the OpenAL buffers of loaded sources
+		uint64_t retained_pcm_bytes = 0;	// CPU copies kept by audio_engine::set_retain_pcm
+		uint64_t live_sources = 0;			// sources loaded through the engine and not unloaded yet
+		uint64_t al_sources = 0;			// OpenAL sources owned by Myro, including capture monitors
+		uint64_t tracked_sources = 0;		// entries in the engine's source list, expired ones included until cleanup_expired_sources
+
+		// Loader thread pool
+		uint32_t pool_threads = 0;
+		uint64_t pool_queue_depth = 0;
+		histogram pool_wait_time_us;		// enqueue until a worker starts the task
+
+		// Capture, summed over every audio_capture
+		uint64_t capture_overruns = 0;		// device callbacks that found an encoder ring full
+		uint64_t capture_dropped_frames = 0;
+		uint64_t encoder_backlog_frames = 0;	// device frames waiting for encoder workers, sampled by the workers
+		uint64_t peak_encoder_backlog_frames = 0;
+	};
+
+	enum class stats_format
+	{
+		text,
+		json
+	};
+
+	[[nodiscard]] std::string to_text(const engine_stats& stats);
+	[[nodiscard]] std::string to_json(const engine_stats& stats);
+	// Overwrites the file, so a monitoring agent can poll it.
+	bool write_stats(const std::filesystem::path& path, const engine_stats& stats, stats_format format = stats_format::json);
+}
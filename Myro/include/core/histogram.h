@@ -0,0 +1,86 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+namespace myro
+{
+	// Power of two buckets: bucket 0 counts zeros, bucket i > 0 counts values in [2^(i-1), 2^i).
+	struct histogram
+	{
+		static constexpr size_t bucket_count = 32;
+
+		std::array<uint64_t, bucket_count> buckets{};
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+
+		static constexpr uint64_t bucket_upper_bound(size_t index) { return index == 0 ? 0 : (uint64_t{ 1 } << index) - 1; }
+
+		[[nodiscard]] double mean() const { return count > 0 ? static_cast<double>(sum) / static_cast<double>(count) : 0.0; }
+
+		// Upper bound of the bucket holding the given fraction (0..1) of the values, capped at max.
+		[[nodiscard]] uint64_t percentile(double fraction) const
+		{
+			if (count == 0)
+				return 0;
+
+			const uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(fraction * static_cast<double>(count) + 0.5), 1);
+			uint64_t seen = 0;
+			for (size_t i = 0; i < bucket_count; ++i)
+			{
+				seen += buckets[i];
+				if (seen >= target)
+					return std::min(bucket_upper_bound(i), max);
+			}
+			return max;
+		}
+	};
+
+	// Lock-free recorder for a histogram: a few relaxed atomic adds per value, from any thread.
+	class atomic_histogram
+	{
+	public:
+		void record(uint64_t value)
+		{
+			const size_t index = std::min<size_t>(std::bit_width(value), histogram::bucket_count - 1);
+			m_buckets[index].fetch_add(1, std::memory_order_relaxed);
+			m_count.fetch_add(1, std::memory_order_relaxed);
+			m_sum.fetch_add(value, std::memory_order_relaxed);
+
+			uint64_t max = m_max.load(std::memory_order_relaxed);
+			while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+			{
+			}
+		}
+
+		// Not atomic as a whole; concurrent records may be partly included.
+		[[nodiscard]] histogram snapshot() const
+		{
+			histogram result;
+			for (size_t i = 0; i < histogram::bucket_count; ++i)
+				result.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+			result.count = m_count.load(std::memory_order_relaxed);
+			result.sum = m_sum.load(std::memory_order_relaxed);
+			result.max = m_max.load(std::memory_order_relaxed);
+			return result;
+		}
+
+		void reset()
+		{
+			for (auto& bucket : m_buckets)
+				bucket.store(0, std::memory_order_relaxed);
+			m_count.store(0, std::memory_order_relaxed);
+			m_sum.store(0, std::memory_order_relaxed);
+			m_max.store(0, std::memory_order_relaxed);
+		}
+	private:
+		std::array<std::atomic<uint64_t>, histogram::bucket_count> m_buckets{};
+		std::atomic<uint64_t> m_count{ 0 };
+		std::atomic<uint64_t> m_sum{ 0 };
+		std::atomic<uint64_t> m_max{ 0 };
+	};
+}
@@ -1,11 +1,29 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <filesystem>
 
 #include "utility/formatter.h"
+#include "log_record.h"
 #include "base.h"
 
+// Levels below MYRO_LOG_MIN_LEVEL are compiled out entirely (set through the MYRO_LOG_MIN_LEVEL CMake option).
+// These are severities, not the level_ bits: debug sits below info here.
+#define MYRO_LOG_LEVEL_TRACE	0
+#define MYRO_LOG_LEVEL_DEBUG	1
+#define MYRO_LOG_LEVEL_INFO		2
+#define MYRO_LOG_LEVEL_WARN		3
+#define MYRO_LOG_LEVEL_ERROR	4
+#define MYRO_LOG_LEVEL_CRITICAL	5
+#define MYRO_LOG_LEVEL_OFF		6
+
+#ifndef MYRO_LOG_MIN_LEVEL
+	#define MYRO_LOG_MIN_LEVEL MYRO_LOG_LEVEL_TRACE
+#endif
+
 namespace myro
 {
 	class log
@@ -20,58 +38,115 @@ namespace myro
 			level_error = constants::bit<4>,
 			level_critical = constants::bit<5>
 		};
-		
+
+		// Format strings are checked against the arguments at compile time, and nothing is evaluated
+		// for a disabled level. Enabled messages are queued as binary records on a lock-free ring of the
+		// calling thread and formatted and written by a background thread, so logging never waits for
+		// I/O (a full ring drops the record and counts it instead). critical() is written synchronously.
 		template <class... Args>
-		static void trace(const std::string& message, Args... args)
+		static void trace(format_string<Args...> message, const Args&... args)
 		{
-			std::string formatted_msg = formatter::format(message, std::forward<Args>(args)...);
-			_trace(formatted_msg);
+			write<level_trace>(message, args...);
 		}
 
 		template <class... Args>
-		static void info(const std::string& message, Args... args)
+		static void info(format_string<Args...> message, const Args&... args)
 		{
-			std::string formatted_msg = formatter::format(message, std::forward<Args>(args)...);
-			_info(formatted_msg);
+			write<level_info>(message, args...);
 		}
 
 		template <class... Args>
-		static void debug(const std::string& message, Args... args)
+		static void debug(format_string<Args...> message, const Args&... args)
 		{
-			std::string formatted_msg = formatter::format(message, std::forward<Args>(args)...);
-			_debug(formatted_msg);
+			write<level_debug>(message, args...);
 		}
 
 		template <class... Args>
-		static void warn(const std::string& message, Args... args)
+		static void warn(format_string<Args...> message, const Args&... args)
 		{
-			std::string formatted_msg = formatter::format(message, std::forward<Args>(args)...);
-			_warn(formatted_msg);
+			write<level_warn>(message, args...);
 		}
 
 		template <class... Args>
-		static void error(const std::string& message, Args... args)
+		static void error(format_string<Args...> message, const Args&... args)
 		{
-			std::string formatted_msg = formatter::format(message, std::forward<Args>(args)...);
-			_error(formatted_msg);
+			write<level_error>(message, args...);
 		}
 
 		template <class... Args>
-		static void critical(const std::string& message, Args... args)
+		static void critical(format_string<Args...> message, const Args&... args)
 		{
-			std::string formatted_msg = formatter::format(message, std::forward<Args>(args)...);
-			_critical(formatted_msg);
+			write<level_critical>(message, args...);
 		}
 
 		static void set_logger_activity(uint8_t active_log_levels);
-		static bool is_logger_active(level_ level);
+		static bool is_logger_active(level_ level)
+		{
+			return s_active_log_levels.load(std::memory_order_relaxed) & static_cast<uint8_t>(level);
+		}
+
+		// Registers the calling thread's queue (one allocation and a lock), which otherwise happens on
+		// its first log call. Realtime threads can call this up front.
+		static void prepare_thread();
+		// Blocks until everything logged so far has been written.
+		static void flush();
+		// Records lost to full queues since the start.
+		static uint64_t get_dropped_count();
 	private:
-		static void _trace(const std::string& message);
-		static void _info(const std::string& message);
-		static void _debug(const std::string& message);
-		static void _warn(const std::string& message);
-		static void _error(const std::string& message);
-		static void _critical(const std::string& message);
+		// The MYRO_LOG_LEVEL_* severity of a level.
+		static constexpr int severity(level_ level)
+		{
+			switch (level)
+			{
+			case level_trace: return MYRO_LOG_LEVEL_TRACE;
+			case level_debug: return MYRO_LOG_LEVEL_DEBUG;
+			case level_info: return MYRO_LOG_LEVEL_INFO;
+			case level_warn: return MYRO_LOG_LEVEL_WARN;
+			case level_error: return MYRO_LOG_LEVEL_ERROR;
+			case level_critical: return MYRO_LOG_LEVEL_CRITICAL;
+			}
+			return MYRO_LOG_LEVEL_OFF;
+		}
+
+		template <level_ Level, class... Args>
+		static void write(format_string<Args...> message, const Args&... args)
+		{
+			if constexpr (severity(Level) >= MYRO_LOG_MIN_LEVEL)
+			{
+				if (!is_logger_active(Level))
+					return;
+
+				if constexpr (Level == level_critical)
+				{
+					// Usually followed by a break or abort, so it must not sit in a queue.
+					format_buffer buffer;
+					write_now(Level, formatter::format_to(buffer, message, args...));
+				}
+				else
+				{
+					constexpr size_t fixed_size = (size_t{ 0 } + ... + detail::log_arg<Args>::fixed_size);
+					static_assert(fixed_size <= log_record::max_payload, "Too many log arguments");
+
+					std::array<uint8_t, sizeof(log_record) + log_record::max_payload> staging;
+					detail::log_payload_writer payload(staging.data() + sizeof(log_record), log_record::max_payload - fixed_size);
+					(detail::log_arg<Args>::encode(payload, args), ...);
+
+					log_record record;
+					record.decode = &detail::decode_log_record<Args...>;
+					record.format = message.get().data();
+					record.format_size = static_cast<uint32_t>(message.get().size());
+					record.payload_size = static_cast<uint32_t>(payload.size());
+					record.level = static_cast<uint8_t>(Level);
+					enqueue(record, staging.data(), sizeof(log_record) + payload.size());
+				}
+			}
+		}
+
+		// staging holds size bytes: room for the header, then the payload. Stamps and copies the header.
+		static void enqueue(log_record& record, uint8_t* staging, size_t size);
+		static void write_now(level_ level, std::string_view message);
+
+		static inline std::atomic<uint8_t> s_active_log_levels{ 0 };
 	};
 }
 
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "utility/formatter.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace myro
+{
+	// A log call on its way from the calling thread to the log thread: this header, then the
+	// arguments in binary form. Scalars are stored raw and strings are copied; formatting
+	// happens on the log thread through decode.
+	struct log_record
+	{
+		using decode_fn = void (*)(const uint8_t* payload, std::string_view format, format_buffer& out);
+
+		static constexpr size_t max_payload = 1024;
+
+		int64_t timestamp = 0;		// steady clock, nanoseconds
+		decode_fn decode = nullptr;
+		const char* format = nullptr;	// format strings are literals, so the pointer outlives the record
+		uint32_t format_size = 0;
+		uint32_t payload_size = 0;
+		uint8_t level = 0;
+	};
+
+	namespace detail
+	{
+		class log_payload_writer
+		{
+		public:
+			log_payload_writer(uint8_t* out, size_t string_budget) : m_out(out), m_string_budget(string_budget) {}
+
+			void raw(const void* value, size_t size)
+			{
+				std::memcpy(m_out + m_size, value, size);
+				m_size += size;
+			}
+
+			// Long strings are cut so the record never outgrows log_record::max_payload.
+			void string(std::string_view text)
+			{
+				const uint32_t length = static_cast<uint32_t>(std::min(text.size(), m_string_budget));
+				m_string_budget -= length;
+				raw(&length, sizeof(length));
+				raw(text.data(), length);
+			}
+
+			[[nodiscard]] size_t size() const { return m_size; }
+		private:
+			uint8_t* m_out;
+			size_t m_size = 0;
+			size_t m_string_budget;
+		};
+
+		template <class T>
+		inline constexpr bool log_arg_is_raw = std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+			(std::is_pointer_v<T> && !std::is_convertible_v<T, std::string_view>);
+
+		template <class T>
+		struct log_arg
+		{
+			static constexpr bool raw = log_arg_is_raw<T>;
+			static constexpr size_t fixed_size = raw ? sizeof(T) : sizeof(uint32_t);
+
+			using decoded = std::conditional_t<raw, T, std::string_view>;
+
+			static void encode(log_payload_writer& out, const T& value)
+			{
+				if constexpr (raw)
+				{
+					out.raw(&value, sizeof(T));
+				}
+				else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+				{
+					out.string(std::string_view(value));
+				}
+				else if constexpr (std::is_same_v<T, std::filesystem::path> && std::is_same_v<std::filesystem::path::value_type, char>)
+				{
+					out.string(value.native());
+				}
+				else
+				{
+					// Everything else is formatted right away, since it may not outlive the call.
+					format_buffer text;
+					formatter::vformat_to(text, "{}", std::array{ formatter::make_argument(value) }.data(), 1);
+					out.string(text.view());
+				}
+			}
+
+			static decoded decode(const uint8_t*& in)
+			{
+				if constexpr (raw)
+				{
+					T value;
+					std::memcpy(&value, in, sizeof(T));
+					in += sizeof(T);
+					return value;
+				}
+				else
+				{
+					uint32_t length = 0;
+					std::memcpy(&length, in, sizeof(length));
+					in += sizeof(length);
+					const std::string_view text(reinterpret_cast<const char*>(in), length);
+					in += length;
+					return text;
+				}
+			}
+		};
+
+		template <class... Args>
+		void decode_log_record(const uint8_t* payload, std::string_view format, format_buffer& out)
+		{
+			if constexpr (sizeof...(Args) == 0)
+			{
+				formatter::vformat_to(out, format, nullptr, 0);
+			}
+			else
+			{
+				// Braced initialization evaluates left to right, matching the encoding order.
+				const std::tuple<typename log_arg<Args>::decoded...> values{ log_arg<Args>::decode(payload)... };
+				std::apply([&](const auto&... value)
+					{
+						const std::array<formatter::argument, sizeof...(Args)> arguments{ formatter::make_argument(value)... };
+						formatter::vformat_to(out, format, arguments.data(), arguments.size());
+					}, values);
+			}
+		}
+	}
+}
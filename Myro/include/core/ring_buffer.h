@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace myro
+{
+	// Wait-free single-producer / single-consumer ring buffer.
+	// Exactly one thread may write and exactly one thread may read at a time; allocate(),
+	// release() and reset() must only be called while neither side is active.
+	// Positions are monotonically increasing counters, so the capacity does not have to be
+	// a power of two (interleaved frames of any channel count never straddle the wrap point
+	// as long as the capacity and every transfer are multiples of the channel count).
+	template <class T>
+		requires std::is_trivially_copyable_v<T>
+	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+	class spsc_ring_buffer
+	{
+	public:
+		spsc_ring_buffer() = default;
+		explicit spsc_ring_buffer(size_t capacity) { allocate(capacity); }
+
+		spsc_ring_buffer(const spsc_ring_buffer&) = delete;
+		spsc_ring_buffer& operator=(const spsc_ring_buffer&) = delete;
+
+		void allocate(size_t capacity)
+		{
+			m_storage = capacity > 0 ? std::make_unique<T[]>(capacity) : nullptr;
+			m_capacity = capacity;
+			reset();
+		}
+
+		void release()
+		{
+			m_storage.reset();
+			m_capacity = 0;
+			reset();
+		}
+
+		void reset()
+		{
+			m_write_pos.store(0, std::memory_order_relaxed);
+			m_read_pos.store(0, std::memory_order_relaxed);
+		}
+
+		[[nodiscard]] size_t capacity() const { return m_capacity; }
+
+		// Elements currently readable. Exact on the consumer side, a lower bound elsewhere.
+		[[nodiscard]] size_t size() const
+		{
+			const uint64_t w = m_write_pos.load(std::memory_order_acquire);
+			const uint64_t r = m_read_pos.load(std::memory_order_acquire);
+			return static_cast<size_t>(w - r);
+		}
+
+		// Elements that can currently be written. Exact on the producer side.
+		[[nodiscard]] size_t write_available() const { return m_capacity - size(); }
+
+		// Producer side. Copies up to count elements and returns how many were written.
+		size_t write(const T* data, size_t count)
+		{
+			const uint64_t w = m_write_pos.load(std::memory_order_relaxed);
+			const uint64_t r = m_read_pos.load(std::memory_order_acquire);
+			const size_t n = std::min(count, m_capacity - static_cast<size_t>(w - r));
+			if (n == 0)
+				return 0;
+
+			const size_t index = static_cast<size_t>(w % m_capacity);
+			const size_t first = std::min(n, m_capacity - index);
+			std::memcpy(m_storage.get() + index, data, first * sizeof(T));
+			if (n > first)
+				std::memcpy(m_storage.get(), data + first, (n - first) * sizeof(T));
+
+			m_write_pos.store(w + n, std::memory_order_release);
+			return n;
+		}
+
+		// Consumer side. Hands up to max_count readable elements to visitor(const T*, size_t)
+		// as at most two contiguous regions without copying, then releases them.
+		template <class Visitor>
+		size_t read(size_t max_count, Visitor&& visitor)
+		{
+			const uint64_t r = m_read_pos.load(std::memory_order_relaxed);
+			const uint64_t w = m_write_pos.load(std::memory_order_acquire);
+			const size_t n = std::min(max_count, static_cast<size_t>(w - r));
+			if (n == 0)
+				return 0;
+
+			const size_t index = static_cast<size_t>(r % m_capacity);
+			const size_t first = std::min(n, m_capacity - index);
+			visitor(static_cast<const T*>(m_storage.get() + index), first);
+			if (n > first)
+				visitor(static_cast<const T*>(m_storage.get()), n - first);
+
+			m_read_pos.store(r + n, std::memory_order_release);
+			return n;
+		}
+
+		// Consumer side. Drops up to count readable elements and returns how many were dropped.
+		size_t skip(size_t count)
+		{
+			return read(count, [](const T*, size_t) {});
+		}
+
+		// Consumer side. Copies up to count elements into out.
+		size_t read(T* out, size_t count)
+		{
+			return read(count, [&out](const T* data, size_t n)
+				{
+					std::memcpy(out, data, n * sizeof(T));
+					out += n;
+				});
+		}
+
+	private:
+		std::unique_ptr<T[]> m_storage;
+		size_t m_capacity = 0;
+
+		alignas(64) std::atomic<uint64_t> m_write_pos{ 0 };
+		alignas(64) std::atomic<uint64_t> m_read_pos{ 0 };
+	};
+}
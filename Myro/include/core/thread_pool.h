@@ -8,6 +8,10 @@
 #include <future>
 #include <functional>
 #include <type_traits>
+#include <atomic>
+#include <chrono>
+
+#include "histogram.h"
 
 // NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
 class thread_pool 
@@ -76,6 +80,18 @@ public:
         return std::thread::hardware_concurrency();
     }
 
+    // Tasks waiting for a worker right now.
+    size_t queue_depth() const
+    {
+        return m_queue_depth.load(std::memory_order_relaxed);
+    }
+
+    // Time between enqueue and a worker picking the task up, in microseconds.
+    myro::histogram wait_times() const
+    {
+        return m_wait_times.snapshot();
+    }
+
     template<typename Func, typename... Args>
     auto enqueue(Func&& func, Args&&... args)-> std::future<std::invoke_result_t<Func, Args...>>
     {
@@ -98,7 +114,8 @@ public:
             if (m_stop)
                 throw std::runtime_error("thread_pool stopped");
 
-            m_tasks.emplace([task]() { (*task)(); });
+            m_tasks.push({ [task]() { (*task)(); }, clock::now() });
+            m_queue_depth.store(m_tasks.size(), std::memory_order_relaxed);
         }
         m_condition.notify_one();
         return res;
@@ -124,39 +141,24 @@ public:
     }
 
 private:
-    void worker_loop()
-    {
-        while (true)
-        {
-            std::function<void()> task;
-            {
-                std::unique_lock<std::mutex> lock(m_queue_mutex);
-                m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
-
-                if (m_stop && m_tasks.empty())
-                    return;
+    // Out of line, with the trace instrumentation, so MYRO_ENABLE_TRACING only matters to the library build.
+    void worker_loop();
 
-                task = std::move(m_tasks.front());
-                m_tasks.pop();
-            }
-
-            try
-            {
-                task();
-            }
-            catch (thread_stop)
-            {
-                return;
-            }
-        }
-    }
+private:
+    using clock = std::chrono::steady_clock;
 
+    struct queued_task
+    {
+        std::function<void()> run;
+        clock::time_point enqueued;
+    };
 
-private:
     std::vector<std::thread> m_workers;
-    std::queue<std::function<void()>> m_tasks;
+    std::queue<queued_task> m_tasks;
     std::mutex m_queue_mutex;
     std::condition_variable m_condition;
     uint32_t m_count;
     bool m_stop;
+    std::atomic<size_t> m_queue_depth{ 0 };
+    myro::atomic_histogram m_wait_times;
 };
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+
+#include "base.h"
+
+namespace myro
+{
+	// Scoped trace markers exported in the Chrome trace-event format (chrome://tracing, ui.perfetto.dev).
+	// MYRO_TRACE_SCOPE compiles to nothing unless MYRO_ENABLE_TRACING is defined (CMake option of the
+	// same name), and records only between start() and stop(). Every thread writes into a lock-free
+	// buffer of its own; a full buffer drops events, so long sessions should collect() now and then.
+	class trace
+	{
+	public:
+		static void start();
+		static void stop();
+		[[nodiscard]] static bool is_recording() { return s_recording.load(std::memory_order_relaxed); }
+
+		// Moves what the threads buffered into the session. write_chrome_trace does this too.
+		static void collect();
+		static bool write_chrome_trace(const std::filesystem::path& path);
+		static void clear();
+		[[nodiscard]] static uint64_t get_dropped_count();
+
+		// Allocates the calling thread's event buffer (about 384 KB), which otherwise happens on its
+		// first event or set_thread_name(). Realtime threads can call this up front.
+		static void prepare_thread();
+		// Shown as the track name. Takes a string literal.
+		static void set_thread_name(const char* name);
+
+		// Steady clock, nanoseconds.
+		[[nodiscard]] static int64_t now();
+		// name must be a string literal; events keep the pointer.
+		static void record(const char* name, int64_t start_ns, int64_t end_ns);
+
+		class scope
+		{
+		public:
+			explicit scope(const char* name) : m_name(name), m_start(is_recording() ? now() : -1) {}
+			~scope()
+			{
+				if (m_start >= 0)
+					record(m_name, m_start, now());
+			}
+
+			scope(const scope&) = delete;
+			scope& operator=(const scope&) = delete;
+			scope(scope&&) = delete;
+			scope& operator=(scope&&) = delete;
+		private:
+			const char* m_name;
+			int64_t m_start;
+		};
+	private:
+		static inline std::atomic<bool> s_recording{ false };
+	};
+}
+
+#ifdef MYRO_ENABLE_TRACING
+	#define MYRO_TRACE_SCOPE(name) ::myro::trace::scope MYRO_CONCATENATE(_myro_trace_scope_, __LINE__)(name)
+	#define MYRO_TRACE_THREAD_NAME(name) ::myro::trace::set_thread_name(name)
+	#define MYRO_TRACE_PREPARE_THREAD() ::myro::trace::prepare_thread()
+#else
+	#define MYRO_TRACE_SCOPE(name) ((void)0)
+	#define MYRO_TRACE_THREAD_NAME(name) ((void)0)
+	#define MYRO_TRACE_PREPARE_THREAD() ((void)0)
+#endif
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace myro
+{
+	// Wait-free single-producer / single-consumer "latest value" exchange.
+	// The producer fills write_buffer() and publishes it; the consumer always sees the most
+	// recently published value and never blocks the producer, however rarely it reads.
+	// for_each() must only be called while neither side is active.
+	template <class T>
+	// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+	class triple_buffer
+	{
+	public:
+		triple_buffer() = default;
+		triple_buffer(const triple_buffer&) = delete;
+		triple_buffer& operator=(const triple_buffer&) = delete;
+
+		template <class Func>
+		void for_each(Func&& func)
+		{
+			for (T& buffer : m_buffers)
+				func(buffer);
+		}
+
+		// Producer side.
+		T& write_buffer() { return m_buffers[m_back]; }
+
+		void publish()
+		{
+			m_back = m_middle.exchange(static_cast<uint8_t>(m_back | fresh_bit), std::memory_order_acq_rel) & index_mask;
+		}
+
+		// Consumer side. Returns the latest published value (or the previous one if nothing new arrived).
+		const T& read()
+		{
+			if (m_middle.load(std::memory_order_relaxed) & fresh_bit)
+				m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+
+			return m_buffers[m_front];
+		}
+
+	private:
+		static constexpr uint8_t fresh_bit = 0x4;
+		static constexpr uint8_t index_mask = 0x3;
+
+		T m_buffers[3]{};
+		uint8_t m_back = 0;
+		uint8_t m_front = 1;
+		alignas(64) std::atomic<uint8_t> m_middle{ 2 };
+	};
+}
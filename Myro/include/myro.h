@@ -2,6 +2,7 @@
 
 #include "core/log.h"
 #include "core/thread_pool.h"
+#include "core/trace.h"
 
 #include "math/vec3.h"
 
@@ -13,6 +14,9 @@
 #include "audio/audio_effect.h"
 #include "audio/audio_filter.h"
 #include "audio/audio_capture.h"
+#include "audio/audio_analyzer.h"
+#include "audio/dsp_chain.h"
+#include "audio/convolution_reverb.h"
 
 #include "audio/encoders/wav_encoder.h"
 #include "audio/encoders/flac_encoder.h"
\ No newline at end of file
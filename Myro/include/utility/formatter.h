@@ -1,147 +1,293 @@
 #pragma once
 
 #include <algorithm>
-#include <string>
+#include <array>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <ostream>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <utility>
-#include <vector>
-#include <iomanip>
 
 namespace myro
 {
-	class formatter
+	// Fixed size output for the formatter. Lives on the stack and truncates instead of allocating.
+	class format_buffer
 	{
 	public:
-		template <typename... Args>
-		[[nodiscard]] static std::string format(const std::string& fmt, Args&&... args)
+		static constexpr size_t capacity = 1024;
+
+		void append(std::string_view text)
 		{
-			if constexpr (sizeof...(Args) == 0)
-			{
-				return fmt;
-			}
+			const size_t n = std::min(text.size(), capacity - m_size);
+			std::memcpy(m_data.data() + m_size, text.data(), n);
+			m_size += n;
+		}
+
+		void append(char c, size_t count = 1)
+		{
+			const size_t n = std::min(count, capacity - m_size);
+			std::memset(m_data.data() + m_size, c, n);
+			m_size += n;
+		}
 
-			argument_array argArray;
-			transfer_to_array(argArray, std::forward<Args>(args)...);
-			size_t start = 0;
-			std::ostringstream oss;
-			while (true)
+		// Free space for writing in place (std::to_chars); commit() what was used.
+		[[nodiscard]] char* tail() { return m_data.data() + m_size; }
+		[[nodiscard]] char* end() { return m_data.data() + capacity; }
+		void commit(const char* new_tail) { m_size = static_cast<size_t>(new_tail - m_data.data()); }
+
+		// Right aligns everything written since `start` in a field of `width`.
+		void pad_front(size_t start, size_t width)
+		{
+			const size_t written = m_size - start;
+			if (written >= width)
+				return;
+
+			const size_t shift = std::min(width - written, capacity - m_size);
+			std::memmove(m_data.data() + start + shift, m_data.data() + start, written);
+			std::memset(m_data.data() + start, ' ', shift);
+			m_size += shift;
+		}
+
+		[[nodiscard]] size_t size() const { return m_size; }
+		[[nodiscard]] std::string_view view() const { return { m_data.data(), m_size }; }
+	private:
+		std::array<char, capacity> m_data;
+		size_t m_size = 0;
+	};
+
+	// A parsed replacement field: {index,alignment:spec}
+	struct format_spec
+	{
+		int alignment = 0;		// > 0 right aligned, < 0 left aligned, in that many columns
+		int precision = -1;		// ".N" in spec, fixed notation for floating point
+	};
+
+	namespace detail
+	{
+		// Shared by the compile-time check and the runtime formatter. Walks fmt and calls
+		// on_text(std::string_view) and on_field(index, format_spec); returns nullptr or an error.
+		template <class Text, class Field>
+		constexpr const char* parse_format(std::string_view fmt, size_t arg_count, Text&& on_text, Field&& on_field)
+		{
+			size_t next_auto = 0;
+			size_t i = 0;
+			while (i < fmt.size())
 			{
-				size_t pos = fmt.find('{', start);
-				if (pos == std::string::npos)
+				const size_t open = fmt.find_first_of("{}", i);
+				if (open == std::string_view::npos)
 				{
-					oss << fmt.substr(start);
+					on_text(fmt.substr(i));
 					break;
 				}
 
-				oss << fmt.substr(start, pos - start);
-				if (fmt[pos + 1] == '{')
+				on_text(fmt.substr(i, open - i));
+
+				// "{{" and "}}" are escapes; a lone '}' is taken literally.
+				const bool escaped = open + 1 < fmt.size() && fmt[open + 1] == fmt[open];
+				if (escaped || fmt[open] == '}')
 				{
-					oss << '{';
-					start = pos + 2;
+					on_text(fmt.substr(open, 1));
+					i = open + (escaped ? 2 : 1);
 					continue;
 				}
 
-				start = pos + 1;
-				pos = fmt.find('}', start);
-				if (pos == std::string::npos)
+				const size_t close = fmt.find('}', open);
+				if (close == std::string_view::npos)
+					return "unterminated '{' in format string";
+
+				std::string_view field = fmt.substr(open + 1, close - open - 1);
+				size_t index = 0;
+				size_t pos = 0;
+				if (pos < field.size() && field[pos] >= '0' && field[pos] <= '9')
 				{
-					oss << fmt.substr(start - 1);
-					break;
+					while (pos < field.size() && field[pos] >= '0' && field[pos] <= '9')
+						index = index * 10 + static_cast<size_t>(field[pos++] - '0');
+				}
+				else
+				{
+					index = next_auto++;
 				}
 
-				format_item(oss, fmt.substr(start, pos - start), argArray);
-				start = pos + 1;
+				format_spec spec;
+				if (pos < field.size() && field[pos] == ',')
+				{
+					++pos;
+					const bool negative = pos < field.size() && field[pos] == '-';
+					if (negative)
+						++pos;
+
+					int width = 0;
+					while (pos < field.size() && field[pos] >= '0' && field[pos] <= '9')
+						width = width * 10 + (field[pos++] - '0');
+					spec.alignment = negative ? -width : width;
+				}
+
+				if (pos < field.size() && field[pos] == ':')
+				{
+					++pos;
+					if (pos < field.size() && field[pos] == '.')
+					{
+						++pos;
+						spec.precision = 0;
+						while (pos < field.size() && field[pos] >= '0' && field[pos] <= '9')
+							spec.precision = spec.precision * 10 + (field[pos++] - '0');
+					}
+					pos = field.size(); // other specs are accepted and ignored
+				}
+
+				if (pos != field.size())
+					return "invalid replacement field in format string";
+				if (index >= arg_count)
+					return "format string refers to a missing argument";
+
+				on_field(index, spec);
+				i = close + 1;
 			}
 
-			return oss.str();
+			return nullptr;
 		}
 
-		template <typename... Args>
-		std::string operator()(const std::string& fmt, Args&&... args)
+		// Not constexpr: reaching it during constant evaluation turns a bad format string into a compile error.
+		inline void format_string_error(const char* message) { (void)message; }
+	}
+
+	// A format string checked against its arguments at compile time, like std::format_string.
+	template <class... Args>
+	class basic_format_string
+	{
+	public:
+		template <class S>
+			requires std::convertible_to<const S&, std::string_view>
+		consteval basic_format_string(const S& fmt) : m_fmt(fmt) // NOLINT(google-explicit-constructor)
 		{
-			return format(fmt, std::forward<Args>(args)...);
+			if (const char* error = detail::parse_format(m_fmt, sizeof...(Args), [](std::string_view) {}, [](size_t, format_spec) {}))
+				detail::format_string_error(error);
 		}
 
+		[[nodiscard]] constexpr std::string_view get() const { return m_fmt; }
 	private:
-		// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
-		struct argument_base
-		{
-			argument_base() = default;
-			virtual ~argument_base() = default;
-			virtual void format(std::ostringstream&, const std::string&) {}
-		};
-		
-		template <class T>
-		// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
-		class argument : public argument_base
-		{
-		public:
-			argument(T arg) : m_argument(std::move(arg)) {}
-
-			~argument() override = default;
+		std::string_view m_fmt;
+	};
 
-			void format(std::ostringstream& oss, const std::string& fmt) override
-			{
-				oss << m_argument;
-			}
+	template <class... Args>
+	using format_string = basic_format_string<std::type_identity_t<Args>...>;
 
-		private:
-			T m_argument;
+	class formatter
+	{
+	public:
+		// Type erased argument; points at the caller's object, nothing is copied.
+		struct argument
+		{
+			const void* value = nullptr;
+			void (*write)(format_buffer&, const void*, const format_spec&) = nullptr;
 		};
 
-		// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
-		class argument_array : public std::vector<argument_base*>
+		template <class... Args>
+		static std::string_view format_to(format_buffer& out, format_string<Args...> fmt, const Args&... args)
 		{
-		public:
-			argument_array() = default;
-			~argument_array()
+			if constexpr (sizeof...(Args) == 0)
 			{
-				std::ranges::for_each(begin(), end(), [](const argument_base* arg_ptr)->void { delete arg_ptr; });
+				vformat_to(out, fmt.get(), nullptr, 0);
 			}
-		};
-
-		static void format_item(std::ostringstream& oss, const std::string& item, const argument_array& arguments)
-		{
-			size_t index = 0;
-			std::string fmt;
-			char* endptr = nullptr;
-#if _WIN64
-			index = strtoull(item.data(), &endptr, 10);
-#else // !_WIN64
-			index = strtoul(&item[0], &endptr, 10);
-#endif // _WIN64
-
-			if (index < 0 || index >= arguments.size())
-				return;
-
-			if (*endptr == ',')
+			else
 			{
-				long long alignment = strtoll(endptr + 1, &endptr, 10);
-				if (alignment > 0)
-					oss << std::right << std::setw(alignment);
-				else if (alignment < 0)
-					oss << std::left << std::setw(-alignment);
+				const std::array<argument, sizeof...(Args)> arguments{ make_argument(args)... };
+				vformat_to(out, fmt.get(), arguments.data(), arguments.size());
 			}
+			return out.view();
+		}
 
-			if (*endptr == ':')
-				fmt = endptr + 1;
-
-			arguments[index]->format(oss, fmt);
+		template <class... Args>
+		[[nodiscard]] static std::string format(format_string<Args...> fmt, const Args&... args)
+		{
+			format_buffer buffer;
+			return std::string(format_to(buffer, fmt, args...));
 		}
 
-		static void transfer_to_array(argument_array& arg_array) { (void)arg_array; }
+		static void vformat_to(format_buffer& out, std::string_view fmt, const argument* arguments, size_t count)
+		{
+			detail::parse_format(fmt, count,
+				[&out](std::string_view text) { out.append(text); },
+				[&out, arguments](size_t index, const format_spec& spec)
+				{
+					const size_t start = out.size();
+					arguments[index].write(out, arguments[index].value, spec);
+
+					if (spec.alignment > 0)
+						out.pad_front(start, static_cast<size_t>(spec.alignment));
+					else if (spec.alignment < 0 && out.size() - start < static_cast<size_t>(-spec.alignment))
+						out.append(' ', static_cast<size_t>(-spec.alignment) - (out.size() - start));
+				});
+		}
 
 		template <class T>
-		static void transfer_to_array(argument_array& arg_array, T arg)
+		static argument make_argument(const T& value)
 		{
-			arg_array.push_back(new argument<T>(std::move(arg)));
+			return { &value, [](format_buffer& out, const void* ptr, const format_spec& spec) { write_value(out, *static_cast<const T*>(ptr), spec); } };
 		}
+	private:
 
-		template <class T, class... Args>
-		static void transfer_to_array(argument_array& arg_array, T arg, Args&&... args)
+		template <class T>
+		static void write_value(format_buffer& out, const T& value, const format_spec& spec)
 		{
-			transfer_to_array(arg_array, std::move(arg));
-			transfer_to_array(arg_array, std::forward<Args>(args)...);
+			if constexpr (std::is_same_v<T, bool>)
+			{
+				out.append(value ? '1' : '0');
+			}
+			else if constexpr (std::is_same_v<T, char>)
+			{
+				out.append(value);
+			}
+			else if constexpr (std::is_integral_v<T>)
+			{
+				const auto result = std::to_chars(out.tail(), out.end(), value);
+				if (result.ec == std::errc())
+					out.commit(result.ptr);
+			}
+			else if constexpr (std::is_floating_point_v<T>)
+			{
+				// Default matches iostreams: 6 significant digits.
+				const auto result = spec.precision >= 0
+					? std::to_chars(out.tail(), out.end(), value, std::chars_format::fixed, spec.precision)
+					: std::to_chars(out.tail(), out.end(), value, std::chars_format::general, 6);
+				if (result.ec == std::errc())
+					out.commit(result.ptr);
+			}
+			else if constexpr (std::is_enum_v<T>)
+			{
+				write_value(out, static_cast<std::underlying_type_t<T>>(value), spec);
+			}
+			else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+			{
+				out.append(std::string_view(value));
+			}
+			else if constexpr (std::is_same_v<T, std::filesystem::path>)
+			{
+				if constexpr (std::is_same_v<std::filesystem::path::value_type, char>)
+					out.append(std::string_view(value.native()));
+				else
+					out.append(value.string());
+			}
+			else if constexpr (std::is_pointer_v<T>)
+			{
+				out.append("0x");
+				const auto result = std::to_chars(out.tail(), out.end(), reinterpret_cast<uintptr_t>(value), 16);
+				if (result.ec == std::errc())
+					out.commit(result.ptr);
+			}
+			else
+			{
+				// Anything else goes through its operator<<, which may allocate.
+				std::ostringstream oss;
+				oss << value;
+				out.append(oss.view());
+			}
 		}
 	};
 }
@@ -0,0 +1,421 @@
+#include "audio/audio_analyzer.h"
+#include "core/log.h"
+#include "core/triple_buffer.h"
+
+#include "internal/fft.h"
+#include "internal/simd.h"
+
+#include <AL/al.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <numbers>
+#include <thread>
+
+namespace myro
+{
+	namespace
+	{
+		struct biquad
+		{
+			double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+		};
+
+		struct biquad_state
+		{
+			double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
+
+			double run(const biquad& f, double x)
+			{
+				const double y = f.b0 * x + f.b1 * x1 + f.b2 * x2 - f.a1 * y1 - f.a2 * y2;
+				x2 = x1;
+				x1 = x;
+				y2 = y1;
+				y1 = y;
+				return y;
+			}
+		};
+
+		// The two BS.1770 K-weighting stages, derived for any sample rate (the standard only lists 48 kHz).
+		biquad k_weighting_shelf(double sample_rate)
+		{
+			const double k = std::tan(std::numbers::pi * 1681.974450955533 / sample_rate);
+			const double q = 0.7071752369554196;
+			const double vh = std::pow(10.0, 3.999843853973347 / 20.0);
+			const double vb = std::pow(vh, 0.4996667741545416);
+			const double a0 = 1.0 + k / q + k * k;
+
+			return { (vh + vb * k / q + k * k) / a0, 2.0 * (k * k - vh) / a0, (vh - vb * k / q + k * k) / a0,
+				2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+		}
+
+		biquad k_weighting_high_pass(double sample_rate)
+		{
+			const double k = std::tan(std::numbers::pi * 38.13547087602444 / sample_rate);
+			const double q = 0.5003270373238773;
+			const double a0 = 1.0 + k / q + k * k;
+
+			return { 1.0, -2.0, 1.0, 2.0 * (k * k - 1.0) / a0, (1.0 - k / q + k * k) / a0 };
+		}
+
+		float power_to_db(double power)
+		{
+			if (power <= 0.0)
+				return audio_analysis::silence_db;
+
+			return std::max(static_cast<float>(10.0 * std::log10(power)), audio_analysis::silence_db);
+		}
+
+		constexpr size_t loudness_blocks = 4; // 4 x 100 ms = the 400 ms momentary window
+
+		using channel_weights = std::array<double, audio_analysis::max_channels>;
+
+		// BS.1770 channel weights for the WAVE channel orders: the LFE is left out, the surround and
+		// back channels count 1.41. Layouts up to three channels are all front channels.
+		channel_weights loudness_weights(uint16_t channels)
+		{
+			switch (channels)
+			{
+			case 4: return { 1.0, 1.0, 1.41, 1.41 };							// FL FR BL BR
+			case 5: return { 1.0, 1.0, 1.0, 1.41, 1.41 };						// FL FR FC BL BR
+			case 6: return { 1.0, 1.0, 1.0, 0.0, 1.41, 1.41 };					// FL FR FC LFE BL BR
+			case 7: return { 1.0, 1.0, 1.0, 0.0, 1.41, 1.41, 1.41 };			// FL FR FC LFE BC SL SR
+			case 8: return { 1.0, 1.0, 1.0, 0.0, 1.41, 1.41, 1.41, 1.41 };		// FL FR FC LFE BL BR SL SR
+			default:
+			{
+				channel_weights weights;
+				weights.fill(1.0);
+				return weights;
+			}
+			}
+		}
+	}
+
+	struct _audio_analyzer_data
+	{
+		analyzer_options options;
+
+		uint32_t sample_rate = 0;
+		uint16_t channels = 0;
+		uint16_t metered_channels = 0;
+
+		// Results are published every hop_frames.
+		size_t hop_frames = 0;
+		size_t hop_fill = 0;
+		std::array<float, audio_analysis::max_channels> peak{};
+		std::array<double, audio_analysis::max_channels> sum_squares{};
+		std::vector<float> planar;	// metered_channels x hop_frames, normalized
+		std::vector<float> mono;
+
+		// Spectrum of the last fft_size frames of the channel mix.
+		real_fft fft;
+		std::vector<float> window;
+		float spectrum_scale = 0.0f;
+		std::vector<float> history;
+		size_t history_pos = 0;
+		std::vector<float> fft_input;
+		std::vector<float> power;
+
+		// Momentary loudness.
+		biquad shelf;
+		biquad high_pass;
+		std::array<std::array<biquad_state, 2>, audio_analysis::max_channels> k_state{};
+		channel_weights loudness_weight{};
+		size_t block_frames = 0;
+		size_t block_fill = 0;
+		double block_energy = 0.0;
+		std::array<double, loudness_blocks> block_energies{};
+		size_t block_index = 0;
+		size_t block_count = 0;
+
+		uint64_t sequence = 0;
+		triple_buffer<audio_analysis> results;
+
+		// Source tap.
+		std::shared_ptr<audio_source> source;
+		std::thread follower;
+		std::atomic<bool> following{ false };
+		std::mutex follow_mutex;
+		std::condition_variable follow_wake;
+
+		void process_chunk(const short* pcm, size_t frame_count)
+		{
+			constexpr float scale = 1.0f / 32768.0f;
+			const float mix_scale = scale / static_cast<float>(channels);
+
+			for (size_t i = 0; i < frame_count; ++i)
+			{
+				const short* frame = pcm + i * channels;
+
+				float mix = 0.0f;
+				for (uint16_t c = 0; c < channels; ++c)
+					mix += static_cast<float>(frame[c]);
+				mono[i] = mix * mix_scale;
+
+				for (uint16_t c = 0; c < metered_channels; ++c)
+				{
+					const float sample = static_cast<float>(frame[c]) * scale;
+					planar[c * hop_frames + i] = sample;
+
+					const double weighted = k_state[c][1].run(high_pass, k_state[c][0].run(shelf, sample));
+					block_energy += loudness_weight[c] * weighted * weighted;
+				}
+
+				if (++block_fill == block_frames)
+				{
+					block_energies[block_index] = block_energy / static_cast<double>(block_frames);
+					block_index = (block_index + 1) % loudness_blocks;
+					block_count = std::min(block_count + 1, loudness_blocks);
+					block_energy = 0.0;
+					block_fill = 0;
+				}
+			}
+
+			for (uint16_t c = 0; c < metered_channels; ++c)
+			{
+				const float* samples = planar.data() + c * hop_frames;
+				peak[c] = std::max(peak[c], simd::max_abs(samples, frame_count));
+				sum_squares[c] += simd::sum_squares(samples, frame_count);
+			}
+
+			// A hop can be longer than the FFT; only its last fft_size frames can reach the spectrum.
+			const size_t kept = std::min(frame_count, history.size());
+			const auto newest = mono.begin() + static_cast<std::ptrdiff_t>(frame_count - kept);
+			const size_t first = std::min(kept, history.size() - history_pos);
+			std::copy_n(newest, first, history.begin() + static_cast<std::ptrdiff_t>(history_pos));
+			std::copy_n(newest + static_cast<std::ptrdiff_t>(first), kept - first, history.begin());
+			history_pos = (history_pos + kept) % history.size();
+		}
+
+		void publish()
+		{
+			audio_analysis& out = results.write_buffer();
+			out.sequence = ++sequence;
+			out.sample_rate = sample_rate;
+			out.channels = metered_channels;
+
+			for (uint16_t c = 0; c < metered_channels; ++c)
+			{
+				out.peak_db[c] = power_to_db(static_cast<double>(peak[c]) * peak[c]);
+				out.rms_db[c] = power_to_db(sum_squares[c] / static_cast<double>(hop_frames));
+				peak[c] = 0.0f;
+				sum_squares[c] = 0.0;
+			}
+
+			if (block_count > 0)
+			{
+				double energy = 0.0;
+				for (size_t i = 0; i < block_count; ++i)
+					energy += block_energies[i];
+
+				out.momentary_lufs = energy > 0.0
+					? std::max(static_cast<float>(-0.691 + 10.0 * std::log10(energy / static_cast<double>(block_count))), audio_analysis::silence_db)
+					: audio_analysis::silence_db;
+			}
+
+			// Oldest frame first, so the window lines up with time.
+			const size_t tail = history.size() - history_pos;
+			std::copy_n(history.begin() + static_cast<std::ptrdiff_t>(history_pos), tail, fft_input.begin());
+			std::copy_n(history.begin(), history_pos, fft_input.begin() + static_cast<std::ptrdiff_t>(tail));
+			simd::multiply(fft_input.data(), window.data(), fft_input.data(), fft_input.size());
+
+			fft.power_spectrum(fft_input.data(), power.data());
+			for (size_t k = 0; k < power.size(); ++k)
+				out.spectrum_db[k] = power_to_db(static_cast<double>(power[k]) * spectrum_scale);
+
+			results.publish();
+		}
+
+		void feed(const short* pcm, size_t frame_count)
+		{
+			while (frame_count > 0)
+			{
+				const size_t n = std::min(frame_count, hop_frames - hop_fill);
+				process_chunk(pcm, n);
+				pcm += n * channels;
+				frame_count -= n;
+				hop_fill += n;
+
+				if (hop_fill == hop_frames)
+				{
+					publish();
+					hop_fill = 0;
+				}
+			}
+		}
+
+		void follow_loop()
+		{
+			// Hold the samples ourselves so an unload() on another thread cannot free them under us.
+			const std::shared_ptr<const std::vector<short>> pcm = source->m_pcm;
+			const uint32_t source_handle = source->m_source_handle;
+			const size_t total_frames = pcm->size() / channels;
+			const auto interval = std::chrono::milliseconds(std::max(options.update_interval_ms / 2, 1u));
+
+			int64_t last = -1;
+			std::unique_lock lock(follow_mutex);
+			while (!follow_wake.wait_for(lock, interval, [this]() { return !following.load(std::memory_order_relaxed); }))
+			{
+				if (!alIsSource(source_handle))
+					break;
+
+				ALint state = AL_STOPPED;
+				ALint offset = 0;
+				alGetSourcei(source_handle, AL_SOURCE_STATE, &state);
+				alGetSourcei(source_handle, AL_SAMPLE_OFFSET, &offset);
+
+				if (state != AL_PLAYING)
+				{
+					if (state != AL_PAUSED)
+						last = -1;
+					continue;
+				}
+
+				const int64_t position = std::min<int64_t>(offset, static_cast<int64_t>(total_frames));
+
+				// Start over after a seek, a loop or a stall instead of analyzing everything in between.
+				if (last < 0 || position < last || position - last > static_cast<int64_t>(sample_rate))
+					last = std::max<int64_t>(position - static_cast<int64_t>(hop_frames), 0);
+
+				if (position > last)
+				{
+					feed(pcm->data() + static_cast<size_t>(last) * channels, static_cast<size_t>(position - last));
+					last = position;
+				}
+			}
+		}
+	};
+
+	audio_analyzer::audio_analyzer(const analyzer_options& options) : m_data(new _audio_analyzer_data())
+	{
+		m_data->options = options;
+		m_data->options.fft_size = std::bit_ceil(std::clamp(options.fft_size, 64u, 32768u));
+		m_data->options.update_interval_ms = std::max(options.update_interval_ms, 1u);
+
+		const size_t size = m_data->options.fft_size;
+		m_data->fft.reset(size);
+		m_data->fft_input.resize(size);
+		m_data->power.resize(m_data->fft.bin_count());
+
+		// Periodic Hann window.
+		m_data->window.resize(size);
+		double window_sum = 0.0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			m_data->window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * std::numbers::pi * static_cast<double>(i) / static_cast<double>(size)));
+			window_sum += m_data->window[i];
+		}
+
+		// One-sided power relative to a full scale sine, so a 0 dBFS tone reads 0 dB in its bin.
+		m_data->spectrum_scale = static_cast<float>(4.0 / (window_sum * window_sum));
+
+		m_data->results.for_each([bins = m_data->fft.bin_count()](audio_analysis& analysis)
+			{
+				analysis.peak_db.fill(audio_analysis::silence_db);
+				analysis.rms_db.fill(audio_analysis::silence_db);
+				analysis.spectrum_db.assign(bins, audio_analysis::silence_db);
+			});
+	}
+
+	audio_analyzer::~audio_analyzer()
+	{
+		detach();
+		delete m_data;
+	}
+
+	void audio_analyzer::configure(uint32_t sample_rate, uint16_t channels)
+	{
+		m_data->sample_rate = std::max(sample_rate, 1u);
+		m_data->channels = std::max<uint16_t>(channels, 1);
+		m_data->metered_channels = std::min<uint16_t>(m_data->channels, audio_analysis::max_channels);
+		m_data->loudness_weight = loudness_weights(m_data->channels);
+
+		m_data->hop_frames = std::max<size_t>(static_cast<size_t>(m_data->sample_rate) * m_data->options.update_interval_ms / 1000, 1);
+		m_data->hop_fill = 0;
+		m_data->peak.fill(0.0f);
+		m_data->sum_squares.fill(0.0);
+		m_data->planar.assign(m_data->metered_channels * m_data->hop_frames, 0.0f);
+		m_data->mono.assign(m_data->hop_frames, 0.0f);
+
+		m_data->history.assign(m_data->options.fft_size, 0.0f);
+		m_data->history_pos = 0;
+
+		m_data->shelf = k_weighting_shelf(m_data->sample_rate);
+		m_data->high_pass = k_weighting_high_pass(m_data->sample_rate);
+		m_data->k_state = {};
+		m_data->block_frames = std::max<size_t>(m_data->sample_rate / 10, 1);
+		m_data->block_fill = 0;
+		m_data->block_energy = 0.0;
+		m_data->block_energies.fill(0.0);
+		m_data->block_index = 0;
+		m_data->block_count = 0;
+	}
+
+	void audio_analyzer::process(const short* pcm_frames, size_t frame_count)
+	{
+		if (m_data->channels == 0)
+		{
+			log::warn("audio_analyzer::process called before configure!");
+			return;
+		}
+
+		m_data->feed(pcm_frames, frame_count);
+	}
+
+	bool audio_analyzer::attach(const std::shared_ptr<audio_source>& source)
+	{
+		detach();
+
+		if (!source || !source->is_loaded())
+		{
+			log::warn("Cannot attach the analyzer to an unloaded source!");
+			return false;
+		}
+
+		if (!source->m_pcm || source->m_channels == 0)
+		{
+			log::warn("The source has no retained PCM, load it with audio_engine::set_retain_pcm(true) to analyze it.");
+			return false;
+		}
+
+		configure(source->m_sample_rate, source->m_channels);
+		m_data->source = source;
+		m_data->following.store(true, std::memory_order_relaxed);
+		m_data->follower = std::thread([data = m_data]() { data->follow_loop(); });
+		return true;
+	}
+
+	void audio_analyzer::detach()
+	{
+		if (!m_data->follower.joinable())
+			return;
+
+		{
+			std::scoped_lock lock(m_data->follow_mutex);
+			m_data->following.store(false, std::memory_order_relaxed);
+		}
+		m_data->follow_wake.notify_one();
+		m_data->follower.join();
+		m_data->source.reset();
+	}
+
+	bool audio_analyzer::is_attached() const
+	{
+		return m_data->follower.joinable();
+	}
+
+	const audio_analysis& audio_analyzer::poll()
+	{
+		return m_data->results.read();
+	}
+
+	const analyzer_options& audio_analyzer::get_options() const
+	{
+		return m_data->options;
+	}
+}
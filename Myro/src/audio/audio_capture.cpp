@@ -1,65 +1,428 @@
 #include "audio/audio_capture.h"
+#include "audio/audio_engine.h"
 
 #include "core/log.h"
-
-#include "audio/encoders/wav_encoder.h"
-#include "audio/encoders/flac_encoder.h"
-#include "audio/encoders/opus_encoder.h"
-#include "audio/encoders/speex_encoder.h"
-#include "audio/encoders/vorbis_encoder.h"
-#include "audio/encoders/mp3_encoder.h"
+#include "core/ring_buffer.h"
+#include "core/trace.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable: 5030)
+#endif // _MSC_VER
+#define AL_ALEXT_PROTOTYPES
+#include <AL/al.h>
+#include <AL/alext.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif // _MSC_VER
+
+#include "internal/voice_gate.h"
+#include "internal/engine_metrics.h"
+#include "internal/openal_backend.h"
+#include "internal/resampler.h"
+#include "internal/simd.h"
+
+#include "audio/encoders/segmented_encoder.h"
 
 #include <miniaudio.h>
 
+#include <atomic>
+#include <thread>
+
 namespace myro
 {
+	namespace
+	{
+		// Device frames converted per pass on a sink worker; bounds the conversion buffers.
+		constexpr size_t conversion_frames = 1024;
+
+		// Lets an audio_analyzer ride on a sink: the device callback only pays for the ring write,
+		// and the analysis runs on the sink's worker at the device format.
+		// NOLINTNEXTLINE(cppcoreguidelines-special-member-functions)
+		class analyzer_tap : public IEncoder
+		{
+		public:
+			analyzer_tap(std::shared_ptr<audio_analyzer> analyzer, uint32_t sample_rate, uint16_t channels)
+				: m_analyzer(std::move(analyzer)), m_sample_rate(sample_rate), m_channels(channels)
+			{
+				m_analyzer->configure(sample_rate, channels);
+			}
+
+			bool init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels) override
+			{
+				MYRO_UNUSED(sink);
+				MYRO_UNUSED(sample_rate);
+				MYRO_UNUSED(channels);
+				return false;
+			}
+
+			void deinit() override { m_initialized = false; }
+
+			[[nodiscard]] bool initialized() const override { return m_initialized; }
+
+			[[nodiscard]] uint32_t get_sample_rate() const override { return m_sample_rate; }
+			[[nodiscard]] uint16_t get_channels() const override { return m_channels; }
+			[[nodiscard]] uint16_t get_bits_per_sample() const override { return 16; }
+
+			using IEncoder::write;
+			void write(const short* pcm_frames, size_t frame_count) override { m_analyzer->process(pcm_frames, frame_count); }
+		private:
+			std::shared_ptr<audio_analyzer> m_analyzer;
+			uint32_t m_sample_rate = 0;
+			uint16_t m_channels = 0;
+			bool m_initialized = true;
+		};
+
+		// One encoder fed by the capture stream. Every sink owns its ring and worker,
+		// so a slow encoder only ever drops its own frames.
+		struct capture_sink
+		{
+			~capture_sink()
+			{
+				if (remapping)
+					ma_data_converter_uninit(&remapper, nullptr);
+			}
+
+			std::shared_ptr<IEncoder> encoder;
+			spsc_ring_buffer<short> ring;	// device frames
+			uint16_t channels = 0;			// device channels, the ring's frame size
+
+			// Device rate/channels to the encoder's, run on the worker in chunks of conversion_frames.
+			// miniaudio only remaps channels; the rate goes through the windowed-sinc resampler.
+			// Skipped when both already match.
+			ma_data_converter remapper{};
+			bool remapping = false;
+			sinc_resampler resampler;
+			bool resampling = false;
+			std::vector<float> device_samples;		// conversion_frames at the device rate, encoder channels
+			std::vector<float> resampled;
+			std::vector<short> converted;
+			uint16_t encoder_channels = 0;
+			float conversion_latency_ms = 0.0f;
+
+			std::thread worker;
+			std::atomic<bool> running{ false };
+			std::atomic<uint64_t> data_signal{ 0 };
+			std::atomic<bool> waiting{ false };	// the worker is about to sleep; only then does the callback wake it
+
+			// Only touched by the worker.
+			voice_gate gate;
+			bool gate_enabled = false;
+			voice_gate_mode gate_mode = voice_gate_mode::gap;
+
+			std::atomic<uint64_t> frames_encoded{ 0 };	// at the encoder's rate
+			std::atomic<uint64_t> gated_frames{ 0 };
+			// Written by the device callback only, so plain load + store; atomic just for get_stats().
+			std::atomic<uint64_t> dropped_frames{ 0 };
+			std::atomic<uint64_t> overruns{ 0 };
+			std::atomic<size_t> peak_buffered_frames{ 0 };	// sampled by the worker
+		};
+
+		// Live playback of the capture stream. The device callback fills the ring and the OpenAL
+		// mixer pulls from it through a callback buffer, so no thread of our own sits in between.
+		struct capture_monitor
+		{
+			spsc_ring_buffer<short> ring;	// device frames
+			uint16_t device_channels = 0;
+			uint16_t channels = 0;			// what OpenAL plays: the first one or two device channels
+			uint32_t sample_rate = 0;
+
+			std::shared_ptr<audio_source> source;
+			std::atomic<bool> enabled{ false };
+			std::atomic<bool> discard{ false };	// drop stale audio on the next pull
+			std::atomic<uint32_t> target_frames{ 0 };
+
+			std::atomic<uint64_t> underruns{ 0 };
+			std::atomic<uint64_t> overruns{ 0 };
+			std::atomic<uint64_t> trimmed_frames{ 0 };
+		};
+	}
+
 	struct _audio_capture_data
 	{
 		ma_device device{};
 		ma_device_config device_config{};
 		bool device_initialized = false;
-	};
 
-	class audio_capture_public_write : public audio_capture
-	{
-	public:
-		void write(const short* pcm_frames, size_t frame_count) const
-		{
-			audio_capture::write(pcm_frames, frame_count);
-		}
+		// Only needed to open a device by name.
+		ma_context context{};
+		bool context_initialized = false;
+		capture_device_options device_options;
+
+		// Only modified while the device is stopped, so the callback can walk it without locking.
+		std::vector<std::unique_ptr<capture_sink>> sinks;
+		uint32_t sample_rate = 0;	// what the device actually runs at
+		uint16_t channels = 0;
+		uint32_t buffer_duration_ms = 2000;
+		voice_gate_options gate_options;
+
+		// Allocated with the device and kept until it is torn down, so the callback never sees it vanish.
+		std::unique_ptr<capture_monitor> monitor;
+
+		// Only the device callback writes these.
+		std::atomic<uint64_t> frames_captured{ 0 };
+		std::atomic<uint64_t> underruns{ 0 };
 	};
 
-	namespace 
+	namespace
 	{
+		// Runs on the realtime device thread: no locks, no allocation, no encoding.
 		void data_callback(ma_device* device, void* output, const void* input, ma_uint32 frame_count)
 		{
+			MYRO_UNUSED(output);
+			// A thread_local check after the first call; the first one allocates the trace buffer at
+			// device start instead of in the middle of a recording.
+			MYRO_TRACE_PREPARE_THREAD();
+			MYRO_TRACE_SCOPE("capture callback");
+			_audio_capture_data* data = static_cast<_audio_capture_data*>(device->pUserData);
+
 			if (!input)
+			{
+				data->underruns.store(data->underruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 				return;
-			MYRO_UNUSED(output);
-			audio_capture_public_write* self = static_cast<audio_capture_public_write*>(device->pUserData);
-			self->write(static_cast<const short*>(input), frame_count);
+			}
+
+			// Only per-sink counters with a single writer here; the process wide metrics get one update
+			// per callback, and only after an overrun. The backlog is sampled on the sink workers.
+			uint64_t dropped = 0;
+			uint64_t overruns = 0;
+			for (const auto& sink : data->sinks)
+			{
+				const size_t channels = sink->channels;
+				const size_t writable_frames = sink->ring.write_available() / channels;
+				const size_t frames = std::min<size_t>(frame_count, writable_frames);
+
+				if (frames > 0)
+					sink->ring.write(static_cast<const short*>(input), frames * channels);
+
+				if (frames < frame_count)
+				{
+					sink->dropped_frames.store(sink->dropped_frames.load(std::memory_order_relaxed) + frame_count - frames, std::memory_order_relaxed);
+					sink->overruns.store(sink->overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+					dropped += frame_count - frames;
+					++overruns;
+				}
+
+				// Pairs with the fence in sink_loop: either the worker sees these frames before it sleeps,
+				// or the callback sees it waiting. A busy worker costs no syscall here.
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (sink->waiting.load(std::memory_order_relaxed) && sink->waiting.exchange(false, std::memory_order_relaxed))
+				{
+					sink->data_signal.fetch_add(1, std::memory_order_release);
+					sink->data_signal.notify_one();
+				}
+			}
+
+			capture_monitor* monitor = data->monitor.get();
+			if (monitor && monitor->enabled.load(std::memory_order_acquire))
+			{
+				const size_t samples = static_cast<size_t>(frame_count) * monitor->device_channels;
+				if (monitor->ring.write(static_cast<const short*>(input), samples) < samples)
+					monitor->overruns.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			if (overruns > 0)
+			{
+				engine_metrics& metrics = engine_metrics::get();
+				metrics.capture_dropped_frames.fetch_add(dropped, std::memory_order_relaxed);
+				metrics.capture_overruns.fetch_add(overruns, std::memory_order_relaxed);
+			}
+
+			data->frames_captured.store(data->frames_captured.load(std::memory_order_relaxed) + frame_count, std::memory_order_relaxed);
 		}
 
-		std::shared_ptr<IEncoder> get_encoder(audio_file_format format)
+		// Runs on the OpenAL mixer thread. Always fills the whole request, since a short return
+		// would stop the source.
+		ALsizei AL_APIENTRY monitor_callback(ALvoid* userptr, ALvoid* sampledata, ALsizei numbytes)
 		{
-			switch (format)
+			capture_monitor* monitor = static_cast<capture_monitor*>(userptr);
+			const size_t device_channels = monitor->device_channels;
+			const size_t channels = monitor->channels;
+			const size_t wanted = static_cast<size_t>(numbytes) / (sizeof(short) * channels);
+			short* out = static_cast<short*>(sampledata);
+
+			size_t buffered = monitor->ring.size() / device_channels;
+			if (monitor->discard.exchange(false, std::memory_order_acq_rel))
+			{
+				monitor->ring.skip(buffered * device_channels);
+				buffered = 0;
+			}
+			else
 			{
-			case audio_file_format::wav:  return wav_encoder::create();
-			case audio_file_format::flac: return flac_encoder::create();
-			case audio_file_format::ogg:  return vorbis_encoder::create(); 
-			case audio_file_format::mp3:  return mp3_encoder::create();
-			case audio_file_format::opus: return opus_encoder::create();
-			case audio_file_format::spx:  return speex_encoder::create();
-			case audio_file_format::unknown:
-				break;
+				// The capture and playback clocks drift apart; never let the backlog grow past twice the target.
+				const size_t target = monitor->target_frames.load(std::memory_order_relaxed);
+				if (buffered > wanted + 2 * target)
+				{
+					const size_t excess = buffered - wanted - target;
+					monitor->ring.skip(excess * device_channels);
+					monitor->trimmed_frames.fetch_add(excess, std::memory_order_relaxed);
+					buffered -= excess;
+				}
 			}
 
-			log::warn("Unsupported or unknown format!");
-			return nullptr;
+			size_t produced = 0;
+			monitor->ring.read(std::min(buffered, wanted) * device_channels, [&](const short* samples, size_t count)
+			{
+				const size_t frames = count / device_channels;
+				if (device_channels == channels)
+				{
+					std::copy_n(samples, count, out + produced * channels);
+				}
+				else
+				{
+					for (size_t i = 0; i < frames; ++i)
+						std::copy_n(samples + i * device_channels, channels, out + (produced + i) * channels);
+				}
+				produced += frames;
+			});
+
+			if (produced < wanted)
+			{
+				std::fill(out + produced * channels, out + wanted * channels, short{ 0 });
+				monitor->underruns.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			return numbytes;
+		}
+
+		void sink_loop(capture_sink* sink)
+		{
+			MYRO_TRACE_PREPARE_THREAD();
+			MYRO_TRACE_THREAD_NAME("myro encoder");
+			const size_t channels = sink->channels;
+			const size_t encoder_channels = sink->encoder_channels;
+			IEncoder* encoder = sink->encoder.get();
+
+			auto on_audio = [encoder](const short* samples, size_t frames) { encoder->write(samples, frames); };
+			auto on_gap = [sink, encoder](size_t frames)
+			{
+				if (sink->gate_mode == voice_gate_mode::gap)
+					encoder->write_gap(frames);
+				sink->gated_frames.fetch_add(frames, std::memory_order_relaxed);
+			};
+
+			auto deliver = [&](const short* samples, size_t frames)
+			{
+				MYRO_TRACE_SCOPE("encoder write");
+				if (sink->gate_enabled)
+					sink->gate.process(samples, frames, on_audio, on_gap);
+				else
+					encoder->write(samples, frames);
+
+				sink->frames_encoded.fetch_add(frames, std::memory_order_relaxed);
+			};
+
+			auto encode = [&](const short* samples, size_t count)
+			{
+				if (!sink->remapping && !sink->resampling)
+				{
+					deliver(samples, count / channels);
+					return;
+				}
+
+				size_t remaining = count / channels;
+				while (remaining > 0)
+				{
+					const short* chunk = samples;
+					size_t frames = std::min(remaining, conversion_frames);
+					samples += frames * channels;
+					remaining -= frames;
+
+					float* converting = sink->device_samples.data();
+					if (sink->remapping)
+					{
+						ma_uint64 frames_in = frames;
+						ma_uint64 frames_out = frames;
+						if (ma_data_converter_process_pcm_frames(&sink->remapper, chunk, &frames_in, converting, &frames_out) != MA_SUCCESS)
+							break;
+						frames = static_cast<size_t>(frames_out);
+					}
+					else
+						simd::short_to_float(chunk, converting, frames * channels);
+
+					if (sink->resampling)
+					{
+						frames = sink->resampler.process(converting, frames, sink->resampled.data());
+						converting = sink->resampled.data();
+					}
+
+					if (frames > 0)
+					{
+						simd::float_to_short(converting, sink->converted.data(), frames * encoder_channels);
+						deliver(sink->converted.data(), frames);
+					}
+				}
+			};
+
+			// This sink's share of the process wide backlog, as last reported.
+			engine_metrics& metrics = engine_metrics::get();
+			size_t reported = 0;
+			auto report_backlog = [&](size_t buffered)
+			{
+				if (buffered > sink->peak_buffered_frames.load(std::memory_order_relaxed))
+					sink->peak_buffered_frames.store(buffered, std::memory_order_relaxed);
+				if (buffered == reported)
+					return;
+
+				const int64_t delta = static_cast<int64_t>(buffered) - static_cast<int64_t>(reported);
+				const uint64_t total = static_cast<uint64_t>(metrics.encoder_backlog_frames.fetch_add(delta, std::memory_order_relaxed) + delta);
+				reported = buffered;
+
+				uint64_t peak = metrics.peak_encoder_backlog_frames.load(std::memory_order_relaxed);
+				while (total > peak && !metrics.peak_encoder_backlog_frames.compare_exchange_weak(peak, total, std::memory_order_relaxed)) {}
+			};
+
+			auto drain = [&]()
+			{
+				report_backlog(sink->ring.size() / channels);
+				const size_t count = sink->ring.read(sink->ring.capacity(), encode);
+				report_backlog(sink->ring.size() / channels);
+				return count;
+			};
+
+			while (sink->running.load(std::memory_order_acquire))
+			{
+				// Load the signal before reading so a wake between the read and the wait is never missed.
+				const uint64_t signal = sink->data_signal.load(std::memory_order_acquire);
+				if (drain() != 0)
+					continue;
+
+				sink->waiting.store(true, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (sink->ring.size() == 0 && sink->running.load(std::memory_order_acquire))
+					sink->data_signal.wait(signal, std::memory_order_acquire);
+				sink->waiting.store(false, std::memory_order_relaxed);
+			}
+
+			drain();
+			report_backlog(0);
+
+			if (sink->gate_enabled)
+				sink->gate.flush(on_audio, on_gap);
+		}
+
+		void start_sink(capture_sink* sink)
+		{
+			sink->running.store(true, std::memory_order_release);
+			sink->worker = std::thread(sink_loop, sink);
+		}
+
+		// Drains whatever is still buffered into the encoder, then finalizes it.
+		void stop_sink(capture_sink* sink)
+		{
+			if (sink->worker.joinable())
+			{
+				sink->running.store(false, std::memory_order_release);
+				sink->data_signal.fetch_add(1, std::memory_order_release);
+				sink->data_signal.notify_one();
+				sink->worker.join();
+			}
+
+			sink->encoder->deinit();
 		}
 	}
 
-	audio_capture::audio_capture() : m_data(new _audio_capture_data()), m_encoder(nullptr)
+	audio_capture::audio_capture() : m_data(new _audio_capture_data())
 	{
 	}
 
@@ -71,84 +434,168 @@ namespace myro
 
 	bool audio_capture::init(const std::shared_ptr<IEncoder>& encoder)
 	{
-		if (m_encoder)
+		return init(std::vector<std::shared_ptr<IEncoder>>{ encoder });
+	}
+
+	bool audio_capture::init(const std::vector<std::shared_ptr<IEncoder>>& encoders)
+	{
+		if (!m_data->sinks.empty())
 			deinit(false);
 
-		if (!encoder || !encoder->initialized())
+		if (encoders.empty())
 			return false;
 
-		m_encoder = encoder;
+		for (const auto& encoder : encoders)
+		{
+			if (!encoder || !encoder->initialized())
+				return false;
+		}
 
-		bool result = init_device();
+		// The encoders arrive initialized with their outputs open; on failure they are finalized here
+		// rather than left for the caller to notice.
+		if (!init_device())
+		{
+			for (const auto& encoder : encoders)
+				encoder->deinit();
+			return false;
+		}
 
-		if (!result)
-			m_encoder = nullptr;
+		for (size_t i = 0; i < encoders.size(); ++i)
+		{
+			if (!add_sink(encoders[i]))
+			{
+				deinit(false);
+				for (size_t j = i; j < encoders.size(); ++j)
+					encoders[j]->deinit();
+				return false;
+			}
+		}
 
-		return result;
+		return true;
 	}
 
 	bool audio_capture::init(const std::filesystem::path& output_filepath, uint32_t sample_rate, uint32_t channels)
 	{
-		if (m_encoder)
+		return init(output_filepath, get_file_format(output_filepath), sample_rate, channels);
+	}
+
+	bool audio_capture::init(const std::filesystem::path& output_filepath, audio_file_format format, uint32_t sample_rate, uint32_t channels)
+	{
+		if (!m_data->sinks.empty())
 			deinit(false);
 
-		audio_file_format format = get_file_format(output_filepath);
-		m_encoder = get_encoder(format);
+		std::shared_ptr<IEncoder> encoder = create_encoder(format);
 
-		if (!m_encoder->init(output_filepath, sample_rate, channels))
+		if (!encoder || !encoder->init(output_filepath, sample_rate, channels))
 		{
 			log::warn("Encoder initialization failed!");
-			m_encoder = nullptr;
 			return false;
 		}
 
-		bool result = init_device();
-
-		if (!result)
-			m_encoder = nullptr;
-
-		return result;
+		return init(encoder);
 	}
 
-	bool audio_capture::init(const std::filesystem::path& output_filepath, audio_file_format format, uint32_t sample_rate, uint32_t channels)
+	bool audio_capture::init_segmented(const segmented_encoder_options& options, uint32_t sample_rate, uint32_t channels)
 	{
-		if (m_encoder)
+		if (!m_data->sinks.empty())
 			deinit(false);
 
-		m_encoder = get_encoder(format);
+		std::shared_ptr<segmented_encoder> encoder = segmented_encoder::create(options);
 
-		if (!m_encoder->init(output_filepath, sample_rate, channels)) 
+		if (!encoder->init(sample_rate, channels))
 		{
 			log::warn("Encoder initialization failed!");
-			m_encoder = nullptr;
 			return false;
 		}
 
-		bool result = init_device();
-
-		if (!result)
-			m_encoder = nullptr;
-
-		return result;
+		return init(encoder);
 	}
 
 	void audio_capture::deinit(bool deinit_device)
 	{
-		if (m_data && deinit_device)
+		if (!m_data)
+			return;
+
+		stop_monitoring();
+
+		if (deinit_device && m_data->device_initialized)
 		{
 			ma_device_uninit(&m_data->device);
 			m_data->device_initialized = false;
+			m_data->monitor.reset();
+		}
+
+		if (deinit_device && m_data->context_initialized)
+		{
+			ma_context_uninit(&m_data->context);
+			m_data->context_initialized = false;
+		}
+		else if (m_data->device_initialized)
+		{
+			// The callback walks the sink list, so it must not run while the sinks are torn down.
+			ma_device_stop(&m_data->device);
+		}
+
+		for (const auto& sink : m_data->sinks)
+			stop_sink(sink.get());
+
+		m_data->sinks.clear();
+	}
+
+	bool audio_capture::add_encoder(const std::shared_ptr<IEncoder>& encoder)
+	{
+		if (m_data->sinks.empty())
+			return init(encoder);
+
+		if (!encoder || !encoder->initialized())
+			return false;
+
+		if (ma_device_is_started(&m_data->device))
+		{
+			log::warn("Encoders can only be added while the capture is stopped!");
+			return false;
+		}
+
+		return add_sink(encoder);
+	}
+
+	bool audio_capture::add_analyzer(const std::shared_ptr<audio_analyzer>& analyzer)
+	{
+		if (!analyzer)
+			return false;
+
+		if (m_data->sinks.empty())
+		{
+			log::warn("Analyzers can only be added to an initialized capture!");
+			return false;
 		}
-		if (m_encoder)
+
+		if (ma_device_is_started(&m_data->device))
 		{
-			m_encoder->deinit();
-			m_encoder = nullptr;
+			log::warn("Analyzers can only be added while the capture is stopped!");
+			return false;
 		}
+
+		// Metering must see the signal as captured, so the voice gate is left out.
+		return add_sink(std::make_shared<analyzer_tap>(analyzer, m_data->sample_rate, m_data->channels), false);
+	}
+
+	size_t audio_capture::get_encoder_count() const
+	{
+		return m_data->sinks.size();
+	}
+
+	std::shared_ptr<IEncoder> audio_capture::get_encoder(size_t index) const
+	{
+		if (index >= m_data->sinks.size())
+			return nullptr;
+
+		return m_data->sinks[index]->encoder;
 	}
 
 	bool audio_capture::start() const
 	{
-		if (!m_encoder || !m_data)
+		if (!m_data || m_data->sinks.empty())
 			return false;
 
 		return ma_device_start(&m_data->device) == MA_SUCCESS;
@@ -162,27 +609,343 @@ namespace myro
 		ma_device_stop(&m_data->device);
 	}
 
-	void audio_capture::write(const short* pcm_frames, size_t frame_count) const
+	void audio_capture::set_buffer_duration(uint32_t milliseconds)
+	{
+		m_data->buffer_duration_ms = std::max<uint32_t>(milliseconds, 1);
+	}
+
+	uint32_t audio_capture::get_buffer_duration() const
+	{
+		return m_data->buffer_duration_ms;
+	}
+
+	void audio_capture::set_voice_gate(const voice_gate_options& options)
+	{
+		m_data->gate_options = options;
+	}
+
+	const voice_gate_options& audio_capture::get_voice_gate() const
+	{
+		return m_data->gate_options;
+	}
+
+	capture_statistics audio_capture::get_statistics(size_t encoder_index) const
+	{
+		capture_statistics stats;
+		stats.frames_captured = m_data->frames_captured.load(std::memory_order_relaxed);
+		stats.underruns = m_data->underruns.load(std::memory_order_relaxed);
+
+		if (encoder_index >= m_data->sinks.size())
+			return stats;
+
+		const capture_sink& sink = *m_data->sinks[encoder_index];
+		stats.frames_encoded = sink.frames_encoded.load(std::memory_order_relaxed);
+		stats.gated_frames = sink.gated_frames.load(std::memory_order_relaxed);
+		stats.dropped_frames = sink.dropped_frames.load(std::memory_order_relaxed);
+		stats.overruns = sink.overruns.load(std::memory_order_relaxed);
+		stats.peak_buffered_frames = sink.peak_buffered_frames.load(std::memory_order_relaxed);
+		stats.buffered_frames = sink.ring.size() / sink.channels;
+		stats.capacity_frames = sink.ring.capacity() / sink.channels;
+		stats.conversion_latency_ms = sink.conversion_latency_ms;
+		return stats;
+	}
+
+	std::vector<capture_device_info> audio_capture::get_capture_devices()
+	{
+		std::vector<capture_device_info> result;
+
+		ma_context context;
+		if (ma_context_init(nullptr, 0, nullptr, &context) != MA_SUCCESS)
+		{
+			log::error("Failed to initialize the audio context for device enumeration!");
+			return result;
+		}
+
+		ma_device_info* capture_infos = nullptr;
+		ma_uint32 capture_count = 0;
+		if (ma_context_get_devices(&context, nullptr, nullptr, &capture_infos, &capture_count) == MA_SUCCESS)
+		{
+			result.reserve(capture_count);
+			for (ma_uint32 i = 0; i < capture_count; ++i)
+				result.push_back({ .name = capture_infos[i].name, .is_default = capture_infos[i].isDefault != MA_FALSE });
+		}
+		else
+		{
+			log::error("Failed to enumerate capture devices!");
+		}
+
+		ma_context_uninit(&context);
+		return result;
+	}
+
+	void audio_capture::set_device_options(const capture_device_options& options)
+	{
+		m_data->device_options = options;
+	}
+
+	const capture_device_options& audio_capture::get_device_options() const
+	{
+		return m_data->device_options;
+	}
+
+	capture_device_latency audio_capture::get_device_latency() const
+	{
+		capture_device_latency latency;
+		if (!m_data->device_initialized)
+			return latency;
+
+		const auto& capture = m_data->device.capture;
+		latency.device_name = capture.name;
+		latency.sample_rate = capture.internalSampleRate;
+		latency.period_frames = capture.internalPeriodSizeInFrames;
+		latency.period_count = capture.internalPeriods;
+		if (latency.sample_rate > 0)
+		{
+			latency.period_ms = static_cast<float>(latency.period_frames) * 1000.0f / static_cast<float>(latency.sample_rate);
+			latency.buffer_ms = latency.period_ms * static_cast<float>(latency.period_count);
+		}
+		return latency;
+	}
+
+	bool audio_capture::start_monitoring(const monitor_options& options)
+	{
+		capture_monitor* monitor = m_data->monitor.get();
+		if (!monitor)
+		{
+			log::warn("Monitoring needs an initialized capture!");
+			return false;
+		}
+
+		if (!audio_engine::is_active())
+		{
+			log::warn("Monitoring needs an active audio engine!");
+			return false;
+		}
+
+		monitor->target_frames = std::max<uint32_t>(static_cast<uint32_t>(static_cast<uint64_t>(monitor->sample_rate) * options.buffer_ms / 1000), 1);
+		if (monitor->source)
+		{
+			monitor->source->set_gain(options.gain);
+			return true;
+		}
+
+		ALuint buffer = 0;
+		alGenBuffers(1, &buffer);
+		alBufferCallbackSOFT(buffer, openal_backend::get_openAL_format(monitor->channels), static_cast<ALsizei>(monitor->sample_rate), monitor_callback, monitor);
+
+		auto source = std::make_shared<audio_source>();
+		source->m_buffer_handle = buffer;
+		source->m_loaded = true;
+		alGenSources(1, &source->m_source_handle);
+		alSourcei(source->m_source_handle, AL_BUFFER, static_cast<ALint>(buffer));
+		engine_metrics::get().al_sources.fetch_add(1, std::memory_order_relaxed);
+
+		if (alGetError() != AL_NO_ERROR)
+		{
+			log::error("Failed to set up the monitor source! (AL_SOFT_callback_buffer missing?)");
+			source->unload();
+			return false;
+		}
+
+		source->set_spitial(false);
+		source->set_pitch(1.0f);
+		source->set_gain(options.gain);
+
+		monitor->discard = true;
+		monitor->enabled.store(true, std::memory_order_release);
+		monitor->source = std::move(source);
+		alSourcePlay(monitor->source->m_source_handle);
+		return true;
+	}
+
+	void audio_capture::stop_monitoring()
+	{
+		capture_monitor* monitor = m_data->monitor.get();
+		if (!monitor || !monitor->source)
+			return;
+
+		monitor->enabled.store(false, std::memory_order_release);
+
+		// Stopping the source ends the mixer's pulls before the buffer goes away.
+		monitor->source->unload();
+		monitor->source = nullptr;
+	}
+
+	bool audio_capture::is_monitoring() const
 	{
-		if (m_encoder)
-			m_encoder->write(pcm_frames, frame_count);
+		return m_data->monitor && m_data->monitor->source;
+	}
+
+	std::shared_ptr<audio_source> audio_capture::get_monitor_source() const
+	{
+		return m_data->monitor ? m_data->monitor->source : nullptr;
+	}
+
+	monitor_statistics audio_capture::get_monitor_statistics() const
+	{
+		monitor_statistics stats;
+		const capture_monitor* monitor = m_data->monitor.get();
+		if (!monitor)
+			return stats;
+
+		const float sample_rate = static_cast<float>(monitor->sample_rate);
+		stats.capture_period_ms = get_device_latency().period_ms;
+		stats.buffered_ms = static_cast<float>(monitor->ring.size() / monitor->device_channels) * 1000.0f / sample_rate;
+		stats.underruns = monitor->underruns.load(std::memory_order_relaxed);
+		stats.overruns = monitor->overruns.load(std::memory_order_relaxed);
+		stats.trimmed_frames = monitor->trimmed_frames.load(std::memory_order_relaxed);
+
+		if (monitor->source)
+		{
+			// { playback offset, output latency } in seconds
+			ALdouble offset_latency[2] = { 0.0, 0.0 };
+			alGetSourcedvSOFT(monitor->source->m_source_handle, AL_SEC_OFFSET_LATENCY_SOFT, offset_latency);
+			stats.output_ms = static_cast<float>(offset_latency[1] * 1000.0);
+		}
+
+		stats.total_ms = stats.capture_period_ms + stats.buffered_ms + stats.output_ms;
+		return stats;
+	}
+
+	uint32_t audio_capture::get_device_sample_rate() const
+	{
+		return m_data->sample_rate;
+	}
+
+	uint16_t audio_capture::get_device_channels() const
+	{
+		return m_data->channels;
 	}
 
 	bool audio_capture::init_device()
 	{
+		if (m_data->device_initialized)
+		{
+			ma_device_uninit(&m_data->device);
+			m_data->device_initialized = false;
+			m_data->monitor.reset();
+		}
+
+		// Rate and channel count are left at 0 so the device runs at its native format and no
+		// resampler of unknown quality sits in the OS or backend; each sink converts on its worker.
+		const capture_device_options& options = m_data->device_options;
+
+		ma_device_id device_id{};
+		bool device_found = false;
+		if (!options.device_name.empty())
+		{
+			if (!m_data->context_initialized)
+				m_data->context_initialized = ma_context_init(nullptr, 0, nullptr, &m_data->context) == MA_SUCCESS;
+
+			ma_device_info* capture_infos = nullptr;
+			ma_uint32 capture_count = 0;
+			if (m_data->context_initialized && ma_context_get_devices(&m_data->context, nullptr, nullptr, &capture_infos, &capture_count) == MA_SUCCESS)
+			{
+				for (ma_uint32 i = 0; i < capture_count && !device_found; ++i)
+				{
+					if (options.device_name == capture_infos[i].name)
+					{
+						device_id = capture_infos[i].id;
+						device_found = true;
+					}
+				}
+			}
+
+			if (!device_found)
+				log::warn("Capture device \"{}\" not found, using the default device.", options.device_name);
+		}
+
 		m_data->device_config = ma_device_config_init(ma_device_type_capture);
+		m_data->device_config.capture.pDeviceID = device_found ? &device_id : nullptr;
 		m_data->device_config.capture.format = ma_format_s16; // 16-bit short
-		m_data->device_config.capture.channels = m_encoder->get_channels();
-		m_data->device_config.sampleRate = m_encoder->get_sample_rate();
+		m_data->device_config.capture.channels = 0;
+		m_data->device_config.capture.shareMode = options.share_mode == capture_share_mode::exclusive ? ma_share_mode_exclusive : ma_share_mode_shared;
+		m_data->device_config.sampleRate = 0;
+		m_data->device_config.periodSizeInFrames = options.period_frames;
+		m_data->device_config.periodSizeInMilliseconds = options.period_frames == 0 ? options.period_ms : 0;
+		m_data->device_config.periods = options.period_count;
+		m_data->device_config.performanceProfile = options.profile == capture_performance_profile::conservative ? ma_performance_profile_conservative : ma_performance_profile_low_latency;
 		m_data->device_config.dataCallback = data_callback;
-		m_data->device_config.pUserData = this;
+		m_data->device_config.pUserData = m_data;
 
-		if (ma_device_init(nullptr, &m_data->device_config, &m_data->device) == MA_SUCCESS)
+		if (ma_device_init(m_data->context_initialized ? &m_data->context : nullptr, &m_data->device_config, &m_data->device) != MA_SUCCESS)
 		{
-			m_data->device_initialized = true;
-			return true;
+			log::error("Failed to open the capture device!");
+			return false;
 		}
-		return false;
+
+		m_data->device_initialized = true;
+		m_data->sample_rate = m_data->device.sampleRate;
+		m_data->channels = static_cast<uint16_t>(m_data->device.capture.channels);
+
+		// One second of headroom; the mixer callback trims it down to the requested buffer.
+		m_data->monitor = std::make_unique<capture_monitor>();
+		m_data->monitor->device_channels = m_data->channels;
+		m_data->monitor->channels = std::min<uint16_t>(m_data->channels, 2);
+		m_data->monitor->sample_rate = m_data->sample_rate;
+		m_data->monitor->ring.allocate(static_cast<size_t>(m_data->sample_rate) * m_data->channels);
+		m_data->frames_captured = 0;
+		m_data->underruns = 0;
+
+		const capture_device_latency latency = get_device_latency();
+		log::info("Capture device \"{}\": {} Hz, {} ch, {} x {} frame periods ({} ms per period, {} ms buffered)",
+			latency.device_name, latency.sample_rate, m_data->channels, latency.period_count, latency.period_frames, latency.period_ms, latency.buffer_ms);
+		return true;
 	}
-}
 
+	bool audio_capture::add_sink(const std::shared_ptr<IEncoder>& encoder, bool gated)
+	{
+		auto sink = std::make_unique<capture_sink>();
+		sink->encoder = encoder;
+		sink->channels = m_data->channels;
+		sink->encoder_channels = encoder->get_channels();
+
+		const size_t ring_frames = std::max<size_t>(static_cast<size_t>(m_data->sample_rate) * m_data->buffer_duration_ms / 1000, 1);
+		const uint32_t encoder_rate = encoder->get_sample_rate();
+		if (sink->encoder_channels != sink->channels)
+		{
+			// Same rate in and out, so miniaudio does no resampling of its own.
+			const ma_data_converter_config config = ma_data_converter_config_init(ma_format_s16, ma_format_f32,
+				sink->channels, sink->encoder_channels, m_data->sample_rate, m_data->sample_rate);
+			if (ma_data_converter_init(&config, nullptr, &sink->remapper) != MA_SUCCESS)
+			{
+				log::error("Could not convert {} ch capture to {} ch!", sink->channels, sink->encoder_channels);
+				return false;
+			}
+			sink->remapping = true;
+		}
+
+		if (encoder_rate != m_data->sample_rate)
+		{
+			if (!sink->resampler.init(m_data->sample_rate, encoder_rate, sink->encoder_channels))
+			{
+				log::error("Could not resample {} Hz capture to {} Hz!", m_data->sample_rate, encoder_rate);
+				return false;
+			}
+			sink->resampling = true;
+			sink->conversion_latency_ms = static_cast<float>(sink->resampler.latency_frames()) * 1000.0f / static_cast<float>(m_data->sample_rate);
+
+			// The resampler keeps less than one filter length between calls, so a chunk never yields more than this.
+			const uint64_t max_input = conversion_frames + sink->resampler.taps();
+			const size_t max_output = static_cast<size_t>((max_input * encoder_rate + m_data->sample_rate - 1) / m_data->sample_rate) + 1;
+			sink->resampled.resize(max_output * sink->encoder_channels);
+			sink->converted.resize(max_output * sink->encoder_channels);
+		}
+		else if (sink->remapping)
+			sink->converted.resize(conversion_frames * sink->encoder_channels);
+
+		if (sink->remapping || sink->resampling)
+			sink->device_samples.resize(conversion_frames * sink->encoder_channels);
+
+		sink->ring.allocate(ring_frames * sink->channels);
+
+		sink->gate_enabled = gated && m_data->gate_options.enabled;
+		sink->gate_mode = m_data->gate_options.mode;
+		if (sink->gate_enabled)
+			sink->gate.configure(m_data->gate_options, encoder_rate, sink->encoder_channels);
+
+		start_sink(sink.get());
+		m_data->sinks.push_back(std::move(sink));
+		return true;
+	}
+}
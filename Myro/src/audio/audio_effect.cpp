@@ -1,4 +1,7 @@
 #include "audio/audio_effect.h"
+#include "audio/audio_engine.h"
+
+#include "internal/openal_backend.h"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -11,229 +14,342 @@
 #pragma warning(pop)
 #endif // _MSC_VER
 
+#include <algorithm>
+#include <initializer_list>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 // NOLINTBEGIN(readability-suspicious-call-argument)
 
 namespace myro
 {
-	struct effect_data
-	{
-		ALuint slot;
-		ALuint effect;
-		audio_effect type;
-	};
-
 	struct effect_manager_data
 	{
-		std::unordered_map<ALuint, effect_data> effect_datas;
+		// Per source, the instance fed by each auxiliary send (null where the send is free).
+		std::unordered_map<ALuint, std::vector<audio_effect_instance*>> source_sends;
+		// Instances made by apply_*, at most one per effect type and source.
+		std::unordered_map<ALuint, std::vector<std::shared_ptr<audio_effect_instance>>> source_effects;
+		std::unordered_map<std::string, std::shared_ptr<audio_effect_instance>> buses;
+		// Sources copy filter parameters when a send is set, so one object serves every send.
+		ALuint send_filter = 0;
 	};
 
-	namespace { effect_manager_data s_data; }
-
-	void audio_effect_manager::apply_reverb(const std::shared_ptr<audio_source>& source, float decay_time, float density)
+	namespace
 	{
-		if (!source)
+		effect_manager_data s_data;
+
+		struct param_info
 		{
-			log::error("Unloaded audio source passed to audio effect manager!");
-			return;
+			audio_effect type;
+			ALenum param;
+			ALenum second_param;	// set to the same value, 0 if none
+			bool integer;
+		};
+
+		// Indexed by effect_param.
+		constexpr param_info param_infos[] = {
+			{ audio_effect::reverb, AL_REVERB_DECAY_TIME, 0, false },
+			{ audio_effect::reverb, AL_REVERB_DENSITY, 0, false },
+			{ audio_effect::reverb, AL_REVERB_DIFFUSION, 0, false },
+			{ audio_effect::reverb, AL_REVERB_GAIN, 0, false },
+			{ audio_effect::reverb, AL_REVERB_GAINHF, 0, false },
+			{ audio_effect::echo, AL_ECHO_DELAY, 0, false },
+			{ audio_effect::echo, AL_ECHO_LRDELAY, 0, false },
+			{ audio_effect::echo, AL_ECHO_DAMPING, 0, false },
+			{ audio_effect::echo, AL_ECHO_FEEDBACK, 0, false },
+			{ audio_effect::chorus, AL_CHORUS_RATE, 0, false },
+			{ audio_effect::chorus, AL_CHORUS_DEPTH, 0, false },
+			{ audio_effect::chorus, AL_CHORUS_FEEDBACK, 0, false },
+			{ audio_effect::distortion, AL_DISTORTION_EDGE, 0, false },
+			{ audio_effect::distortion, AL_DISTORTION_GAIN, 0, false },
+			{ audio_effect::distortion, AL_DISTORTION_LOWPASS_CUTOFF, 0, false },
+			{ audio_effect::flanger, AL_FLANGER_RATE, 0, false },
+			{ audio_effect::flanger, AL_FLANGER_DEPTH, 0, false },
+			{ audio_effect::flanger, AL_FLANGER_FEEDBACK, 0, false },
+			{ audio_effect::equalizer, AL_EQUALIZER_LOW_GAIN, 0, false },
+			{ audio_effect::equalizer, AL_EQUALIZER_MID1_GAIN, 0, false },
+			{ audio_effect::equalizer, AL_EQUALIZER_HIGH_GAIN, 0, false },
+			{ audio_effect::frequency_shifter, AL_FREQUENCY_SHIFTER_FREQUENCY, 0, false },
+			{ audio_effect::frequency_shifter, AL_FREQUENCY_SHIFTER_LEFT_DIRECTION, AL_FREQUENCY_SHIFTER_RIGHT_DIRECTION, true },
+			{ audio_effect::autowah, AL_AUTOWAH_ATTACK_TIME, 0, false },
+			{ audio_effect::autowah, AL_AUTOWAH_RELEASE_TIME, 0, false },
+			{ audio_effect::autowah, AL_AUTOWAH_RESONANCE, 0, false },
+			{ audio_effect::ring_modulator, AL_RING_MODULATOR_FREQUENCY, 0, false },
+			{ audio_effect::ring_modulator, AL_RING_MODULATOR_HIGHPASS_CUTOFF, 0, false }
+		};
+
+		ALenum get_al_effect_type(audio_effect type)
+		{
+			switch (type)
+			{
+			case audio_effect::reverb:				return AL_EFFECT_REVERB;
+			case audio_effect::echo:				return AL_EFFECT_ECHO;
+			case audio_effect::chorus:				return AL_EFFECT_CHORUS;
+			case audio_effect::distortion:			return AL_EFFECT_DISTORTION;
+			case audio_effect::flanger:				return AL_EFFECT_FLANGER;
+			case audio_effect::equalizer:			return AL_EFFECT_EQUALIZER;
+			case audio_effect::frequency_shifter:	return AL_EFFECT_FREQUENCY_SHIFTER;
+			case audio_effect::autowah:				return AL_EFFECT_AUTOWAH;
+			case audio_effect::ring_modulator:		return AL_EFFECT_RING_MODULATOR;
+			case audio_effect::unknown:
+				break;
+			}
+
+			return AL_EFFECT_NULL;
 		}
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_REVERB);
-		alEffectf(effect, AL_REVERB_DECAY_TIME, decay_time);
-		alEffectf(effect, AL_REVERB_DENSITY, density);
+		bool set_effect_param(ALuint effect, audio_effect type, effect_param param, float value)
+		{
+			const size_t index = static_cast<size_t>(param);
+			if (index >= std::size(param_infos) || param_infos[index].type != type)
+				return false;
 
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
+			const param_info& info = param_infos[index];
+			if (info.integer)
+			{
+				alEffecti(effect, info.param, static_cast<ALint>(value));
+				if (info.second_param != 0)
+					alEffecti(effect, info.second_param, static_cast<ALint>(value));
+			}
+			else
+			{
+				alEffectf(effect, info.param, value);
+				if (info.second_param != 0)
+					alEffectf(effect, info.second_param, value);
+			}
 
-		if (alGetError() != AL_NO_ERROR)
-		{
-			log::warn("Error attaching reverb effect to source!");
+			return true;
 		}
-		else
+
+		void erase_if_unused(ALuint source_handle)
 		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::reverb
-			};
+			auto it = s_data.source_sends.find(source_handle);
+			if (it != s_data.source_sends.end() && std::ranges::all_of(it->second, [](const audio_effect_instance* instance) { return instance == nullptr; }))
+				s_data.source_sends.erase(it);
 		}
 	}
 
-	void audio_effect_manager::apply_echo(const std::shared_ptr<audio_source>& source, float delay, float damping)
+	audio_effect_instance::audio_effect_instance(audio_effect type) : m_type(type)
 	{
-		if (!source)
+		const ALenum al_type = get_al_effect_type(type);
+		if (al_type == AL_EFFECT_NULL)
 		{
-			log::error("Unloaded audio source passed to audio effect manager!");
+			log::error("Unknown effect type passed to audio effect instance!");
 			return;
 		}
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_ECHO);
-		alEffectf(effect, AL_ECHO_DELAY, delay);
-		alEffectf(effect, AL_ECHO_DAMPING, damping);
-
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
+		alGenEffects(1, &m_effect);
+		alEffecti(m_effect, AL_EFFECT_TYPE, al_type);
+		alGenAuxiliaryEffectSlots(1, &m_slot);
+		alAuxiliaryEffectSloti(m_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(m_effect));
 
 		if (alGetError() != AL_NO_ERROR)
 		{
-			log::warn("Error attaching echo effect to source!");
-		}
-		else
-		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::echo
-			};
+			log::error("Error creating effect instance!");
+			alDeleteAuxiliaryEffectSlots(1, &m_slot);
+			alDeleteEffects(1, &m_effect);
+			m_slot = 0;
+			m_effect = 0;
 		}
 	}
 
-	void audio_effect_manager::apply_chorus(const std::shared_ptr<audio_source>& source, float rate, float depth, float feedback)
+	audio_effect_instance::~audio_effect_instance()
 	{
-		if (!source)
-		{
-			log::error("Unloaded audio source passed to audio effect manager!");
+		if (!is_valid() || !audio_engine::is_active())
 			return;
-		}
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_CHORUS);
-		alEffectf(effect, AL_CHORUS_RATE, rate);
-		alEffectf(effect, AL_CHORUS_DEPTH, depth);
-		alEffectf(effect, AL_CHORUS_FEEDBACK, feedback);
-
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
+		// A slot that a source still feeds cannot be deleted.
+		detach_all();
+		alDeleteAuxiliaryEffectSlots(1, &m_slot);
+		alDeleteEffects(1, &m_effect);
+	}
 
-		if (alGetError() != AL_NO_ERROR)
-		{
-			log::warn("Error attaching chorus effect to source!");
-		}
-		else
+	bool audio_effect_instance::set_param(effect_param param, float value)
+	{
+		if (!set_effect_param(m_effect, m_type, param, value))
 		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::chorus
-			};
+			log::error("Effect parameter {} does not belong to this effect type!", static_cast<int>(param));
+			return false;
 		}
+
+		// Slots copy the effect when it is loaded into them.
+		alAuxiliaryEffectSloti(m_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(m_effect));
+		return true;
 	}
 
-	void audio_effect_manager::apply_distortion(const std::shared_ptr<audio_source>& source, float edge, float gain, float lowpass_cutoff)
+	void audio_effect_instance::set_gain(float gain)
+	{
+		alAuxiliaryEffectSlotf(m_slot, AL_EFFECTSLOT_GAIN, gain);
+	}
+
+	bool audio_effect_instance::attach(const std::shared_ptr<audio_source>& source, const bus_send& send)
 	{
 		if (!source)
 		{
-			log::error("Unloaded audio source passed to audio effect manager!");
-			return;
+			log::error("Unloaded audio source passed to audio effect instance!");
+			return false;
 		}
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_DISTORTION);
-		alEffectf(effect, AL_DISTORTION_EDGE, edge);
-		alEffectf(effect, AL_DISTORTION_GAIN, gain);
-		alEffectf(effect, AL_DISTORTION_LOWPASS_CUTOFF, lowpass_cutoff);
+		if (!is_valid())
+			return false;
 
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
+		const ALuint source_handle = source->m_source_handle;
+		std::vector<audio_effect_instance*>& sends = s_data.source_sends[source_handle];
+		if (sends.empty())
+			sends.resize(static_cast<size_t>(std::max(openal_backend::get_max_auxiliary_sends(), 1)));
 
-		if (alGetError() != AL_NO_ERROR)
-		{
-			log::warn("Error attaching distortion effect to source!");
-		}
-		else
+		auto it = std::ranges::find(sends, this);
+		if (it == sends.end())
+			it = std::ranges::find(sends, nullptr);
+
+		if (it == sends.end())
 		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::distortion
-			};
+			log::warn("Every auxiliary send of the source is in use!");
+			erase_if_unused(source_handle);
+			return false;
 		}
-	}
 
-	void audio_effect_manager::apply_flanger(const std::shared_ptr<audio_source>& source, float rate, float depth, float feedback)
-	{
-		if (!source)
+		ALint filter = AL_FILTER_NULL;
+		if (send.gain != 1.0f || send.gain_hf != 1.0f)
 		{
-			log::error("Unloaded audio source passed to audio effect manager!");
-			return;
+			if (s_data.send_filter == 0)
+			{
+				alGenFilters(1, &s_data.send_filter);
+				alFilteri(s_data.send_filter, AL_FILTER_TYPE, AL_FILTER_LOWPASS);
+			}
+			alFilterf(s_data.send_filter, AL_LOWPASS_GAIN, send.gain);
+			alFilterf(s_data.send_filter, AL_LOWPASS_GAINHF, send.gain_hf);
+			filter = static_cast<ALint>(s_data.send_filter);
 		}
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_FLANGER);
-		alEffectf(effect, AL_FLANGER_RATE, rate);
-		alEffectf(effect, AL_FLANGER_DEPTH, depth);
-		alEffectf(effect, AL_FLANGER_FEEDBACK, feedback);
-
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
-
+		alSource3i(source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(m_slot), static_cast<ALint>(it - sends.begin()), filter);
 		if (alGetError() != AL_NO_ERROR)
 		{
-			log::warn("Error attaching flanger effect to source!");
+			log::warn("Error attaching effect to source!");
+			erase_if_unused(source_handle);
+			return false;
 		}
-		else
+
+		if (*it == nullptr)
 		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::flanger
-			};
+			*it = this;
+			m_sources.push_back(source_handle);
 		}
+
+		return true;
 	}
 
-	void audio_effect_manager::apply_equalizer(const std::shared_ptr<audio_source>& source, float low_gain, float mid_gain, float high_gain)
+	void audio_effect_instance::detach(const std::shared_ptr<audio_source>& source)
 	{
-		if (!source)
+		if (source)
+			detach(source->m_source_handle);
+	}
+
+	void audio_effect_instance::detach(uint32_t source_handle)
+	{
+		auto it = s_data.source_sends.find(source_handle);
+		if (it != s_data.source_sends.end())
 		{
-			log::error("Unloaded audio source passed to audio effect manager!");
-			return;
+			std::vector<audio_effect_instance*>& sends = it->second;
+			auto send = std::ranges::find(sends, this);
+			if (send != sends.end())
+			{
+				alSource3i(source_handle, AL_AUXILIARY_SEND_FILTER, AL_EFFECTSLOT_NULL, static_cast<ALint>(send - sends.begin()), AL_FILTER_NULL);
+				*send = nullptr;
+				erase_if_unused(source_handle);
+			}
 		}
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_EQUALIZER);
-		alEffectf(effect, AL_EQUALIZER_LOW_GAIN, low_gain);
-		alEffectf(effect, AL_EQUALIZER_MID1_GAIN, mid_gain);
-		alEffectf(effect, AL_EQUALIZER_HIGH_GAIN, high_gain);
+		std::erase(m_sources, source_handle);
+	}
 
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
+	void audio_effect_instance::detach_all()
+	{
+		while (!m_sources.empty())
+			detach(m_sources.back());
+	}
 
-		if (alGetError() != AL_NO_ERROR)
+	void audio_effect_manager::apply_effect(const std::shared_ptr<audio_source>& source, audio_effect type, std::initializer_list<std::pair<effect_param, float>> params, const char* name)
+	{
+		if (!source)
 		{
-			log::warn("Error attaching equalizer effect to source!");
+			log::error("Unloaded audio source passed to audio effect manager!");
+			return;
 		}
-		else
+
+		auto& effects = s_data.source_effects[source->m_source_handle];
+		auto it = std::ranges::find(effects, type, &audio_effect_instance::get_type);
+		if (it == effects.end())
 		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::equalizer
-			};
+			auto instance = audio_effect_instance::create(type);
+			if (!instance->is_valid() || !instance->attach(source))
+			{
+				log::warn("Error attaching {} effect to source!", name);
+				if (effects.empty())
+					s_data.source_effects.erase(source->m_source_handle);
+				return;
+			}
+			it = effects.insert(effects.end(), std::move(instance));
 		}
+
+		for (const auto& [param, value] : params)
+			(*it)->set_param(param, value);
+	}
+
+	void audio_effect_manager::apply_reverb(const std::shared_ptr<audio_source>& source, float decay_time, float density)
+	{
+		apply_effect(source, audio_effect::reverb, { { effect_param::reverb_decay_time, decay_time }, { effect_param::reverb_density, density } }, "reverb");
+	}
+
+	void audio_effect_manager::apply_echo(const std::shared_ptr<audio_source>& source, float delay, float damping)
+	{
+		apply_effect(source, audio_effect::echo, { { effect_param::echo_delay, delay }, { effect_param::echo_damping, damping } }, "echo");
+	}
+
+	void audio_effect_manager::apply_chorus(const std::shared_ptr<audio_source>& source, float rate, float depth, float feedback)
+	{
+		apply_effect(source, audio_effect::chorus,
+			{ { effect_param::chorus_rate, rate }, { effect_param::chorus_depth, depth }, { effect_param::chorus_feedback, feedback } }, "chorus");
+	}
+
+	void audio_effect_manager::apply_distortion(const std::shared_ptr<audio_source>& source, float edge, float gain, float lowpass_cutoff)
+	{
+		apply_effect(source, audio_effect::distortion,
+			{ { effect_param::distortion_edge, edge }, { effect_param::distortion_gain, gain }, { effect_param::distortion_lowpass_cutoff, lowpass_cutoff } }, "distortion");
+	}
+
+	void audio_effect_manager::apply_flanger(const std::shared_ptr<audio_source>& source, float rate, float depth, float feedback)
+	{
+		apply_effect(source, audio_effect::flanger,
+			{ { effect_param::flanger_rate, rate }, { effect_param::flanger_depth, depth }, { effect_param::flanger_feedback, feedback } }, "flanger");
+	}
+
+	void audio_effect_manager::apply_equalizer(const std::shared_ptr<audio_source>& source, float low_gain, float mid_gain, float high_gain)
+	{
+		apply_effect(source, audio_effect::equalizer,
+			{ { effect_param::equalizer_low_gain, low_gain }, { effect_param::equalizer_mid_gain, mid_gain }, { effect_param::equalizer_high_gain, high_gain } }, "equalizer");
 	}
 
 	void audio_effect_manager::apply_frequency_shifter(const std::shared_ptr<audio_source>& source, float frequency, int direction)
+	{
+		apply_effect(source, audio_effect::frequency_shifter,
+			{ { effect_param::frequency_shifter_frequency, frequency }, { effect_param::frequency_shifter_direction, static_cast<float>(direction) } }, "frequency shifter");
+	}
+
+	void audio_effect_manager::apply_autowah(const std::shared_ptr<audio_source>& source, float attack_time, float release_time, float resonance)
+	{
+		apply_effect(source, audio_effect::autowah,
+			{ { effect_param::autowah_attack_time, attack_time }, { effect_param::autowah_release_time, release_time }, { effect_param::autowah_resonance, resonance } }, "autowah");
+	}
+
+	void audio_effect_manager::apply_ring_modulator(const std::shared_ptr<audio_source>& source, float frequency, float highpass_cutoff)
+	{
+		apply_effect(source, audio_effect::ring_modulator,
+			{ { effect_param::ring_modulator_frequency, frequency }, { effect_param::ring_modulator_highpass_cutoff, highpass_cutoff } }, "ring modulator");
+	}
+
+	void audio_effect_manager::remove_effect(const std::shared_ptr<audio_source>& source, audio_effect type)
 	{
 		if (!source)
 		{
@@ -241,123 +357,145 @@ namespace myro
 			return;
 		}
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_FREQUENCY_SHIFTER);
-		alEffectf(effect, AL_FREQUENCY_SHIFTER_FREQUENCY, frequency);
-		alEffecti(effect, AL_FREQUENCY_SHIFTER_LEFT_DIRECTION, direction);
-		alEffecti(effect, AL_FREQUENCY_SHIFTER_RIGHT_DIRECTION, direction);
+		auto it = s_data.source_effects.find(source->m_source_handle);
+		if (it == s_data.source_effects.end())
+			return;
 
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
+		auto instance = std::ranges::find(it->second, type, &audio_effect_instance::get_type);
+		if (instance == it->second.end())
+			return;
 
-		if (alGetError() != AL_NO_ERROR)
-		{
-			log::warn("Error attaching frequency shifter effect to source!");
-		}
-		else
-		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::frequency_shifter
-			};
-		}
+		// Handles from get_effect may keep the instance alive; the source stops feeding it either way.
+		(*instance)->detach(source);
+		it->second.erase(instance);
+		if (it->second.empty())
+			s_data.source_effects.erase(it);
 	}
 
-	void audio_effect_manager::apply_autowah(const std::shared_ptr<audio_source>& source, float attack_time, float release_time, float resonance)
+	std::shared_ptr<audio_effect_instance> audio_effect_manager::get_effect(const std::shared_ptr<audio_source>& source, audio_effect type)
 	{
 		if (!source)
-		{
-			log::error("Unloaded audio source passed to audio effect manager!");
-			return;
-		}
+			return nullptr;
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_AUTOWAH);
-		alEffectf(effect, AL_AUTOWAH_ATTACK_TIME, attack_time);
-		alEffectf(effect, AL_AUTOWAH_RELEASE_TIME, release_time);
-		alEffectf(effect, AL_AUTOWAH_RESONANCE, resonance);
+		auto it = s_data.source_effects.find(source->m_source_handle);
+		if (it == s_data.source_effects.end())
+			return nullptr;
 
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
+		auto instance = std::ranges::find(it->second, type, &audio_effect_instance::get_type);
+		return instance != it->second.end() ? *instance : nullptr;
+	}
 
-		if (alGetError() != AL_NO_ERROR)
+	bool audio_effect_manager::create_bus(const std::string& name, audio_effect type)
+	{
+		if (s_data.buses.contains(name))
 		{
-			log::warn("Error attaching autowah effect to source!");
+			log::error("An effect bus named {} already exists!", name);
+			return false;
 		}
-		else
+
+		auto instance = audio_effect_instance::create(type);
+		if (!instance->is_valid())
 		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::autowah
-			};
+			log::error("Error creating effect bus {}!", name);
+			return false;
 		}
+
+		s_data.buses.emplace(name, std::move(instance));
+		return true;
 	}
 
-	void audio_effect_manager::apply_ring_modulator(const std::shared_ptr<audio_source>& source, float frequency, float highpass_cutoff)
+	void audio_effect_manager::destroy_bus(const std::string& name)
 	{
-		if (!source)
-		{
-			log::error("Unloaded audio source passed to audio effect manager!");
+		auto it = s_data.buses.find(name);
+		if (it == s_data.buses.end())
 			return;
-		}
 
-		ALuint effect;
-		alGenEffects(1, &effect);
-		alEffecti(effect, AL_EFFECT_TYPE, AL_EFFECT_RING_MODULATOR);
-		alEffectf(effect, AL_RING_MODULATOR_FREQUENCY, frequency);
-		alEffectf(effect, AL_RING_MODULATOR_HIGHPASS_CUTOFF, highpass_cutoff);
+		// Handles the caller still holds keep the effect alive, but it stops feeding anything.
+		it->second->detach_all();
+		s_data.buses.erase(it);
+	}
 
-		ALuint effect_slot;
-		alGenAuxiliaryEffectSlots(1, &effect_slot);
-		alAuxiliaryEffectSloti(effect_slot, AL_EFFECTSLOT_EFFECT, static_cast<ALint>(effect));
-		alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, static_cast<ALint>(effect_slot), 0, AL_FILTER_NULL);
+	bool audio_effect_manager::has_bus(const std::string& name)
+	{
+		return s_data.buses.contains(name);
+	}
 
-		if (alGetError() != AL_NO_ERROR)
+	std::shared_ptr<audio_effect_instance> audio_effect_manager::get_bus(const std::string& name)
+	{
+		auto it = s_data.buses.find(name);
+		return it != s_data.buses.end() ? it->second : nullptr;
+	}
+
+	bool audio_effect_manager::set_bus_param(const std::string& name, effect_param param, float value)
+	{
+		auto bus = get_bus(name);
+		if (!bus)
 		{
-			log::warn("Error attaching ring modulator effect to source!");
+			log::error("No effect bus named {}!", name);
+			return false;
 		}
-		else
+
+		return bus->set_param(param, value);
+	}
+
+	void audio_effect_manager::set_bus_gain(const std::string& name, float gain)
+	{
+		auto bus = get_bus(name);
+		if (!bus)
 		{
-			s_data.effect_datas[source->m_source_handle] = {
-				.slot = effect_slot,
-				.effect = effect,
-				.type = audio_effect::ring_modulator
-			};
+			log::error("No effect bus named {}!", name);
+			return;
 		}
+
+		bus->set_gain(gain);
 	}
 
-	void audio_effect_manager::remove_effect(const std::shared_ptr<audio_source>& source, audio_effect type)
+	bool audio_effect_manager::attach_to_bus(const std::shared_ptr<audio_source>& source, const std::string& name, const bus_send& send)
 	{
-		if (!source)
+		auto bus = get_bus(name);
+		if (!bus)
 		{
-			log::error("Unloaded audio source passed to audio effect manager!");
-			return;
+			log::error("No effect bus named {}!", name);
+			return false;
 		}
 
-		auto it = s_data.effect_datas.find(source->m_source_handle);
-		if (it != s_data.effect_datas.end())
+		return bus->attach(source, send);
+	}
+
+	void audio_effect_manager::detach_from_bus(const std::shared_ptr<audio_source>& source, const std::string& name)
+	{
+		if (auto bus = get_bus(name))
+			bus->detach(source);
+	}
+
+	void audio_effect_manager::release_source(uint32_t source_handle)
+	{
+		auto it = s_data.source_sends.find(source_handle);
+		if (it != s_data.source_sends.end())
 		{
-			if (it->second.type == type)
+			// Detached first, so the instances below can delete their slots.
+			const std::vector<audio_effect_instance*> sends = it->second;
+			for (audio_effect_instance* instance : sends)
 			{
-				ALuint effect_slot = it->second.slot;
-				ALuint effect = it->second.effect;
+				if (instance)
+					instance->detach(source_handle);
+			}
+		}
 
-				alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, AL_EFFECTSLOT_NULL, 0, AL_FILTER_NULL);
-				alDeleteEffects(1, &effect);
-				alDeleteAuxiliaryEffectSlots(1, &effect_slot);
+		s_data.source_effects.erase(source_handle);
+	}
 
-				s_data.effect_datas.erase(it);
-			}
+	void audio_effect_manager::shutdown()
+	{
+		s_data.source_effects.clear();
+		s_data.buses.clear();
+
+		if (s_data.send_filter != 0)
+		{
+			alDeleteFilters(1, &s_data.send_filter);
+			s_data.send_filter = 0;
 		}
 	}
 }
 
-// NOLINTEND(readability-suspicious-call-argument)
\ No newline at end of file
+// NOLINTEND(readability-suspicious-call-argument)
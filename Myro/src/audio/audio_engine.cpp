@@ -2,13 +2,18 @@
 
 #include "audio/listener.h"
 #include "audio/audio_file_format.h"
+#include "audio/audio_effect.h"
+#include "audio/audio_filter.h"
+#include "audio/dsp_chain.h"
 
 #include "core/buffer.h"
 #include "core/log.h"
 #include "core/thread_pool.h"
+#include "core/trace.h"
 
 #include "internal/audio_data.h"
 #include "internal/openal_backend.h"
+#include "internal/engine_metrics.h"
 
 #include "audio/loaders/ogg_loader.h"
 #include "audio/loaders/mp3_loader.h"
@@ -28,6 +33,9 @@
 
 #include <coco.h>
 
+#include <atomic>
+#include <chrono>
+
 #ifdef _MSC_VER
 #pragma warning(push)
 #pragma warning(disable: 26813) // intellisense is just being dramatic...
@@ -41,12 +49,26 @@ namespace myro
 		thread_pool tpool{ 1 };
 		std::vector<std::weak_ptr<audio_source>> loaded_sources;
 		std::mutex sources_mutex;
+		std::atomic<bool> retain_pcm{ false };
+
+		std::chrono::steady_clock::time_point init_time = std::chrono::steady_clock::now();
+
+		// Rate window for engine_stats::loads_per_second.
+		std::mutex rate_mutex;
+		std::chrono::steady_clock::time_point rate_time = std::chrono::steady_clock::now();
+		uint64_t rate_loads = 0;
+		double loads_per_second = 0.0;
 	};
 
 	namespace
 	{
 		engine_data s_data;
 
+		uint64_t to_microseconds(double milliseconds)
+		{
+			return static_cast<uint64_t>(std::max(milliseconds, 0.0) * 1000.0);
+		}
+
 		void init_this_thread_loaders(uint32_t flag)
 		{
 			if(flag & static_cast<uint32_t>(audio_file_format::ogg))
@@ -63,6 +85,34 @@ namespace myro
 				speex_loader::init();
 		}
 
+		raw_buffer decode_with_loader(const std::filesystem::path& filepath, audio_file_format format)
+		{
+			switch (format)
+			{
+			case audio_file_format::ogg: return ogg_loader::load(filepath);
+			case audio_file_format::mp3: return mp3_loader::load(filepath);
+			case audio_file_format::wav: return wav_loader::load(filepath);
+			case audio_file_format::opus:return opus_loader::load(filepath);
+			case audio_file_format::spx: return speex_loader::load(filepath);
+			case audio_file_format::flac:return flac_loader::load(filepath);
+			case audio_file_format::unknown: break;
+			}
+
+			return {};
+		}
+
+		// The decoded samples rendered through a chain; empty when the chain cannot be baked.
+		bool bake_samples(raw_buffer& buf, const dsp_chain& chain, std::vector<short>& baked)
+		{
+			audio_data& data = buf.load<audio_data>();
+			if (!data.buffer)
+				return false;
+
+			const short* samples = data.buffer.as<short>();
+			baked.assign(samples, samples + data.buffer.size / sizeof(short));
+			return chain.bake(baked, static_cast<uint32_t>(data.sample_rate), data.al_format == AL_FORMAT_STEREO16 ? 2 : 1);
+		}
+
 		void shutdown_this_thread_loaders(uint32_t flag)
 		{
 			if (flag & static_cast<uint32_t>(audio_file_format::ogg))
@@ -93,6 +143,7 @@ namespace myro
 			static_cast<uint32_t>(audio_file_format::opus) |
 			static_cast<uint32_t>(audio_file_format::spx));
 
+		s_data.init_time = std::chrono::steady_clock::now();
 		s_data.active = true;
 	}
 
@@ -114,6 +165,8 @@ namespace myro
 
 		s_data.loaded_sources.clear();
 
+		audio_effect_manager::shutdown();
+		audio_filter_manager::shutdown();
 		openal_backend::shutdown();
 
 		s_data.active = false;
@@ -139,8 +192,9 @@ namespace myro
 		return thread_pool::max_thread_count();
 	}
 
-	std::shared_ptr<audio_source> audio_engine::load_audio_source(const std::filesystem::path& filepath)
+	std::shared_ptr<audio_source> audio_engine::load_audio_source(const std::filesystem::path& filepath, const std::shared_ptr<const dsp_chain>& bake)
 	{
+		MYRO_TRACE_SCOPE("load");
 		auto format = get_file_format(filepath);
 
 		if (format == audio_file_format::unknown)
@@ -149,44 +203,69 @@ namespace myro
 			return nullptr;
 		}
 
-		raw_buffer buf;
-
 		coco::timer<coco::time_units::milliseconds> timer;
-
-		switch (format)
-		{
-		case audio_file_format::ogg: buf = ogg_loader::load(filepath); break;
-		case audio_file_format::mp3: buf = mp3_loader::load(filepath); break;
-		case audio_file_format::wav: buf = wav_loader::load(filepath); break;
-		case audio_file_format::opus:buf = opus_loader::load(filepath); break;
-		case audio_file_format::spx: buf = speex_loader::load(filepath); break;
-		case audio_file_format::flac:buf = flac_loader::load(filepath); break;
-		case audio_file_format::unknown: break;
-		}
-
+		raw_buffer buf = decode_with_loader(filepath, format);
 		timer.stop();
 		log::debug("{0} file loading took: {1}ms", filepath.extension(), timer.get_time());
 
+		engine_metrics& metrics = engine_metrics::get();
+		engine_metrics::codec& codec = metrics.codecs[engine_metrics::codec_index(format)];
+		codec.decode_time_us.record(to_microseconds(timer.get_time()));
+
 		if (!buf.data)
 		{
+			codec.failures.fetch_add(1, std::memory_order_relaxed);
 			log::error("Error while loading {} audio source!", filepath.extension());
 			return nullptr;
 		}
 
+		// Counted before baking: the tail a chain adds is not decoded audio.
+		const uint64_t decoded_bytes = buf.load<audio_data>().buffer.size;
+
+		std::vector<short> baked;
+		if (bake)
+		{
+			timer.start();
+			const bool baked_ok = bake_samples(buf, *bake, baked);
+			timer.stop();
+			log::debug("Baking {0} took: {1}ms", filepath.filename(), timer.get_time());
+
+			// The caller asked for the processed sound; playing the dry clip instead would go unnoticed.
+			if (!baked_ok)
+			{
+				codec.failures.fetch_add(1, std::memory_order_relaxed);
+				log::error("Could not bake {}, it was not loaded!", filepath.filename());
+				buf.load<audio_data>().buffer.release();
+				buf.release();
+				return nullptr;
+			}
+		}
+
 		timer.start();
-		auto result = load_audio_source_al(buf);
+		auto result = load_audio_source_al(buf, std::move(baked));
 		timer.stop();
 
 		log::debug("Audio source loading took: {}ms", timer.get_time());
 
-		s_data.loaded_sources.emplace_back(result);
+		if (result)
+		{
+			metrics.upload_time_us.record(to_microseconds(timer.get_time()));
+			metrics.loads.fetch_add(1, std::memory_order_relaxed);
+			codec.loads.fetch_add(1, std::memory_order_relaxed);
+			codec.bytes_decoded.fetch_add(decoded_bytes, std::memory_order_relaxed);
+		}
+		else
+		{
+			codec.failures.fetch_add(1, std::memory_order_relaxed);
+		}
 
+		track_source(result);
 		return result;
 	}
 
-	std::vector<std::shared_ptr<audio_source>> audio_engine::multi_load_audio_source(const std::vector<std::filesystem::path>& filepaths)
+	std::vector<std::shared_ptr<audio_source>> audio_engine::multi_load_audio_source(const std::vector<std::filesystem::path>& filepaths, const std::shared_ptr<const dsp_chain>& bake)
 	{
-		return s_data.tpool.enqueue_bulk([](const std::filesystem::path& filepath) 
+		return s_data.tpool.enqueue_bulk([bake](const std::filesystem::path& filepath) 
 			{
 				audio_file_format format = get_file_format(filepath);
 				uint32_t flags = static_cast<uint32_t>(format);
@@ -204,12 +283,49 @@ namespace myro
 				}
 
 			init_this_thread_loaders(flags);
-			auto result = load_audio_source(filepath);
+			auto result = load_audio_source(filepath, bake);
 			shutdown_this_thread_loaders(flags);
 			return result;
 			}, filepaths);
 	}
 
+	std::shared_ptr<decoded_audio> audio_engine::decode_audio_file(const std::filesystem::path& filepath)
+	{
+		MYRO_TRACE_SCOPE("decode file");
+		const audio_file_format format = get_file_format(filepath);
+		if (format == audio_file_format::unknown)
+		{
+			log::error("Unknown file format: {}", filepath.extension());
+			return nullptr;
+		}
+
+		coco::timer<coco::time_units::milliseconds> timer;
+		raw_buffer buf = decode_with_loader(filepath, format);
+		timer.stop();
+
+		engine_metrics::codec& codec = engine_metrics::get().codecs[engine_metrics::codec_index(format)];
+		codec.decode_time_us.record(to_microseconds(timer.get_time()));
+
+		audio_data data = buf.data ? buf.load<audio_data>() : audio_data{};
+		if (!data.buffer)
+		{
+			codec.failures.fetch_add(1, std::memory_order_relaxed);
+			log::error("Error while decoding {}!", filepath);
+			return nullptr;
+		}
+
+		auto result = std::make_shared<decoded_audio>();
+		const short* samples = data.buffer.as<short>();
+		result->samples.assign(samples, samples + data.buffer.size / sizeof(short));
+		result->sample_rate = static_cast<uint32_t>(data.sample_rate);
+		result->channels = data.al_format == AL_FORMAT_STEREO16 ? 2 : 1;
+		codec.bytes_decoded.fetch_add(data.buffer.size, std::memory_order_relaxed);
+
+		data.buffer.release();
+		buf.release();
+		return result;
+	}
+
 	void audio_engine::unload_audio_source(const std::shared_ptr<audio_source>& source)
 	{
 		if (!source)
@@ -226,13 +342,90 @@ namespace myro
 		std::ranges::for_each(sources.begin(), sources.end(), [](const std::shared_ptr<audio_source>& ptr) { if (ptr) ptr->unload(); });
 	}
 
+	void audio_engine::track_source(const std::shared_ptr<audio_source>& source)
+	{
+		// multi_load_audio_source runs this on several pool workers at once
+		std::lock_guard<std::mutex> lock(s_data.sources_mutex);
+		s_data.loaded_sources.emplace_back(source);
+	}
+
 	void audio_engine::cleanup_expired_sources()
 	{
+		std::lock_guard<std::mutex> lock(s_data.sources_mutex);
 		auto it = std::ranges::remove_if(s_data.loaded_sources.begin(), s_data.loaded_sources.end(),
 			[](const std::weak_ptr<audio_source>& wptr) { return wptr.expired(); });
 		s_data.loaded_sources.erase(it.begin(), s_data.loaded_sources.end());
 	}
 
+	void audio_engine::set_retain_pcm(bool retain)
+	{
+		s_data.retain_pcm.store(retain, std::memory_order_relaxed);
+	}
+
+	bool audio_engine::get_retain_pcm()
+	{
+		return s_data.retain_pcm.load(std::memory_order_relaxed);
+	}
+
+	engine_metrics& engine_metrics::get()
+	{
+		static engine_metrics metrics;
+		return metrics;
+	}
+
+	engine_stats audio_engine::get_stats()
+	{
+		const auto now = std::chrono::steady_clock::now();
+		const engine_metrics& metrics = engine_metrics::get();
+		const auto gauge = [](const std::atomic<int64_t>& value) { return static_cast<uint64_t>(std::max<int64_t>(value.load(std::memory_order_relaxed), 0)); };
+
+		engine_stats stats;
+		stats.uptime_seconds = std::chrono::duration<double>(now - s_data.init_time).count();
+		stats.loads = metrics.loads.load(std::memory_order_relaxed);
+
+		{
+			std::lock_guard<std::mutex> lock(s_data.rate_mutex);
+			const double elapsed = std::chrono::duration<double>(now - s_data.rate_time).count();
+			if (elapsed >= 1.0)
+			{
+				s_data.loads_per_second = static_cast<double>(stats.loads - s_data.rate_loads) / elapsed;
+				s_data.rate_loads = stats.loads;
+				s_data.rate_time = now;
+			}
+			stats.loads_per_second = s_data.loads_per_second;
+		}
+
+		for (size_t i = 0; i < stats.codecs.size(); ++i)
+		{
+			const engine_metrics::codec& codec = metrics.codecs[i];
+			stats.codecs[i].format = static_cast<audio_file_format>(1u << (i + 1));
+			stats.codecs[i].loads = codec.loads.load(std::memory_order_relaxed);
+			stats.codecs[i].failures = codec.failures.load(std::memory_order_relaxed);
+			stats.codecs[i].bytes_decoded = codec.bytes_decoded.load(std::memory_order_relaxed);
+			stats.codecs[i].decode_time_us = codec.decode_time_us.snapshot();
+		}
+		stats.upload_time_us = metrics.upload_time_us.snapshot();
+
+		stats.resident_pcm_bytes = gauge(metrics.resident_pcm_bytes);
+		stats.retained_pcm_bytes = gauge(metrics.retained_pcm_bytes);
+		stats.live_sources = gauge(metrics.live_sources);
+		stats.al_sources = gauge(metrics.al_sources);
+		{
+			std::lock_guard<std::mutex> lock(s_data.sources_mutex);
+			stats.tracked_sources = s_data.loaded_sources.size();
+		}
+
+		stats.pool_threads = s_data.tpool.thread_count();
+		stats.pool_queue_depth = s_data.tpool.queue_depth();
+		stats.pool_wait_time_us = s_data.tpool.wait_times();
+
+		stats.capture_overruns = metrics.capture_overruns.load(std::memory_order_relaxed);
+		stats.capture_dropped_frames = metrics.capture_dropped_frames.load(std::memory_order_relaxed);
+		stats.encoder_backlog_frames = gauge(metrics.encoder_backlog_frames);
+		stats.peak_encoder_backlog_frames = metrics.peak_encoder_backlog_frames.load(std::memory_order_relaxed);
+		return stats;
+	}
+
 	void audio_engine::play(const std::shared_ptr<audio_source>& source)
 	{
 		if (!source || !source->m_loaded)
@@ -241,6 +434,12 @@ namespace myro
 			return;
 		}
 
+		// OpenAL plays a stopped or playing source from the start; an attached chain has to follow.
+		ALint state = AL_INITIAL;
+		alGetSourcei(source->m_source_handle, AL_SOURCE_STATE, &state);
+		if (state == AL_STOPPED || state == AL_PLAYING)
+			dsp_chain::restart_source(source->m_source_handle, 0.0f);
+
 		alSourcePlay(source->m_source_handle);
 	}
 
@@ -253,6 +452,7 @@ namespace myro
 		}
 
 		alSourceStop(source->m_source_handle);
+		dsp_chain::restart_source(source->m_source_handle, 0.0f);
 	}
 
 	void audio_engine::pause(const std::shared_ptr<audio_source>& source)
@@ -275,6 +475,7 @@ namespace myro
 		}
 
 		alSourceRewind(source->m_source_handle);
+		dsp_chain::restart_source(source->m_source_handle, 0.0f);
 	}
 
 	void audio_engine::seek(const std::shared_ptr<audio_source>& source, float seconds)
@@ -292,6 +493,7 @@ namespace myro
 		}
 
 		alSourcef(source->m_source_handle, AL_SEC_OFFSET, seconds);
+		dsp_chain::restart_source(source->m_source_handle, seconds);
 	}
 
 	void audio_engine::set_doppler_factor(float factor)
@@ -329,8 +531,9 @@ namespace myro
 		}
 	}
 
-	std::shared_ptr<audio_source> audio_engine::load_audio_source_al(raw_buffer buf)
+	std::shared_ptr<audio_source> audio_engine::load_audio_source_al(raw_buffer buf, std::vector<short> baked)
 	{
+		MYRO_TRACE_SCOPE("al upload");
 		audio_data data = buf.load<audio_data>();
 
 		if (!data.buffer)
@@ -339,18 +542,42 @@ namespace myro
 			return nullptr;
 		}
 
+		// Every loader hands over 16-bit PCM.
+		const uint16_t channels = data.al_format == AL_FORMAT_STEREO16 ? 2 : 1;
+		const short* samples = baked.empty() ? data.buffer.as<short>() : baked.data();
+		const size_t sample_count = baked.empty() ? data.buffer.size / sizeof(short) : baked.size();
+		const uint64_t bytes = sample_count * sizeof(short);
+
 		ALuint buffer;
 		alGenBuffers(1, &buffer);
-		alBufferData(buffer, data.al_format, data.buffer.as<ALvoid>(), static_cast<ALsizei>(data.buffer.size), static_cast<ALsizei>(data.sample_rate));
+		alBufferData(buffer, data.al_format, samples, static_cast<ALsizei>(bytes), static_cast<ALsizei>(data.sample_rate));
 
 		std::shared_ptr<audio_source> result_source = std::make_shared<audio_source>();
 		result_source->m_buffer_handle = buffer;
 		result_source->m_loaded = true;
-		result_source->m_total_duration = data.track_length;
+		// A baked tail makes the clip longer than the decoded one.
+		result_source->m_total_duration = baked.empty() ? data.track_length
+			: static_cast<float>(sample_count / channels) / static_cast<float>(data.sample_rate);
+		result_source->m_buffer_bytes = bytes;
 
 		alGenSources(1, &result_source->m_source_handle);
 		alSourcei(result_source->m_source_handle, AL_BUFFER, static_cast<ALint>(buffer));
 
+		if (s_data.retain_pcm.load(std::memory_order_relaxed))
+		{
+			result_source->m_pcm = baked.empty() ? std::make_shared<const std::vector<short>>(samples, samples + sample_count)
+				: std::make_shared<const std::vector<short>>(std::move(baked));
+			result_source->m_sample_rate = static_cast<uint32_t>(data.sample_rate);
+			result_source->m_channels = channels;
+		}
+
+		engine_metrics& metrics = engine_metrics::get();
+		metrics.al_sources.fetch_add(1, std::memory_order_relaxed);
+		metrics.live_sources.fetch_add(1, std::memory_order_relaxed);
+		metrics.resident_pcm_bytes.fetch_add(static_cast<int64_t>(result_source->m_buffer_bytes), std::memory_order_relaxed);
+		if (result_source->m_pcm)
+			metrics.retained_pcm_bytes.fetch_add(static_cast<int64_t>(result_source->m_pcm->size() * sizeof(short)), std::memory_order_relaxed);
+
 		data.buffer.release();
 		buf.release();
 
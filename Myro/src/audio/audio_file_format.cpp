@@ -23,5 +23,21 @@ namespace myro
     {
         return get_file_format(std::filesystem::path(filepath));
     }
-}
 
+    std::string get_file_extension(audio_file_format format)
+    {
+        switch (format)
+        {
+        case audio_file_format::ogg:  return ".ogg";
+        case audio_file_format::mp3:  return ".mp3";
+        case audio_file_format::wav:  return ".wav";
+        case audio_file_format::flac: return ".flac";
+        case audio_file_format::opus: return ".opus";
+        case audio_file_format::spx:  return ".spx";
+        case audio_file_format::unknown:
+            break;
+        }
+
+        return {};
+    }
+}
\ No newline at end of file
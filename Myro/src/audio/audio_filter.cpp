@@ -1,4 +1,5 @@
 #include "audio/audio_filter.h"
+#include "audio/audio_engine.h"
 
 #ifdef _MSC_VER
 #pragma warning(push)
@@ -11,77 +12,176 @@
 #pragma warning(pop)
 #endif // _MSC_VER
 
+#include <algorithm>
 #include <unordered_map>
 
 namespace myro
 {
-	struct filter_data
+	struct filter_manager_data
 	{
-		ALuint filter;
-		audio_filter type;
+		// The instance each source uses as its direct filter.
+		std::unordered_map<ALuint, audio_filter_instance*> direct_filters;
+		// Instances made by apply_*, one per source.
+		std::unordered_map<ALuint, std::shared_ptr<audio_filter_instance>> source_filters;
 	};
 
-	struct filter_manager_data
+	namespace
 	{
-		std::unordered_map<ALuint, filter_data> filter_datas;
-	};
+		filter_manager_data s_data;
+
+		ALenum get_al_filter_type(audio_filter type)
+		{
+			switch (type)
+			{
+			case audio_filter::low_pass_filter:		return AL_FILTER_LOWPASS;
+			case audio_filter::high_pass_filter:	return AL_FILTER_HIGHPASS;
+			case audio_filter::unknown:
+				break;
+			}
 
-	namespace { filter_manager_data s_data; }
+			return AL_FILTER_NULL;
+		}
 
-	void audio_filter_manager::apply_low_pass_filter(const std::shared_ptr<audio_source>& source, float gain, float gainHF)
+		ALenum get_al_filter_param(audio_filter type, filter_param param)
+		{
+			switch (param)
+			{
+			case filter_param::gain:	return type == audio_filter::low_pass_filter ? AL_LOWPASS_GAIN : AL_HIGHPASS_GAIN;
+			case filter_param::gain_hf:	return type == audio_filter::low_pass_filter ? AL_LOWPASS_GAINHF : 0;
+			case filter_param::gain_lf:	return type == audio_filter::high_pass_filter ? AL_HIGHPASS_GAINLF : 0;
+			}
+
+			return 0;
+		}
+	}
+
+	audio_filter_instance::audio_filter_instance(audio_filter type) : m_type(type)
 	{
-		if (!source)
+		const ALenum al_type = get_al_filter_type(type);
+		if (al_type == AL_FILTER_NULL)
 		{
-			log::error("Unloaded audio source passed to audio filter manager!");
+			log::error("Unknown filter type passed to audio filter instance!");
 			return;
 		}
 
-		ALuint filter;
-		alGenFilters(1, &filter);
-		alFilteri(filter, AL_FILTER_TYPE, AL_FILTER_LOWPASS);
-		alFilterf(filter, AL_LOWPASS_GAIN, gain);
-		alFilterf(filter, AL_LOWPASS_GAINHF, gainHF);
-		alSourcei(source->m_source_handle, AL_DIRECT_FILTER, static_cast<ALint>(filter));
+		alGenFilters(1, &m_filter);
+		alFilteri(m_filter, AL_FILTER_TYPE, al_type);
 
 		if (alGetError() != AL_NO_ERROR)
 		{
-			log::warn("Error attaching low-pass filter to source!");
+			log::error("Error creating filter instance!");
+			alDeleteFilters(1, &m_filter);
+			m_filter = 0;
 		}
-		else
+	}
+
+	audio_filter_instance::~audio_filter_instance()
+	{
+		if (!is_valid() || !audio_engine::is_active())
+			return;
+
+		remove_all();
+		alDeleteFilters(1, &m_filter);
+	}
+
+	bool audio_filter_instance::set_param(filter_param param, float value)
+	{
+		const ALenum al_param = get_al_filter_param(m_type, param);
+		if (al_param == 0 || !is_valid())
 		{
-			s_data.filter_datas[source->m_source_handle] = {
-				.filter = filter,
-				.type = audio_filter::low_pass_filter
-			};
+			log::error("Filter parameter {} does not belong to this filter type!", static_cast<int>(param));
+			return false;
 		}
+
+		alFilterf(m_filter, al_param, value);
+		for (uint32_t source_handle : m_sources)
+			alSourcei(source_handle, AL_DIRECT_FILTER, static_cast<ALint>(m_filter));
+
+		return true;
 	}
 
-	void audio_filter_manager::apply_high_pass_filter(const std::shared_ptr<audio_source>& source, float gain, float gainLF)
+	bool audio_filter_instance::apply(const std::shared_ptr<audio_source>& source)
 	{
 		if (!source)
 		{
-			log::error("Unloaded audio source passed to audio filter manager!");
-			return;
+			log::error("Unloaded audio source passed to audio filter instance!");
+			return false;
 		}
 
-		ALuint filter;
-		alGenFilters(1, &filter);
-		alFilteri(filter, AL_FILTER_TYPE, AL_FILTER_HIGHPASS);
-		alFilterf(filter, AL_HIGHPASS_GAIN, gain);
-		alFilterf(filter, AL_HIGHPASS_GAINLF, gainLF);
-		alSourcei(source->m_source_handle, AL_DIRECT_FILTER, static_cast<ALint>(filter));
+		if (!is_valid())
+			return false;
 
+		const ALuint source_handle = source->m_source_handle;
+		alSourcei(source_handle, AL_DIRECT_FILTER, static_cast<ALint>(m_filter));
 		if (alGetError() != AL_NO_ERROR)
 		{
-			log::warn("Error attaching high-pass filter to source!");
+			log::warn("Error attaching filter to source!");
+			return false;
 		}
-		else
+
+		audio_filter_instance*& current = s_data.direct_filters[source_handle];
+		if (current != this)
 		{
-			s_data.filter_datas[source->m_source_handle] = {
-				.filter = filter,
-				.type = audio_filter::high_pass_filter
-			};
+			if (current)
+				std::erase(current->m_sources, source_handle);
+			current = this;
+			m_sources.push_back(source_handle);
 		}
+
+		return true;
+	}
+
+	void audio_filter_instance::remove(const std::shared_ptr<audio_source>& source)
+	{
+		if (source)
+			remove(source->m_source_handle);
+	}
+
+	void audio_filter_instance::remove(uint32_t source_handle)
+	{
+		auto it = s_data.direct_filters.find(source_handle);
+		if (it != s_data.direct_filters.end() && it->second == this)
+		{
+			alSourcei(source_handle, AL_DIRECT_FILTER, AL_FILTER_NULL);
+			s_data.direct_filters.erase(it);
+		}
+
+		std::erase(m_sources, source_handle);
+	}
+
+	void audio_filter_instance::remove_all()
+	{
+		while (!m_sources.empty())
+			remove(m_sources.back());
+	}
+
+	void audio_filter_manager::apply_filter(const std::shared_ptr<audio_source>& source, audio_filter type, filter_param second_param, float gain, float second_gain)
+	{
+		if (!source)
+		{
+			log::error("Unloaded audio source passed to audio filter manager!");
+			return;
+		}
+
+		std::shared_ptr<audio_filter_instance>& instance = s_data.source_filters[source->m_source_handle];
+		if (!instance || instance->get_type() != type)
+			instance = audio_filter_instance::create(type);
+
+		instance->set_param(filter_param::gain, gain);
+		instance->set_param(second_param, second_gain);
+
+		if (!instance->apply(source))
+			s_data.source_filters.erase(source->m_source_handle);
+	}
+
+	void audio_filter_manager::apply_low_pass_filter(const std::shared_ptr<audio_source>& source, float gain, float gainHF)
+	{
+		apply_filter(source, audio_filter::low_pass_filter, filter_param::gain_hf, gain, gainHF);
+	}
+
+	void audio_filter_manager::apply_high_pass_filter(const std::shared_ptr<audio_source>& source, float gain, float gainLF)
+	{
+		apply_filter(source, audio_filter::high_pass_filter, filter_param::gain_lf, gain, gainLF);
 	}
 
 	void audio_filter_manager::remove_filter(const std::shared_ptr<audio_source>& source, audio_filter type)
@@ -92,19 +192,34 @@ namespace myro
 			return;
 		}
 
-		auto it = s_data.filter_datas.find(source->m_source_handle);
-		if (it != s_data.filter_datas.end())
+		auto it = s_data.source_filters.find(source->m_source_handle);
+		if (it != s_data.source_filters.end() && it->second->get_type() == type)
 		{
-			if (it->second.type == type)
-			{
-				ALuint filter = it->second.filter;
+			it->second->remove(source);
+			s_data.source_filters.erase(it);
+		}
+	}
 
-				alSource3i(source->m_source_handle, AL_AUXILIARY_SEND_FILTER, AL_EFFECTSLOT_NULL, 0, AL_FILTER_NULL);
-				alDeleteFilters(1, &filter);
+	std::shared_ptr<audio_filter_instance> audio_filter_manager::get_filter(const std::shared_ptr<audio_source>& source)
+	{
+		if (!source)
+			return nullptr;
 
-				s_data.filter_datas.erase(it);
-			}
-		}
+		auto it = s_data.source_filters.find(source->m_source_handle);
+		return it != s_data.source_filters.end() ? it->second : nullptr;
 	}
-}
 
+	void audio_filter_manager::release_source(uint32_t source_handle)
+	{
+		auto it = s_data.direct_filters.find(source_handle);
+		if (it != s_data.direct_filters.end())
+			it->second->remove(source_handle);
+
+		s_data.source_filters.erase(source_handle);
+	}
+
+	void audio_filter_manager::shutdown()
+	{
+		s_data.source_filters.clear();
+	}
+}
@@ -1,5 +1,10 @@
 #include "audio/audio_source.h"
 #include "audio/audio_engine.h"
+#include "audio/audio_effect.h"
+#include "audio/audio_filter.h"
+#include "audio/dsp_chain.h"
+
+#include "internal/engine_metrics.h"
 
 #include <AL/al.h>
 #include <AL/alext.h>
@@ -20,6 +25,9 @@ namespace myro
 	{
 		if (m_loaded && audio_engine::is_active())
 		{
+			// Chains render from this source; they must stop before it goes away.
+			dsp_chain::release_source(m_source_handle);
+
 			alSourceStop(m_source_handle);
 			alSourcei(m_source_handle, AL_BUFFER, 0);
 
@@ -27,12 +35,26 @@ namespace myro
 			if (buffer != 0)
 				alDeleteBuffers(1, &buffer);
 
+			audio_effect_manager::release_source(m_source_handle);
+			audio_filter_manager::release_source(m_source_handle);
 			alDeleteSources(1, &m_source_handle);
 
+			engine_metrics& metrics = engine_metrics::get();
+			metrics.al_sources.fetch_sub(1, std::memory_order_relaxed);
+			if (m_buffer_bytes > 0)
+			{
+				metrics.live_sources.fetch_sub(1, std::memory_order_relaxed);
+				metrics.resident_pcm_bytes.fetch_sub(static_cast<int64_t>(m_buffer_bytes), std::memory_order_relaxed);
+			}
+			if (m_pcm)
+				metrics.retained_pcm_bytes.fetch_sub(static_cast<int64_t>(m_pcm->size() * sizeof(short)), std::memory_order_relaxed);
+
 			m_source_handle = 0;
 			m_buffer_handle = 0;
 			m_loaded = false;
 			m_total_duration = 0.0f;
+			m_buffer_bytes = 0;
+			m_pcm.reset();
 
 			if (alGetError() != AL_NO_ERROR)
 				log::error("Failed to unload audio source.");
@@ -0,0 +1,442 @@
+#include "audio/convolution_reverb.h"
+#include "audio/audio_engine.h"
+
+#include "core/log.h"
+#include "core/ring_buffer.h"
+#include "core/trace.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable: 5030)
+#endif // _MSC_VER
+#define AL_ALEXT_PROTOTYPES
+#include <AL/al.h>
+#include <AL/alext.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif // _MSC_VER
+
+#include "internal/convolver.h"
+#include "internal/engine_metrics.h"
+#include "internal/openal_backend.h"
+#include "internal/resampler.h"
+#include "internal/simd.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace myro
+{
+	namespace
+	{
+		// Below the last bit of the 16 bit output, even after a loud response.
+		constexpr float silence_threshold = 1e-6f;
+	}
+
+	struct _convolution_send_data
+	{
+		spsc_ring_buffer<float> ring;	// mono, written by the source's chain worker, read by the reverb worker
+		std::atomic<float> gain{ 1.0f };
+		uint32_t sample_rate = 0;		// the reverb's
+		std::vector<float> mono;
+		size_t debt = 0;				// zero-padded frames still to skip when they arrive; reverb worker only
+	};
+
+	struct _convolution_reverb_data
+	{
+		convolution_reverb_options options;
+		uint32_t sample_rate = 0;
+		uint16_t channels = 0;
+		size_t response_frames = 0;
+		std::vector<partitioned_convolver> convolvers;	// one per output channel
+
+		std::mutex sends_mutex;
+		std::vector<std::weak_ptr<_convolution_send_data>> sends;
+		std::vector<std::shared_ptr<_convolution_send_data>> live_sends;	// worker only
+
+		size_t block_frames = 0;
+		size_t target_frames = 0;
+		size_t idle_after = 0;			// silent input frames after which the tail has played out
+		size_t silent_frames = 0;
+		bool idle = false;
+		std::vector<float> mix;
+		std::vector<float> wet;
+		std::vector<float> block;
+		std::vector<short> block_pcm;
+		spsc_ring_buffer<short> ring;
+
+		std::shared_ptr<audio_source> output;
+
+		atomic_histogram block_time_us;
+		std::atomic<uint64_t> blocks{ 0 };
+		std::atomic<uint64_t> underruns{ 0 };
+		std::atomic<uint64_t> busy_ns{ 0 };
+		std::atomic<uint64_t> audio_ns{ 0 };
+
+		std::thread worker;
+		std::atomic<bool> running{ false };
+		std::mutex wake_mutex;
+		std::condition_variable wake;
+
+		void collect_sends()
+		{
+			std::scoped_lock lock(sends_mutex);
+			std::erase_if(sends, [](const std::weak_ptr<_convolution_send_data>& send) { return send.expired(); });
+			for (const auto& send : sends)
+				if (auto locked = send.lock())
+					live_sends.push_back(std::move(locked));
+		}
+
+		// Every send has a full block, or nothing at all; a send that stopped does not hold up the others.
+		[[nodiscard]] bool sends_ready() const
+		{
+			return std::ranges::all_of(live_sends, [this](const std::shared_ptr<_convolution_send_data>& send)
+				{
+					const size_t available = send->ring.size();
+					return available == 0 || available >= send->debt + block_frames;
+				});
+		}
+
+		// Returns whether any send delivered something audible.
+		bool mix_sends()
+		{
+			std::ranges::fill(mix, 0.0f);
+
+			for (const auto& send : live_sends)
+			{
+				size_t available = send->ring.size();
+				const size_t skipped = std::min(send->debt, available);
+				send->ring.skip(skipped);
+				send->debt -= skipped;
+				available -= skipped;
+
+				// A send that got far ahead (its chain prefilled, or we stalled) is pulled back to the target.
+				if (available > 2 * target_frames + block_frames)
+				{
+					send->ring.skip(available - target_frames);
+					available = target_frames;
+				}
+
+				size_t offset = 0;
+				send->ring.read(std::min(available, block_frames), [&](const float* samples, size_t count)
+					{
+						simd::add(samples, mix.data() + offset, count);
+						offset += count;
+					});
+
+				// A short block was padded with silence; the frames it lacked are dropped when they come in,
+				// so the send keeps its place instead of drifting late. A send with nothing is just quiet.
+				if (offset > 0)
+					send->debt = std::min(send->debt + block_frames - offset, target_frames);
+			}
+
+			return std::ranges::any_of(mix, [](float sample) { return std::fabs(sample) > silence_threshold; });
+		}
+
+		void render_block()
+		{
+			if (mix_sends())
+				silent_frames = 0;
+			else
+				silent_frames += block_frames;
+
+			if (silent_frames >= idle_after)
+			{
+				// Nothing left to ring out: skip the convolution until a send is heard again.
+				if (!idle)
+				{
+					for (partitioned_convolver& convolver : convolvers)
+						convolver.clear();
+					std::ranges::fill(block_pcm, short{ 0 });
+					idle = true;
+				}
+			}
+			else
+			{
+				idle = false;
+
+				MYRO_TRACE_SCOPE("convolution block");
+				const auto start = std::chrono::steady_clock::now();
+				for (uint16_t c = 0; c < channels; ++c)
+				{
+					convolvers[c].process(mix.data(), wet.data());
+					for (size_t f = 0; f < block_frames; ++f)
+						block[f * channels + c] = wet[f];
+				}
+				const auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+				block_time_us.record(elapsed / 1000);
+				busy_ns.fetch_add(elapsed, std::memory_order_relaxed);
+				simd::float_to_short(block.data(), block_pcm.data(), block.size());
+			}
+
+			audio_ns.fetch_add(block_frames * 1'000'000'000ull / sample_rate, std::memory_order_relaxed);
+			blocks.fetch_add(1, std::memory_order_relaxed);
+			ring.write(block_pcm.data(), block_pcm.size());
+		}
+
+		void fill()
+		{
+			collect_sends();
+			while (ring.size() / channels < target_frames && ring.write_available() >= block_pcm.size())
+			{
+				// Partial blocks wait for the rest while there is output to spare.
+				if (ring.size() / channels >= std::max(target_frames / 2, block_frames) && !sends_ready())
+					break;
+				render_block();
+			}
+			live_sends.clear();
+		}
+
+		void render_loop()
+		{
+			MYRO_TRACE_THREAD_NAME("myro reverb");
+			simd::flush_denormals();
+
+			const auto interval = std::chrono::milliseconds(std::max<uint64_t>(block_frames * 500ull / sample_rate, 1));
+			std::unique_lock lock(wake_mutex);
+			while (!wake.wait_for(lock, interval, [this]() { return !running.load(std::memory_order_relaxed); }))
+				fill();
+		}
+
+		// OpenAL mixer thread. Never returns short: the reverb plays until it is destroyed.
+		size_t pull(short* out, size_t wanted)
+		{
+			const size_t produced = ring.read(out, std::min(ring.size() / channels, wanted) * channels) / channels;
+			if (produced < wanted)
+			{
+				std::fill(out + produced * channels, out + wanted * channels, short{ 0 });
+				underruns.fetch_add(1, std::memory_order_relaxed);
+			}
+			return wanted;
+		}
+	};
+
+	namespace
+	{
+		ALsizei AL_APIENTRY reverb_callback(ALvoid* userptr, ALvoid* sampledata, ALsizei numbytes)
+		{
+			_convolution_reverb_data* data = static_cast<_convolution_reverb_data*>(userptr);
+			const size_t frame_bytes = sizeof(short) * data->channels;
+			const size_t frames = data->pull(static_cast<short*>(sampledata), static_cast<size_t>(numbytes) / frame_bytes);
+			return static_cast<ALsizei>(frames * frame_bytes);
+		}
+
+		// One channel of the response as floats, band-limited resampled when the rates differ.
+		std::vector<float> extract_channel(const decoded_audio& audio, uint16_t channel, uint32_t sample_rate)
+		{
+			const size_t frames = audio.samples.size() / audio.channels;
+			std::vector<float> result(frames);
+			for (size_t i = 0; i < frames; ++i)
+				result[i] = static_cast<float>(audio.samples[i * audio.channels + channel]);
+
+			if (audio.sample_rate != sample_rate)
+				result = sinc_resampler::resample(result.data(), frames, 1, audio.sample_rate, sample_rate);
+
+			// Resampling changes the tap count; keep the response's gain where normalization is off.
+			const float scale = static_cast<float>(static_cast<double>(audio.sample_rate) / sample_rate) / 32768.0f;
+			for (float& tap : result)
+				tap *= scale;
+			return result;
+		}
+	}
+
+	void convolution_send::set_gain(float gain)
+	{
+		m_data->gain.store(gain, std::memory_order_relaxed);
+	}
+
+	float convolution_send::get_gain() const
+	{
+		return m_data->gain.load(std::memory_order_relaxed);
+	}
+
+	void convolution_send::prepare(uint32_t sample_rate, uint16_t channels)
+	{
+		m_channels = channels;
+		m_rate_matches = sample_rate == m_data->sample_rate;
+		if (!m_rate_matches)
+			log::warn("Convolution send at {} Hz ignored, the reverb runs at {} Hz.", sample_rate, m_data->sample_rate);
+	}
+
+	void convolution_send::process(float* samples, size_t frames)
+	{
+		if (!m_rate_matches || m_channels == 0)
+			return;
+
+		std::vector<float>& mono = m_data->mono;
+		if (mono.size() < frames)
+			mono.resize(frames);
+
+		const float scale = m_data->gain.load(std::memory_order_relaxed) / static_cast<float>(m_channels);
+		for (size_t f = 0; f < frames; ++f)
+		{
+			float sum = 0.0f;
+			for (uint16_t c = 0; c < m_channels; ++c)
+				sum += samples[f * m_channels + c];
+			mono[f] = sum * scale;
+		}
+
+		// A full ring means the reverb is not keeping up; the overflow is dropped.
+		m_data->ring.write(mono.data(), frames);
+	}
+
+	convolution_reverb::convolution_reverb(const std::filesystem::path& impulse_response, const convolution_reverb_options& options)
+		: m_data(new _convolution_reverb_data())
+	{
+		_convolution_reverb_data& data = *m_data;
+		data.options = options;
+
+		const std::shared_ptr<decoded_audio> response = audio_engine::decode_audio_file(impulse_response);
+		if (!response || response->samples.empty() || response->channels == 0)
+		{
+			log::error("Could not load the impulse response {}!", impulse_response);
+			return;
+		}
+
+		data.sample_rate = options.sample_rate != 0 ? options.sample_rate : response->sample_rate;
+		data.channels = std::min<uint16_t>(response->channels, 2);
+
+		std::vector<std::vector<float>> taps(data.channels);
+		double energy = 0.0;
+		for (uint16_t c = 0; c < data.channels; ++c)
+		{
+			taps[c] = extract_channel(*response, c, data.sample_rate);
+			for (float tap : taps[c])
+				energy += static_cast<double>(tap) * tap;
+		}
+		data.response_frames = taps[0].size();
+
+		if (options.normalize && energy > 0.0)
+		{
+			const float scale = static_cast<float>(1.0 / std::sqrt(energy / data.channels));
+			for (auto& channel : taps)
+				for (float& tap : channel)
+					tap *= scale;
+		}
+
+		data.block_frames = std::bit_ceil(std::clamp<size_t>(options.block_frames, 16, 8192));
+		const size_t max_partition = std::bit_ceil(std::max<size_t>(options.max_partition, data.block_frames));
+		data.convolvers.resize(data.channels);
+		for (uint16_t c = 0; c < data.channels; ++c)
+			data.convolvers[c].reset(taps[c].data(), taps[c].size(), data.block_frames, max_partition);
+
+		data.idle_after = data.response_frames + data.block_frames;
+		data.silent_frames = data.idle_after;
+		data.target_frames = std::max<size_t>(static_cast<size_t>(data.sample_rate) * std::max(options.latency_ms, 1u) / 1000, data.block_frames);
+		data.ring.allocate((data.target_frames + data.block_frames) * data.channels);
+		data.mix.assign(data.block_frames, 0.0f);
+		data.wet.assign(data.block_frames, 0.0f);
+		data.block.assign(data.block_frames * data.channels, 0.0f);
+		data.block_pcm.assign(data.block_frames * data.channels, 0);
+		data.fill();
+
+		ALuint buffer = 0;
+		alGenBuffers(1, &buffer);
+		alBufferCallbackSOFT(buffer, openal_backend::get_openAL_format(data.channels), static_cast<ALsizei>(data.sample_rate), reverb_callback, m_data);
+
+		auto output = std::make_shared<audio_source>();
+		output->m_buffer_handle = buffer;
+		output->m_loaded = true;
+		alGenSources(1, &output->m_source_handle);
+		alSourcei(output->m_source_handle, AL_BUFFER, static_cast<ALint>(buffer));
+		engine_metrics::get().al_sources.fetch_add(1, std::memory_order_relaxed);
+
+		if (alGetError() != AL_NO_ERROR)
+		{
+			log::error("Failed to set up the reverb output source! (AL_SOFT_callback_buffer missing?)");
+			output->unload();
+			return;
+		}
+
+		output->set_spitial(false);
+		output->set_pitch(1.0f);
+		output->set_gain(options.gain);
+		audio_engine::track_source(output);
+		data.output = std::move(output);
+
+		data.running.store(true, std::memory_order_relaxed);
+		data.worker = std::thread([reverb = m_data]() { reverb->render_loop(); });
+		alSourcePlay(data.output->m_source_handle);
+
+		log::debug("Convolution reverb: {} frames at {} Hz, {} partition levels", data.response_frames, data.sample_rate, data.convolvers[0].level_count());
+	}
+
+	convolution_reverb::~convolution_reverb()
+	{
+		// Stopping the source ends the mixer's pulls before the data goes away.
+		if (m_data->output)
+			m_data->output->unload();
+
+		if (m_data->worker.joinable())
+		{
+			{
+				std::scoped_lock lock(m_data->wake_mutex);
+				m_data->running.store(false, std::memory_order_relaxed);
+			}
+			m_data->wake.notify_one();
+			m_data->worker.join();
+		}
+
+		delete m_data;
+	}
+
+	bool convolution_reverb::is_valid() const
+	{
+		return m_data->output != nullptr;
+	}
+
+	std::shared_ptr<convolution_send> convolution_reverb::create_send(float gain)
+	{
+		auto send = std::make_shared<_convolution_send_data>();
+		send->gain.store(gain, std::memory_order_relaxed);
+		send->sample_rate = m_data->sample_rate;
+		send->ring.allocate(2 * (m_data->target_frames + m_data->block_frames) + 8192);
+
+		{
+			std::scoped_lock lock(m_data->sends_mutex);
+			m_data->sends.push_back(send);
+		}
+
+		return std::make_shared<convolution_send>(std::move(send));
+	}
+
+	std::shared_ptr<audio_source> convolution_reverb::get_output() const
+	{
+		return m_data->output;
+	}
+
+	uint32_t convolution_reverb::get_sample_rate() const
+	{
+		return m_data->sample_rate;
+	}
+
+	uint16_t convolution_reverb::get_channels() const
+	{
+		return m_data->channels;
+	}
+
+	float convolution_reverb::get_length() const
+	{
+		return m_data->sample_rate > 0 ? static_cast<float>(m_data->response_frames) / static_cast<float>(m_data->sample_rate) : 0.0f;
+	}
+
+	dsp_chain_stats convolution_reverb::get_stats() const
+	{
+		dsp_chain_stats stats;
+		stats.blocks = m_data->blocks.load(std::memory_order_relaxed);
+		stats.underruns = m_data->underruns.load(std::memory_order_relaxed);
+		stats.block_time_us = m_data->block_time_us.snapshot();
+
+		const uint64_t audio_ns = m_data->audio_ns.load(std::memory_order_relaxed);
+		if (audio_ns > 0)
+			stats.cpu_load = static_cast<double>(m_data->busy_ns.load(std::memory_order_relaxed)) / static_cast<double>(audio_ns);
+
+		return stats;
+	}
+}
@@ -0,0 +1,529 @@
+#include "audio/dsp_chain.h"
+#include "audio/audio_engine.h"
+
+#include "core/log.h"
+#include "core/ring_buffer.h"
+#include "core/trace.h"
+
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable: 5030)
+#endif // _MSC_VER
+#define AL_ALEXT_PROTOTYPES
+#include <AL/al.h>
+#include <AL/alext.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif // _MSC_VER
+
+#include "internal/openal_backend.h"
+#include "internal/simd.h"
+#include "internal/stream_position.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace myro
+{
+	struct _dsp_chain_data
+	{
+		dsp_chain_options options;
+
+		// Copy on write: the worker runs a snapshot without holding the lock, so a node's callback
+		// may edit its own chain.
+		using node_list = std::vector<std::shared_ptr<dsp_node>>;
+		std::mutex nodes_mutex;
+		std::shared_ptr<const node_list> nodes = std::make_shared<node_list>();
+		uint32_t sample_rate = 0;
+		uint16_t channels = 0;
+
+		atomic_histogram block_time_us;
+		std::atomic<uint64_t> blocks{ 0 };
+		std::atomic<uint64_t> underruns{ 0 };
+		std::atomic<uint64_t> busy_ns{ 0 };
+		std::atomic<uint64_t> audio_ns{ 0 };
+
+		// Attached source. The worker renders into the ring, the OpenAL mixer drains it.
+		std::shared_ptr<audio_source> source;
+		std::shared_ptr<const std::vector<short>> pcm;
+		uint32_t source_handle = 0;
+		uint32_t static_buffer = 0;		// the source's own buffer, put back on detach
+		uint32_t callback_buffer = 0;
+		spsc_ring_buffer<short> ring;
+		size_t target_frames = 0;
+		size_t cursor = 0;				// next frame of pcm to render, worker only
+		std::vector<float> block;
+		std::vector<short> block_pcm;
+
+		// Frames written before the last restart are stale; the callback discards them instead of playing them.
+		stream_position position;
+		std::atomic<bool> finished{ false };
+
+		std::thread worker;
+		std::atomic<bool> running{ false };
+		std::atomic<bool> attached{ false };	// cleared when the worker exits on its own
+		std::mutex wake_mutex;
+		std::condition_variable wake;
+
+		std::shared_ptr<const node_list> snapshot()
+		{
+			std::scoped_lock lock(nodes_mutex);
+			return nodes;
+		}
+
+		// Writers swap in an edited copy; a block already running keeps the list it started with.
+		template <class Edit>
+		void edit_nodes(Edit&& edit)
+		{
+			std::scoped_lock lock(nodes_mutex);
+			auto copy = std::make_shared<node_list>(*nodes);
+			edit(*copy);
+			nodes = std::move(copy);
+		}
+
+		void prepare_nodes(uint32_t rate, uint16_t channel_count)
+		{
+			std::scoped_lock lock(nodes_mutex);
+			sample_rate = rate;
+			channels = channel_count;
+			for (const auto& node : *nodes)
+				node->prepare(sample_rate, channels);
+		}
+
+		void run_nodes(float* samples, size_t frame_count)
+		{
+			MYRO_TRACE_SCOPE("dsp block");
+			const auto start = std::chrono::steady_clock::now();
+			for (const auto& node : *snapshot())
+				node->process(samples, frame_count);
+			const auto elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+
+			block_time_us.record(elapsed / 1000);
+			busy_ns.fetch_add(elapsed, std::memory_order_relaxed);
+			audio_ns.fetch_add(frame_count * 1'000'000'000ull / sample_rate, std::memory_order_relaxed);
+			blocks.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// To a frame of the clip with clean node state, e.g. the start after the source stopped.
+		void rewind(uint64_t frame = 0)
+		{
+			cursor = static_cast<size_t>(std::min<uint64_t>(frame, pcm->size() / channels));
+			for (const auto& node : *snapshot())
+				node->reset();
+			position.mark_stale();
+			finished.store(false, std::memory_order_release);
+		}
+
+		// Renders blocks until target_frames are buffered or the clip has ended.
+		void fill()
+		{
+			const size_t total_frames = pcm->size() / channels;
+			const size_t block_frames = options.block_frames;
+
+			bool short_counted = false;
+			while (!finished.load(std::memory_order_relaxed))
+			{
+				// The mixer outran the worker: nothing is queued, and that is an underrun too.
+				uint64_t shortfall = 0;
+				const uint64_t pending = position.pending(shortfall);
+				if (shortfall > 0 && !short_counted)
+				{
+					underruns.fetch_add(1, std::memory_order_relaxed);
+					short_counted = true;
+				}
+
+				if (pending >= target_frames || ring.write_available() < block_frames * channels)
+					break;
+
+				size_t frames = 0;
+				while (frames < block_frames)
+				{
+					if (cursor == total_frames)
+					{
+						ALint looping = AL_FALSE;
+						alGetSourcei(source_handle, AL_LOOPING, &looping);
+						if (looping != AL_TRUE)
+							break;
+						cursor = 0;
+					}
+
+					const size_t n = std::min(block_frames - frames, total_frames - cursor);
+					simd::short_to_float(pcm->data() + cursor * channels, block.data() + frames * channels, n * channels);
+					cursor += n;
+					frames += n;
+				}
+
+				if (frames > 0)
+				{
+					run_nodes(block.data(), frames);
+					simd::float_to_short(block.data(), block_pcm.data(), frames * channels);
+					ring.write(block_pcm.data(), frames * channels);
+					position.written.store(position.written.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+				}
+
+				if (frames < block_frames)
+					finished.store(true, std::memory_order_release);
+			}
+		}
+
+		void render_loop()
+		{
+			MYRO_TRACE_THREAD_NAME("myro dsp");
+			simd::flush_denormals();
+
+			const auto interval = std::chrono::milliseconds(std::max<uint64_t>(options.block_frames * 500ull / sample_rate, 1));
+
+			std::unique_lock lock(wake_mutex);
+			while (true)
+			{
+				wake.wait_for(lock, interval, [this]() { return !running.load(std::memory_order_relaxed) || position.restarting(); });
+				if (!running.load(std::memory_order_relaxed) || !alIsSource(source_handle))
+					break;
+
+				// Posted by audio_engine's play, stop, rewind and seek; the callback plays silence until
+				// the new position is in the ring.
+				uint64_t frame = 0;
+				uint64_t request = 0;
+				const bool restart = position.restart_pending(frame, request);
+				if (restart)
+					rewind(frame);
+
+				fill();
+
+				if (restart)
+					position.finish_restart(request);
+			}
+
+			attached.store(false, std::memory_order_release);
+		}
+
+		// Any thread. Not waiting on wake_mutex: the worker holds it while it renders, and a missed
+		// notify only costs one poll interval.
+		void post_restart(float seconds)
+		{
+			position.request_restart(static_cast<uint64_t>(static_cast<double>(std::max(seconds, 0.0f)) * sample_rate));
+			wake.notify_one();
+		}
+
+		// OpenAL mixer thread.
+		size_t pull(short* out, size_t wanted)
+		{
+			// A restart is on its way; neither the old frames nor a short return (which stops the source).
+			if (position.restarting())
+			{
+				std::fill(out, out + wanted * channels, short{ 0 });
+				return wanted;
+			}
+
+			// Loaded before the ring size: a finished clip has all of its frames in the ring already.
+			const bool done = finished.load(std::memory_order_acquire);
+			bool caught_up = false;
+			const size_t produced = position.read_frames(ring, out, wanted, channels, caught_up);
+			if (produced == wanted)
+				return wanted;
+
+			// Returning short stops the source, so only do it at the real end of the clip.
+			if (done && caught_up)
+				return produced;
+
+			std::fill(out + produced * channels, out + wanted * channels, short{ 0 });
+			underruns.fetch_add(1, std::memory_order_relaxed);
+			return wanted;
+		}
+
+		void stop_worker()
+		{
+			if (!worker.joinable())
+				return;
+
+			{
+				std::scoped_lock lock(wake_mutex);
+				running.store(false, std::memory_order_relaxed);
+			}
+			wake.notify_one();
+			worker.join();
+		}
+
+		// Stops the worker and gives the source its own buffer back.
+		void teardown()
+		{
+			stop_worker();
+
+			// After an engine shutdown the AL objects are gone already.
+			if (audio_engine::is_active())
+			{
+				if (source->is_loaded() && alIsSource(source_handle))
+				{
+					alSourceStop(source_handle);
+					alSourcei(source_handle, AL_BUFFER, static_cast<ALint>(static_buffer));
+				}
+
+				ALuint buffer = callback_buffer;
+				alDeleteBuffers(1, &buffer);
+			}
+
+			callback_buffer = 0;
+			source.reset();
+			pcm.reset();
+			ring.release();
+			attached.store(false, std::memory_order_release);
+		}
+	};
+
+	namespace
+	{
+		// Attached chains, so unloading a source detaches them before its OpenAL objects go away.
+		struct chain_registry
+		{
+			std::mutex mutex;
+			std::vector<_dsp_chain_data*> chains;
+		};
+
+		chain_registry s_attached;
+
+		ALsizei AL_APIENTRY chain_callback(ALvoid* userptr, ALvoid* sampledata, ALsizei numbytes)
+		{
+			_dsp_chain_data* data = static_cast<_dsp_chain_data*>(userptr);
+			const size_t frame_bytes = sizeof(short) * data->channels;
+			const size_t frames = data->pull(static_cast<short*>(sampledata), static_cast<size_t>(numbytes) / frame_bytes);
+			return static_cast<ALsizei>(frames * frame_bytes);
+		}
+	}
+
+	dsp_chain::dsp_chain(const dsp_chain_options& options) : m_data(new _dsp_chain_data())
+	{
+		m_data->options = options;
+		m_data->options.block_frames = std::clamp(options.block_frames, 16u, 8192u);
+		m_data->options.latency_ms = std::max(options.latency_ms, 1u);
+	}
+
+	dsp_chain::~dsp_chain()
+	{
+		detach();
+		delete m_data;
+	}
+
+	void dsp_chain::add(const std::shared_ptr<dsp_node>& node)
+	{
+		if (!node)
+			return;
+
+		m_data->edit_nodes([&](_dsp_chain_data::node_list& nodes)
+			{
+				if (m_data->channels != 0)
+					node->prepare(m_data->sample_rate, m_data->channels);
+				nodes.push_back(node);
+			});
+	}
+
+	void dsp_chain::remove(const std::shared_ptr<dsp_node>& node)
+	{
+		m_data->edit_nodes([&](_dsp_chain_data::node_list& nodes) { std::erase(nodes, node); });
+	}
+
+	void dsp_chain::clear()
+	{
+		m_data->edit_nodes([](_dsp_chain_data::node_list& nodes) { nodes.clear(); });
+	}
+
+	void dsp_chain::prepare(uint32_t sample_rate, uint16_t channels)
+	{
+		if (is_attached())
+		{
+			log::warn("dsp_chain::prepare called while the chain is attached to a source!");
+			return;
+		}
+
+		m_data->prepare_nodes(std::max(sample_rate, 1u), std::max<uint16_t>(channels, 1));
+	}
+
+	void dsp_chain::process(float* samples, size_t frames)
+	{
+		if (is_attached() || m_data->channels == 0)
+		{
+			log::warn("dsp_chain::process needs a prepared chain that is not attached to a source!");
+			return;
+		}
+
+		if (frames > 0)
+			m_data->run_nodes(samples, frames);
+	}
+
+	bool dsp_chain::bake(std::vector<short>& samples, uint32_t sample_rate, uint16_t channels) const
+	{
+		MYRO_TRACE_SCOPE("dsp bake");
+		if (sample_rate == 0 || channels == 0)
+		{
+			log::warn("dsp_chain::bake needs a sample rate and a channel count!");
+			return false;
+		}
+
+		const std::shared_ptr<dsp_chain> copy = clone();
+		if (!copy)
+		{
+			log::warn("The dsp chain has a node that cannot be cloned, so it cannot be baked.");
+			return false;
+		}
+
+		copy->prepare(sample_rate, channels);
+
+		const size_t block_frames = m_data->options.block_frames;
+		const size_t tail_frames = static_cast<size_t>(sample_rate) * m_data->options.bake_tail_ms / 1000;
+		const size_t frames = samples.size() / channels + tail_frames;
+		samples.resize(frames * channels, 0);
+
+		std::vector<float> block(block_frames * channels);
+		for (size_t first = 0; first < frames; first += block_frames)
+		{
+			const size_t count = std::min(block_frames, frames - first);
+			short* pcm = samples.data() + first * channels;
+			simd::short_to_float(pcm, block.data(), count * channels);
+			copy->m_data->run_nodes(block.data(), count);
+			simd::float_to_short(block.data(), pcm, count * channels);
+		}
+
+		return true;
+	}
+
+	std::shared_ptr<dsp_chain> dsp_chain::clone() const
+	{
+		auto copy = create(m_data->options);
+
+		auto nodes = std::make_shared<_dsp_chain_data::node_list>();
+		for (const auto& node : *m_data->snapshot())
+		{
+			std::shared_ptr<dsp_node> node_copy = node->clone();
+			if (!node_copy)
+				return nullptr;
+			nodes->push_back(std::move(node_copy));
+		}
+
+		copy->m_data->nodes = std::move(nodes);
+		return copy;
+	}
+
+	bool dsp_chain::attach(const std::shared_ptr<audio_source>& source)
+	{
+		detach();
+
+		if (!source || !source->is_loaded())
+		{
+			log::warn("Cannot attach the dsp chain to an unloaded source!");
+			return false;
+		}
+
+		if (!source->m_pcm || source->m_pcm->empty() || source->m_channels == 0)
+		{
+			log::warn("The source has no retained PCM, load it with audio_engine::set_retain_pcm(true) to process it.");
+			return false;
+		}
+
+		if (source->m_channels > 2)
+		{
+			log::warn("The dsp chain supports mono and stereo sources, this one has {} channels.", source->m_channels);
+			return false;
+		}
+
+		_dsp_chain_data& data = *m_data;
+		data.prepare_nodes(source->m_sample_rate, source->m_channels);
+
+		const size_t block_frames = data.options.block_frames;
+		data.target_frames = std::max<size_t>(static_cast<size_t>(data.sample_rate) * data.options.latency_ms / 1000, block_frames);
+		data.ring.allocate((2 * data.target_frames + block_frames) * data.channels);
+		data.block.assign(block_frames * data.channels, 0.0f);
+		data.block_pcm.assign(block_frames * data.channels, 0);
+		data.position.reset();
+		data.source = source;
+		data.pcm = source->m_pcm;
+		data.source_handle = source->m_source_handle;
+		data.static_buffer = source->m_buffer_handle;
+		data.rewind();
+		data.fill();
+
+		const ALuint source_handle = source->m_source_handle;
+		alSourceStop(source_handle);
+		alSourcei(source_handle, AL_BUFFER, 0);
+
+		ALuint buffer = 0;
+		alGenBuffers(1, &buffer);
+		alBufferCallbackSOFT(buffer, openal_backend::get_openAL_format(data.channels), static_cast<ALsizei>(data.sample_rate), chain_callback, m_data);
+		alSourcei(source_handle, AL_BUFFER, static_cast<ALint>(buffer));
+
+		if (alGetError() != AL_NO_ERROR)
+		{
+			log::error("Failed to route the source through the dsp chain! (AL_SOFT_callback_buffer missing?)");
+			alSourcei(source_handle, AL_BUFFER, static_cast<ALint>(source->m_buffer_handle));
+			alDeleteBuffers(1, &buffer);
+			data.source.reset();
+			data.pcm.reset();
+			data.ring.release();
+			return false;
+		}
+
+		data.callback_buffer = buffer;
+		data.running.store(true, std::memory_order_relaxed);
+		data.attached.store(true, std::memory_order_release);
+		data.worker = std::thread([chain = m_data]() { chain->render_loop(); });
+
+		std::scoped_lock lock(s_attached.mutex);
+		s_attached.chains.push_back(m_data);
+		return true;
+	}
+
+	void dsp_chain::detach()
+	{
+		std::scoped_lock lock(s_attached.mutex);
+		if (!m_data->worker.joinable())
+			return;
+
+		std::erase(s_attached.chains, m_data);
+		m_data->teardown();
+	}
+
+	bool dsp_chain::is_attached() const
+	{
+		return m_data->attached.load(std::memory_order_acquire);
+	}
+
+	void dsp_chain::release_source(uint32_t source_handle)
+	{
+		std::scoped_lock lock(s_attached.mutex);
+		std::erase_if(s_attached.chains, [source_handle](_dsp_chain_data* data)
+			{
+				if (data->source_handle != source_handle)
+					return false;
+				data->teardown();
+				return true;
+			});
+	}
+
+	void dsp_chain::restart_source(uint32_t source_handle, float seconds)
+	{
+		std::scoped_lock lock(s_attached.mutex);
+		for (_dsp_chain_data* data : s_attached.chains)
+			if (data->source_handle == source_handle)
+				data->post_restart(seconds);
+	}
+
+	dsp_chain_stats dsp_chain::get_stats() const
+	{
+		dsp_chain_stats stats;
+		stats.blocks = m_data->blocks.load(std::memory_order_relaxed);
+		stats.underruns = m_data->underruns.load(std::memory_order_relaxed);
+		stats.block_time_us = m_data->block_time_us.snapshot();
+
+		const uint64_t audio_ns = m_data->audio_ns.load(std::memory_order_relaxed);
+		if (audio_ns > 0)
+			stats.cpu_load = static_cast<double>(m_data->busy_ns.load(std::memory_order_relaxed)) / static_cast<double>(audio_ns);
+
+		return stats;
+	}
+
+	const dsp_chain_options& dsp_chain::get_options() const
+	{
+		return m_data->options;
+	}
+}
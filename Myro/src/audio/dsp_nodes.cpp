@@ -0,0 +1,220 @@
+#include "audio/dsp_chain.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace myro
+{
+	biquad_node::biquad_node(biquad_type type, float frequency, float q, float gain_db)
+		: m_type(type), m_frequency(frequency), m_q(q), m_gain_db(gain_db)
+	{
+	}
+
+	void biquad_node::set(biquad_type type, float frequency, float q, float gain_db)
+	{
+		m_type.store(type, std::memory_order_relaxed);
+		m_frequency.store(frequency, std::memory_order_relaxed);
+		m_q.store(q, std::memory_order_relaxed);
+		m_gain_db.store(gain_db, std::memory_order_relaxed);
+		m_dirty.store(true, std::memory_order_release);
+	}
+
+	void biquad_node::set_frequency(float frequency)
+	{
+		m_frequency.store(frequency, std::memory_order_relaxed);
+		m_dirty.store(true, std::memory_order_release);
+	}
+
+	void biquad_node::set_gain_db(float gain_db)
+	{
+		m_gain_db.store(gain_db, std::memory_order_relaxed);
+		m_dirty.store(true, std::memory_order_release);
+	}
+
+	void biquad_node::prepare(uint32_t sample_rate, uint16_t channels)
+	{
+		m_sample_rate = std::max(sample_rate, 1u);
+		m_channels = channels;
+		m_z1.assign(channels, 0.0f);
+		m_z2.assign(channels, 0.0f);
+		m_dirty.store(true, std::memory_order_release);
+	}
+
+	void biquad_node::process(float* samples, size_t frames)
+	{
+		if (m_channels == 0)
+			return;
+
+		if (m_dirty.exchange(false, std::memory_order_acquire))
+			update_coefficients();
+
+		// Transposed direct form II. The recursion runs along time, so there is nothing to vectorize
+		// for one or two channels; one channel at a time keeps the state in registers.
+		const float b0 = m_coefficients[0], b1 = m_coefficients[1], b2 = m_coefficients[2];
+		const float a1 = m_coefficients[3], a2 = m_coefficients[4];
+		for (uint16_t c = 0; c < m_channels; ++c)
+		{
+			float s1 = m_z1[c];
+			float s2 = m_z2[c];
+			float* sample = samples + c;
+			for (size_t f = 0; f < frames; ++f, sample += m_channels)
+			{
+				const float x = *sample;
+				const float y = b0 * x + s1;
+				s1 = b1 * x - a1 * y + s2;
+				s2 = b2 * x - a2 * y;
+				*sample = y;
+			}
+			m_z1[c] = s1;
+			m_z2[c] = s2;
+		}
+	}
+
+	void biquad_node::reset()
+	{
+		std::ranges::fill(m_z1, 0.0f);
+		std::ranges::fill(m_z2, 0.0f);
+	}
+
+	std::shared_ptr<dsp_node> biquad_node::clone() const
+	{
+		return create(m_type.load(std::memory_order_relaxed), m_frequency.load(std::memory_order_relaxed),
+			m_q.load(std::memory_order_relaxed), m_gain_db.load(std::memory_order_relaxed));
+	}
+
+	void biquad_node::update_coefficients()
+	{
+		const double nyquist = m_sample_rate * 0.5;
+		const double frequency = std::clamp<double>(m_frequency.load(std::memory_order_relaxed), 1.0, nyquist * 0.99);
+		const double q = std::max<double>(m_q.load(std::memory_order_relaxed), 0.01);
+		const double a = std::pow(10.0, m_gain_db.load(std::memory_order_relaxed) / 40.0);
+
+		const double w0 = 2.0 * std::numbers::pi * frequency / m_sample_rate;
+		const double cos_w0 = std::cos(w0);
+		const double alpha = std::sin(w0) / (2.0 * q);
+		const double shelf = 2.0 * std::sqrt(a) * alpha;
+
+		double b0 = 1.0, b1 = 0.0, b2 = 0.0, a0 = 1.0, a1 = 0.0, a2 = 0.0;
+		switch (m_type.load(std::memory_order_relaxed))
+		{
+		case biquad_type::low_pass:
+			b0 = (1.0 - cos_w0) / 2.0;	b1 = 1.0 - cos_w0;			b2 = b0;
+			a0 = 1.0 + alpha;			a1 = -2.0 * cos_w0;			a2 = 1.0 - alpha;
+			break;
+		case biquad_type::high_pass:
+			b0 = (1.0 + cos_w0) / 2.0;	b1 = -(1.0 + cos_w0);		b2 = b0;
+			a0 = 1.0 + alpha;			a1 = -2.0 * cos_w0;			a2 = 1.0 - alpha;
+			break;
+		case biquad_type::band_pass:
+			b0 = alpha;					b1 = 0.0;					b2 = -alpha;
+			a0 = 1.0 + alpha;			a1 = -2.0 * cos_w0;			a2 = 1.0 - alpha;
+			break;
+		case biquad_type::notch:
+			b0 = 1.0;					b1 = -2.0 * cos_w0;			b2 = 1.0;
+			a0 = 1.0 + alpha;			a1 = -2.0 * cos_w0;			a2 = 1.0 - alpha;
+			break;
+		case biquad_type::peaking:
+			b0 = 1.0 + alpha * a;		b1 = -2.0 * cos_w0;			b2 = 1.0 - alpha * a;
+			a0 = 1.0 + alpha / a;		a1 = -2.0 * cos_w0;			a2 = 1.0 - alpha / a;
+			break;
+		case biquad_type::low_shelf:
+			b0 = a * ((a + 1.0) - (a - 1.0) * cos_w0 + shelf);
+			b1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cos_w0);
+			b2 = a * ((a + 1.0) - (a - 1.0) * cos_w0 - shelf);
+			a0 = (a + 1.0) + (a - 1.0) * cos_w0 + shelf;
+			a1 = -2.0 * ((a - 1.0) + (a + 1.0) * cos_w0);
+			a2 = (a + 1.0) + (a - 1.0) * cos_w0 - shelf;
+			break;
+		case biquad_type::high_shelf:
+			b0 = a * ((a + 1.0) + (a - 1.0) * cos_w0 + shelf);
+			b1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cos_w0);
+			b2 = a * ((a + 1.0) + (a - 1.0) * cos_w0 - shelf);
+			a0 = (a + 1.0) - (a - 1.0) * cos_w0 + shelf;
+			a1 = 2.0 * ((a - 1.0) - (a + 1.0) * cos_w0);
+			a2 = (a + 1.0) - (a - 1.0) * cos_w0 - shelf;
+			break;
+		}
+
+		m_coefficients[0] = static_cast<float>(b0 / a0);
+		m_coefficients[1] = static_cast<float>(b1 / a0);
+		m_coefficients[2] = static_cast<float>(b2 / a0);
+		m_coefficients[3] = static_cast<float>(a1 / a0);
+		m_coefficients[4] = static_cast<float>(a2 / a0);
+	}
+
+	compressor_node::compressor_node(float threshold_db, float ratio, float attack_ms, float release_ms, float makeup_db)
+		: m_threshold_db(threshold_db), m_ratio(ratio), m_attack_ms(attack_ms), m_release_ms(release_ms), m_makeup_db(makeup_db)
+	{
+	}
+
+	void compressor_node::set(float threshold_db, float ratio, float attack_ms, float release_ms, float makeup_db)
+	{
+		m_threshold_db.store(threshold_db, std::memory_order_relaxed);
+		m_ratio.store(ratio, std::memory_order_relaxed);
+		m_attack_ms.store(attack_ms, std::memory_order_relaxed);
+		m_release_ms.store(release_ms, std::memory_order_relaxed);
+		m_makeup_db.store(makeup_db, std::memory_order_relaxed);
+	}
+
+	void compressor_node::prepare(uint32_t sample_rate, uint16_t channels)
+	{
+		m_sample_rate = std::max(sample_rate, 1u);
+		m_channels = channels;
+		reset();
+	}
+
+	void compressor_node::process(float* samples, size_t frames)
+	{
+		if (m_channels == 0)
+			return;
+
+		const float threshold_db = m_threshold_db.load(std::memory_order_relaxed);
+		const float ratio = m_ratio.load(std::memory_order_relaxed);
+		const float slope = ratio > 0.0f ? 1.0f - 1.0f / std::max(ratio, 1.0f) : 1.0f;
+		const float makeup_db = m_makeup_db.load(std::memory_order_relaxed);
+		const float threshold = std::pow(10.0f, threshold_db / 20.0f);
+
+		// One-pole smoothing of the gain reduction; a time of 0 follows instantly.
+		auto smoothing = [this](float ms) { return ms > 0.0f ? std::exp(-1000.0f / (ms * static_cast<float>(m_sample_rate))) : 0.0f; };
+		const float attack = smoothing(m_attack_ms.load(std::memory_order_relaxed));
+		const float release = smoothing(m_release_ms.load(std::memory_order_relaxed));
+
+		float envelope = m_envelope_db;
+		for (size_t f = 0; f < frames; ++f)
+		{
+			float* frame = samples + f * m_channels;
+			float peak = 0.0f;
+			for (uint16_t c = 0; c < m_channels; ++c)
+				peak = std::max(peak, std::fabs(frame[c]));
+
+			const float target = peak > threshold ? (20.0f * std::log10(peak) - threshold_db) * slope : 0.0f;
+			const float coefficient = target > envelope ? attack : release;
+			envelope = target + (envelope - target) * coefficient;
+
+			const float gain_db = makeup_db - envelope;
+			if (gain_db != 0.0f)
+			{
+				const float gain = std::pow(10.0f, gain_db / 20.0f);
+				for (uint16_t c = 0; c < m_channels; ++c)
+					frame[c] *= gain;
+			}
+		}
+
+		// Keep denormals out of the state once the input falls silent.
+		m_envelope_db = envelope < 1e-6f ? 0.0f : envelope;
+		m_reduction_db.store(m_envelope_db, std::memory_order_relaxed);
+	}
+
+	void compressor_node::reset()
+	{
+		m_envelope_db = 0.0f;
+		m_reduction_db.store(0.0f, std::memory_order_relaxed);
+	}
+
+	std::shared_ptr<dsp_node> compressor_node::clone() const
+	{
+		return create(m_threshold_db.load(std::memory_order_relaxed), m_ratio.load(std::memory_order_relaxed), m_attack_ms.load(std::memory_order_relaxed),
+			m_release_ms.load(std::memory_order_relaxed), m_makeup_db.load(std::memory_order_relaxed));
+	}
+}
@@ -2,12 +2,17 @@
 #include "core/log.h"
 
 #include <FLAC/stream_encoder.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
 #include <vector>
 
 namespace myro
 {
     struct _flac_encoder_data
     {
+        flac_encoder_options options;
+        std::shared_ptr<IOutputSink> sink;
         std::vector<FLAC__int32> interleaved_buffer;
         FLAC__StreamEncoder* flac_encoder = nullptr;
         uint32_t sample_rate = 0;
@@ -16,8 +21,34 @@ namespace myro
         bool is_initialized = false;
     };
 
-    flac_encoder::flac_encoder() : m_data(new _flac_encoder_data())
+    namespace
     {
+        FLAC__StreamEncoderWriteStatus write_callback(const FLAC__StreamEncoder* encoder, const FLAC__byte buffer[], size_t bytes, uint32_t samples, uint32_t current_frame, void* client_data)
+        {
+            MYRO_UNUSED(encoder); MYRO_UNUSED(samples); MYRO_UNUSED(current_frame);
+            auto* data = static_cast<_flac_encoder_data*>(client_data);
+            return data->sink->write(buffer, bytes) ? FLAC__STREAM_ENCODER_WRITE_STATUS_OK : FLAC__STREAM_ENCODER_WRITE_STATUS_FATAL_ERROR;
+        }
+
+        FLAC__StreamEncoderSeekStatus seek_callback(const FLAC__StreamEncoder* encoder, FLAC__uint64 absolute_byte_offset, void* client_data)
+        {
+            MYRO_UNUSED(encoder);
+            auto* data = static_cast<_flac_encoder_data*>(client_data);
+            return data->sink->seek(absolute_byte_offset) ? FLAC__STREAM_ENCODER_SEEK_STATUS_OK : FLAC__STREAM_ENCODER_SEEK_STATUS_ERROR;
+        }
+
+        FLAC__StreamEncoderTellStatus tell_callback(const FLAC__StreamEncoder* encoder, FLAC__uint64* absolute_byte_offset, void* client_data)
+        {
+            MYRO_UNUSED(encoder);
+            auto* data = static_cast<_flac_encoder_data*>(client_data);
+            *absolute_byte_offset = data->sink->tell();
+            return FLAC__STREAM_ENCODER_TELL_STATUS_OK;
+        }
+    }
+
+    flac_encoder::flac_encoder(const flac_encoder_options& options) : m_data(new _flac_encoder_data())
+    {
+        set_options(options);
     }
 
     flac_encoder::~flac_encoder()
@@ -33,7 +64,7 @@ namespace myro
         }
     }
 
-    bool flac_encoder::init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels)
+    bool flac_encoder::init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels)
     {
         if (m_data->is_initialized)
         {
@@ -41,25 +72,52 @@ namespace myro
             return false;
         }
 
+        if (!sink)
+            return false;
+
         m_data->flac_encoder = FLAC__stream_encoder_new();
         if (!m_data->flac_encoder)
             return false;
 
-        FLAC__stream_encoder_set_verify(m_data->flac_encoder, true);
-        FLAC__stream_encoder_set_compression_level(m_data->flac_encoder, 5);
+        const flac_encoder_options& options = m_data->options;
+
+        FLAC__stream_encoder_set_verify(m_data->flac_encoder, options.verify);
+        // The shared encoder_options complexity, when set, overrides the FLAC specific level.
+        const uint32_t level = m_options.complexity >= 0 ? static_cast<uint32_t>(std::min(m_options.complexity, 10)) * 8 / 10 : options.compression_level;
+        FLAC__stream_encoder_set_compression_level(m_data->flac_encoder, level);
         FLAC__stream_encoder_set_channels(m_data->flac_encoder, channels);
-        FLAC__stream_encoder_set_bits_per_sample(m_data->flac_encoder, 16);
+        FLAC__stream_encoder_set_bits_per_sample(m_data->flac_encoder, options.bits_per_sample);
         FLAC__stream_encoder_set_sample_rate(m_data->flac_encoder, sample_rate);
 
+        // Must come after the compression level, which resets the blocksize.
+        if (options.blocksize != 0)
+            FLAC__stream_encoder_set_blocksize(m_data->flac_encoder, options.blocksize);
+
+#if FLAC_API_VERSION_CURRENT >= 14
+        uint32_t threads = options.thread_count != 0 ? options.thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+        if (threads > 1 && FLAC__stream_encoder_set_num_threads(m_data->flac_encoder, threads) != FLAC__STREAM_ENCODER_SET_NUM_THREADS_OK)
+            log::warn("libFLAC rejected {} encoder threads, encoding on a single thread.", threads);
+#else
+        if (options.thread_count > 1)
+            log::warn("libFLAC was built without multithreaded encoding (needs 1.5+), encoding on a single thread.");
+#endif
+
         m_data->channels = static_cast<uint16_t>(channels);
         m_data->sample_rate = sample_rate;
+        m_data->bits_per_sample = options.bits_per_sample;
+
+        m_data->sink = sink;
 
-        auto status = FLAC__stream_encoder_init_file(m_data->flac_encoder, output_filepath.string().c_str(), nullptr, nullptr);
+        // Without seek/tell the STREAMINFO block (total samples, MD5) is left as written up front.
+        const bool seekable = sink->can_seek();
+        auto status = FLAC__stream_encoder_init_stream(m_data->flac_encoder, write_callback,
+            seekable ? seek_callback : nullptr, seekable ? tell_callback : nullptr, nullptr, m_data);
 
         if (status != FLAC__STREAM_ENCODER_INIT_STATUS_OK)
         {
             FLAC__stream_encoder_delete(m_data->flac_encoder);
             m_data->flac_encoder = nullptr;
+            m_data->sink = nullptr;
             return false;
         }
 
@@ -83,12 +141,55 @@ namespace myro
             return;
 
         m_data->interleaved_buffer.resize(frame_count * m_data->channels);
+
+        const int shift = m_data->bits_per_sample - 16;
         for (size_t i = 0; i < m_data->interleaved_buffer.size(); ++i)
-            m_data->interleaved_buffer[i] = pcm_frames[i];
+            m_data->interleaved_buffer[i] = static_cast<FLAC__int32>(pcm_frames[i]) * (1 << shift);
 
         FLAC__stream_encoder_process_interleaved(m_data->flac_encoder, m_data->interleaved_buffer.data(), static_cast<uint32_t>(frame_count));
     }
 
+    void flac_encoder::write(const float* pcm_frames, size_t frame_count)
+    {
+        if (!m_data->is_initialized)
+            return;
+
+        m_data->interleaved_buffer.resize(frame_count * m_data->channels);
+
+        const float scale = static_cast<float>(1 << (m_data->bits_per_sample - 1));
+        const float max_value = scale - 1.0f;
+        for (size_t i = 0; i < m_data->interleaved_buffer.size(); ++i)
+            m_data->interleaved_buffer[i] = static_cast<FLAC__int32>(std::lrint(std::clamp(pcm_frames[i] * scale, -scale, max_value)));
+
+        FLAC__stream_encoder_process_interleaved(m_data->flac_encoder, m_data->interleaved_buffer.data(), static_cast<uint32_t>(frame_count));
+    }
+
+    void flac_encoder::write(const int32_t* const* channels, size_t frame_count)
+    {
+        if (!m_data->is_initialized)
+            return;
+
+        // Already libFLAC's native layout: planar, right aligned at bits_per_sample. No copy.
+        FLAC__stream_encoder_process(m_data->flac_encoder, reinterpret_cast<const FLAC__int32* const*>(channels), static_cast<uint32_t>(frame_count));
+    }
+
+    void flac_encoder::set_options(const flac_encoder_options& options)
+    {
+        m_data->options = options;
+        m_data->options.compression_level = std::min(options.compression_level, 8u);
+
+        if (options.bits_per_sample != 16 && options.bits_per_sample != 24)
+        {
+            log::warn("flac_encoder supports 16 or 24 bits per sample. Got: {}, using 16.", options.bits_per_sample);
+            m_data->options.bits_per_sample = 16;
+        }
+    }
+
+    const flac_encoder_options& flac_encoder::get_options() const
+    {
+        return m_data->options;
+    }
+
     void flac_encoder::deinit_impl()
     {
         if (!m_data->is_initialized)
@@ -96,6 +197,10 @@ namespace myro
 
         FLAC__stream_encoder_finish(m_data->flac_encoder);
         FLAC__stream_encoder_delete(m_data->flac_encoder);
+
+        m_data->sink->flush();
+        m_data->sink->close();
+        m_data->sink = nullptr;
         
         m_data->flac_encoder = nullptr;
         m_data->is_initialized = false;
@@ -0,0 +1,90 @@
+#include "audio/encoders/iencoder.h"
+#include "audio/encoders/wav_encoder.h"
+#include "audio/encoders/flac_encoder.h"
+#include "audio/encoders/opus_encoder.h"
+#include "audio/encoders/speex_encoder.h"
+#include "audio/encoders/vorbis_encoder.h"
+#include "audio/encoders/mp3_encoder.h"
+#include "core/log.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace myro
+{
+    namespace
+    {
+        short float_to_short(float sample)
+        {
+            return static_cast<short>(std::lrint(std::clamp(sample, -1.0f, 1.0f) * 32767.0f));
+        }
+    }
+
+    void IEncoder::write(const float* pcm_frames, size_t frame_count)
+    {
+        const size_t count = frame_count * get_channels();
+        m_short_scratch.resize(count);
+
+        for (size_t i = 0; i < count; ++i)
+            m_short_scratch[i] = float_to_short(pcm_frames[i]);
+
+        write(m_short_scratch.data(), frame_count);
+    }
+
+    void IEncoder::write(const float* const* channels, size_t frame_count)
+    {
+        const size_t channel_count = get_channels();
+        m_float_scratch.resize(frame_count * channel_count);
+
+        for (size_t c = 0; c < channel_count; ++c)
+            for (size_t i = 0; i < frame_count; ++i)
+                m_float_scratch[i * channel_count + c] = channels[c][i];
+
+        write(static_cast<const float*>(m_float_scratch.data()), frame_count);
+    }
+
+    void IEncoder::write(const int32_t* const* channels, size_t frame_count)
+    {
+        const size_t channel_count = get_channels();
+        const int shift = std::max(get_bits_per_sample() - 16, 0);
+        m_short_scratch.resize(frame_count * channel_count);
+
+        for (size_t c = 0; c < channel_count; ++c)
+            for (size_t i = 0; i < frame_count; ++i)
+                m_short_scratch[i * channel_count + c] = static_cast<short>(std::clamp(channels[c][i] >> shift, -32768, 32767));
+
+        write(m_short_scratch.data(), frame_count);
+    }
+
+    void IEncoder::write_gap(size_t frame_count)
+    {
+        constexpr size_t chunk_frames = 4096;
+        const size_t channel_count = get_channels();
+        m_short_scratch.assign(std::min(frame_count, chunk_frames) * channel_count, 0);
+
+        while (frame_count > 0)
+        {
+            const size_t frames = std::min(frame_count, chunk_frames);
+            write(static_cast<const short*>(m_short_scratch.data()), frames);
+            frame_count -= frames;
+        }
+    }
+
+    std::shared_ptr<IEncoder> create_encoder(audio_file_format format)
+    {
+        switch (format)
+        {
+        case audio_file_format::wav:  return wav_encoder::create();
+        case audio_file_format::flac: return flac_encoder::create();
+        case audio_file_format::ogg:  return vorbis_encoder::create();
+        case audio_file_format::mp3:  return mp3_encoder::create();
+        case audio_file_format::opus: return opus_encoder::create();
+        case audio_file_format::spx:  return speex_encoder::create();
+        case audio_file_format::unknown:
+            break;
+        }
+
+        log::warn("Unsupported or unknown format!");
+        return nullptr;
+    }
+}
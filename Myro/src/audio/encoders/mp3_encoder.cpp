@@ -1,15 +1,15 @@
 ﻿#include "audio/encoders/mp3_encoder.h"
 #include "core/log.h"
 
+#include <algorithm>
 #include <vector>
-#include <fstream>
 #include <lame.h>
 
 namespace myro
 {
     struct _mp3_encoder_data
     {
-        std::ofstream file;
+        std::shared_ptr<IOutputSink> sink;
         
         bool initialized = false;
         uint32_t sample_rate = 0;
@@ -33,7 +33,7 @@ namespace myro
         }
     }
 
-    bool mp3_encoder::init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels)
+    bool mp3_encoder::init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels)
     {
         if (m_data->initialized)
         {
@@ -41,6 +41,9 @@ namespace myro
             return false;
         }
 
+        if (!sink)
+            return false;
+
         m_data->sample_rate = sample_rate;
         m_data->channels = static_cast<uint16_t>(channels);
 
@@ -54,7 +57,29 @@ namespace myro
         lame_set_in_samplerate(m_data->lame_client, static_cast<int>(m_data->sample_rate));
         lame_set_num_channels(m_data->lame_client, m_data->channels);
         
-        lame_set_VBR(m_data->lame_client, vbr_default);
+        const int kbps = m_options.bitrate != 0 ? static_cast<int>(m_options.bitrate / 1000) : 128;
+        switch (m_options.mode)
+        {
+        case bitrate_mode::cbr:
+            lame_set_VBR(m_data->lame_client, vbr_off);
+            lame_set_brate(m_data->lame_client, kbps);
+            break;
+        case bitrate_mode::abr:
+            lame_set_VBR(m_data->lame_client, vbr_abr);
+            lame_set_VBR_mean_bitrate_kbps(m_data->lame_client, kbps);
+            break;
+        case bitrate_mode::vbr:
+        case bitrate_mode::codec_default:
+            lame_set_VBR(m_data->lame_client, vbr_default);
+            // LAME's VBR scale runs the other way: 0 is best, 9 is smallest.
+            if (m_options.quality >= 0.0f)
+                lame_set_VBR_quality(m_data->lame_client, 9.0f * (1.0f - std::min(m_options.quality, 1.0f)));
+            break;
+        }
+
+        // Algorithm quality, also 0 = slowest/best .. 9 = fastest.
+        if (m_options.complexity >= 0)
+            lame_set_quality(m_data->lame_client, 9 - std::min(m_options.complexity, 10) * 9 / 10);
         
         if (lame_init_params(m_data->lame_client) < 0)
         {
@@ -63,13 +88,7 @@ namespace myro
             return false;
         }
 
-        m_data->file.open(output_filepath, std::ios::binary);
-        if (!m_data->file.is_open())
-        {
-            log::error("File could not be created for mp3 encoder: {}", output_filepath.string());
-            lame_close(m_data->lame_client);
-            return false;
-        }
+        m_data->sink = sink;
 
         m_data->initialized = true;
         return true;
@@ -115,9 +134,51 @@ namespace myro
             );
         }
 
+        write_encoded(bytes_written);
+    }
+
+    void mp3_encoder::write(const float* pcm_frames, size_t frame_count)
+    {
+        if (!m_data->initialized || frame_count == 0) return;
+
+        size_t required_buffer_size = static_cast<size_t>(1.25 * static_cast<size_t>(frame_count) * m_data->channels + 7200);
+        if (m_data->mp3_buffer.size() < required_buffer_size)
+            m_data->mp3_buffer.resize(required_buffer_size);
+
+        int bytes_written;
+        if (m_data->channels == 2)
+        {
+            bytes_written = lame_encode_buffer_interleaved_ieee_float(m_data->lame_client, pcm_frames, static_cast<int>(frame_count),
+                m_data->mp3_buffer.data(), static_cast<int>(m_data->mp3_buffer.size()));
+        }
+        else // Mono: interleaved and planar are the same layout
+        {
+            bytes_written = lame_encode_buffer_ieee_float(m_data->lame_client, pcm_frames, nullptr, static_cast<int>(frame_count),
+                m_data->mp3_buffer.data(), static_cast<int>(m_data->mp3_buffer.size()));
+        }
+
+        write_encoded(bytes_written);
+    }
+
+    void mp3_encoder::write(const float* const* channels, size_t frame_count)
+    {
+        if (!m_data->initialized || frame_count == 0) return;
+
+        size_t required_buffer_size = static_cast<size_t>(1.25 * static_cast<size_t>(frame_count) * m_data->channels + 7200);
+        if (m_data->mp3_buffer.size() < required_buffer_size)
+            m_data->mp3_buffer.resize(required_buffer_size);
+
+        int bytes_written = lame_encode_buffer_ieee_float(m_data->lame_client, channels[0], m_data->channels == 2 ? channels[1] : nullptr,
+            static_cast<int>(frame_count), m_data->mp3_buffer.data(), static_cast<int>(m_data->mp3_buffer.size()));
+
+        write_encoded(bytes_written);
+    }
+
+    void mp3_encoder::write_encoded(int bytes_written)
+    {
         if (bytes_written > 0)
         {
-            m_data->file.write(reinterpret_cast<char*>(m_data->mp3_buffer.data()), bytes_written);
+            m_data->sink->write(m_data->mp3_buffer.data(), static_cast<size_t>(bytes_written));
         }
         else if (bytes_written < 0)
         {
@@ -137,13 +198,14 @@ namespace myro
 
         if (bytes_written > 0)
         {
-            m_data->file.write(reinterpret_cast<char*>(m_data->mp3_buffer.data()), bytes_written);
+            m_data->sink->write(m_data->mp3_buffer.data(), static_cast<size_t>(bytes_written));
         }
 
         lame_close(m_data->lame_client);
 
-        if (m_data->file.is_open())
-            m_data->file.close();
+        m_data->sink->flush();
+        m_data->sink->close();
+        m_data->sink = nullptr;
 
         m_data->initialized = false;
     }
@@ -1,12 +1,15 @@
 ﻿#include "audio/encoders/opus_encoder.h"
 #include "core/log.h"
 
+#include "internal/packetizer.h"
+
+#include <algorithm>
 #include <vector>
 #include <cstring>
-#include <fstream>
 #include <random>
 
 #include <opus.h>
+#include <opus_multistream.h>
 #include <ogg/ogg.h>
 
 namespace myro
@@ -23,18 +26,38 @@ namespace myro
             ptr[0] = val & 0xFF; ptr[1] = (val >> 8) & 0xFF;
             ptr[2] = (val >> 16) & 0xFF; ptr[3] = (val >> 24) & 0xFF;
         }
-        
+
+        constexpr unsigned int max_channels = 8;
+        constexpr size_t max_packet_bytes_per_stream = 4000;
+
+        // Mapping family 1 expects Vorbis channel order; capture devices and WAV deliver WAVE order.
+        // vorbis_order[channels][i] is the WAVE channel feeding Vorbis position i.
+        constexpr uint8_t vorbis_order[max_channels + 1][max_channels] = {
+            {}, {}, {},
+            { 0, 2, 1 },                    // L R C          -> L C R
+            { 0, 1, 2, 3 },                 // quad
+            { 0, 2, 1, 3, 4 },              // 5.0
+            { 0, 2, 1, 4, 5, 3 },           // 5.1: L R C LFE SL SR -> L C R SL SR LFE
+            { 0, 2, 1, 5, 6, 4, 3 },        // 6.1
+            { 0, 2, 1, 6, 7, 4, 5, 3 },     // 7.1: L R C LFE BL BR SL SR -> L C R SL SR BL BR LFE
+        };
     }
 
     struct _opus_encoder_data
     {
-        std::ofstream file;
+        std::shared_ptr<IOutputSink> sink;
         
         bool initialized = false;
+        bool raw_packets = false;
         uint32_t sample_rate = 0;
         uint16_t channels = 0;
         
+        // Exactly one of these is used: the plain encoder for mono/stereo, multistream for surround.
         OpusEncoder* encoder = nullptr;
+        OpusMSEncoder* ms_encoder = nullptr;
+        int streams = 1;
+        int coupled_streams = 0;
+        unsigned char mapping[max_channels]{};
         
         ogg_stream_state os;
         ogg_page         og;
@@ -43,10 +66,29 @@ namespace myro
         int64_t granule_pos = 0;
         int64_t packet_count = 0;
 
-        std::vector<short> pcm_buffer;
+        // libopus converts int16 input to float internally, so the stream is packetized as float
+        // and both write paths end in opus_encode_float.
+        packetizer<float> pcm_packetizer;
+        std::vector<float> conversion_buffer;
+        std::vector<float> reorder_buffer;
+        std::vector<unsigned char> packet_buffer;
         int frames_per_packet = 0; 
+
+        // TOC byte of the last encoded packet, reused for TOC-only DTX packets. -1 until the first packet.
+        int last_toc = -1;
     };
 
+    namespace
+    {
+        template <class... Args>
+        int encoder_ctl(_opus_encoder_data* data, int request, Args... args)
+        {
+            if (data->ms_encoder)
+                return opus_multistream_encoder_ctl(data->ms_encoder, request, args...);
+            return opus_encoder_ctl(data->encoder, request, args...);
+        }
+    }
+
     opus_encoder::opus_encoder() : m_data(new _opus_encoder_data{})
     {
     }
@@ -64,7 +106,7 @@ namespace myro
         }
     }
 
-    bool opus_encoder::init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels)
+    bool opus_encoder::init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels)
     {
         if (m_data->initialized)
         {
@@ -78,40 +120,82 @@ namespace myro
             return false;
         }
 
+        if (channels == 0 || channels > max_channels)
+        {
+            log::error("Opus encoder supports 1 to {} channels. Got: {}", max_channels, channels);
+            return false;
+        }
+
+        if (!sink)
+            return false;
+
         m_data->sample_rate = sample_rate;
         m_data->channels = static_cast<uint16_t>(channels);
+        m_data->raw_packets = m_output_mode == encoder_output_mode::raw_packets;
+        m_data->granule_pos = 0;
+        m_data->packet_count = 0;
+        m_data->last_toc = -1;
 
         int err = OPUS_OK;
-        m_data->encoder = opus_encoder_create(static_cast<opus_int32>(m_data->sample_rate), m_data->channels, OPUS_APPLICATION_AUDIO, &err);
+        if (m_data->channels <= 2)
+        {
+            m_data->streams = 1;
+            m_data->coupled_streams = m_data->channels - 1;
+            m_data->encoder = opus_encoder_create(static_cast<opus_int32>(m_data->sample_rate), m_data->channels, OPUS_APPLICATION_AUDIO, &err);
+        }
+        else
+        {
+            m_data->ms_encoder = opus_multistream_surround_encoder_create(static_cast<opus_int32>(m_data->sample_rate), m_data->channels, 1,
+                &m_data->streams, &m_data->coupled_streams, m_data->mapping, OPUS_APPLICATION_AUDIO, &err);
+        }
+
         if (err != OPUS_OK)
         {
             log::error("Opus encoder could not be created. Error code: {}", err);
+            m_data->encoder = nullptr;
+            m_data->ms_encoder = nullptr;
             return false;
         }
 
-        m_data->frames_per_packet = static_cast<int>(m_data->sample_rate) / 50;
+        configure_encoder();
+
+        m_data->pcm_packetizer.reset(static_cast<size_t>(m_data->frames_per_packet) * m_data->channels);
+        m_data->reorder_buffer.resize(m_data->channels > 2 ? m_data->pcm_packetizer.packet_size() : 0);
+        m_data->packet_buffer.resize(max_packet_bytes_per_stream * static_cast<size_t>(m_data->streams));
+
+        m_data->sink = sink;
 
-        m_data->file.open(output_filepath, std::ios::binary);
-        if (!m_data->file.is_open())
+        // Raw packet consumers get the stream parameters out of band, so there are no header packets.
+        if (m_data->raw_packets)
         {
-            log::error("File could not be created for opus encoder: {}", output_filepath.string());
-            opus_encoder_destroy(m_data->encoder);
-            return false;
+            m_data->initialized = true;
+            return true;
         }
 
         ogg_stream_init(&m_data->os, static_cast<int>(std::random_device{}()));
 
-        unsigned char header_data[19];
+        opus_int32 lookahead = 0;
+        encoder_ctl(m_data, OPUS_GET_LOOKAHEAD(&lookahead));
+
+        const bool surround = m_data->ms_encoder != nullptr;
+        unsigned char header_data[19 + 2 + max_channels];
         std::memcpy(header_data, "OpusHead", 8);
         header_data[8] = 1; // version
         header_data[9] = static_cast<unsigned char>(m_data->channels);
-        write_le16(header_data + 10, 384); // Pre-skip
+        write_le16(header_data + 10, static_cast<uint16_t>(lookahead * 48000 / static_cast<opus_int32>(m_data->sample_rate))); // Pre-skip
         write_le32(header_data + 12, m_data->sample_rate); // Original Sample Rate
         write_le16(header_data + 16, 0); // Gain
-        header_data[18] = 0; // Channel mapping family
+        header_data[18] = surround ? 1 : 0; // Channel mapping family
+
+        if (surround)
+        {
+            header_data[19] = static_cast<unsigned char>(m_data->streams);
+            header_data[20] = static_cast<unsigned char>(m_data->coupled_streams);
+            std::memcpy(header_data + 21, m_data->mapping, m_data->channels);
+        }
 
         m_data->op.packet = header_data;
-        m_data->op.bytes = 19;
+        m_data->op.bytes = surround ? 21 + m_data->channels : 19;
         m_data->op.b_o_s = 1;
         m_data->op.e_o_s = 0;
         m_data->op.granulepos = 0;
@@ -139,6 +223,52 @@ namespace myro
         return true;
     }
 
+    void opus_encoder::configure_encoder()
+    {
+        const encoder_options& options = m_options;
+        _opus_encoder_data* encoder = m_data;
+
+        if (options.bitrate != 0)
+            encoder_ctl(encoder, OPUS_SET_BITRATE(static_cast<opus_int32>(options.bitrate)));
+
+        switch (options.mode)
+        {
+        case bitrate_mode::cbr:
+            encoder_ctl(encoder, OPUS_SET_VBR(0));
+            break;
+        case bitrate_mode::abr:
+            encoder_ctl(encoder, OPUS_SET_VBR(1));
+            encoder_ctl(encoder, OPUS_SET_VBR_CONSTRAINT(1));
+            break;
+        case bitrate_mode::vbr:
+            encoder_ctl(encoder, OPUS_SET_VBR(1));
+            encoder_ctl(encoder, OPUS_SET_VBR_CONSTRAINT(0));
+            break;
+        case bitrate_mode::codec_default:
+            break;
+        }
+
+        if (options.complexity >= 0)
+            encoder_ctl(encoder, OPUS_SET_COMPLEXITY(std::min(options.complexity, 10)));
+
+        encoder_ctl(encoder, OPUS_SET_DTX(options.dtx ? 1 : 0));
+        encoder_ctl(encoder, OPUS_SET_INBAND_FEC(options.fec ? 1 : 0));
+        if (options.fec)
+            encoder_ctl(encoder, OPUS_SET_PACKET_LOSS_PERC(static_cast<opus_int32>(std::min(options.packet_loss_percent, 100u))));
+
+        float duration_ms = 20.0f;
+        if (options.frame_duration_ms > 0.0f)
+        {
+            constexpr float valid_durations[] = { 2.5f, 5.0f, 10.0f, 20.0f, 40.0f, 60.0f };
+            if (std::find(std::begin(valid_durations), std::end(valid_durations), options.frame_duration_ms) != std::end(valid_durations))
+                duration_ms = options.frame_duration_ms;
+            else
+                log::warn("Opus frame duration must be 2.5, 5, 10, 20, 40 or 60 ms. Got: {}, using 20.", options.frame_duration_ms);
+        }
+
+        m_data->frames_per_packet = static_cast<int>(static_cast<float>(m_data->sample_rate) * duration_ms / 1000.0f);
+    }
+
     void opus_encoder::deinit()
     {
         deinit_impl();
@@ -153,39 +283,104 @@ namespace myro
     {
         if (!m_data->initialized || frame_count == 0) return;
 
-        m_data->pcm_buffer.insert(m_data->pcm_buffer.end(), pcm_frames, pcm_frames + (frame_count * m_data->channels));
+        const size_t count = frame_count * m_data->channels;
+        m_data->conversion_buffer.resize(count);
+        for (size_t i = 0; i < count; ++i)
+            m_data->conversion_buffer[i] = static_cast<float>(pcm_frames[i]) / 32768.f;
 
-        int samples_per_packet = m_data->frames_per_packet * m_data->channels;
+        write(static_cast<const float*>(m_data->conversion_buffer.data()), frame_count);
+    }
 
-        while (m_data->pcm_buffer.size() >= static_cast<size_t>(samples_per_packet))
+    void opus_encoder::write(const float* pcm_frames, size_t frame_count)
+    {
+        if (!m_data->initialized || frame_count == 0) return;
+
+        m_data->pcm_packetizer.push(pcm_frames, frame_count * m_data->channels, [this](const float* pcm) { encode_packet(pcm, false); });
+    }
+
+    void opus_encoder::write_gap(size_t frame_count)
+    {
+        if (!m_data->initialized || frame_count == 0) return;
+
+        // A packet holding only its TOC byte is Opus' DTX signal: the decoder fills one frame with
+        // concealment. It is only valid when that single frame spans a whole packet, so multistream
+        // and multi-frame (40/60 ms CELT) packets fall back to encoding silence.
+        unsigned char toc = static_cast<unsigned char>(m_data->last_toc & 0xFC);
+        if (m_data->ms_encoder || m_data->last_toc < 0 ||
+            opus_packet_get_nb_samples(&toc, 1, static_cast<opus_int32>(m_data->sample_rate)) != m_data->frames_per_packet)
         {
-            unsigned char out_packet[4000];
-            
-            int bytes = opus_encode(
-                m_data->encoder, 
-                m_data->pcm_buffer.data(), 
-                m_data->frames_per_packet, 
-                out_packet, 
-                sizeof(out_packet)
-            );
-
-            if (bytes > 0)
-            {
-                m_data->granule_pos += (m_data->frames_per_packet * 48000) / m_data->sample_rate;
+            IEncoder::write_gap(frame_count);
+            return;
+        }
+
+        const size_t packet_frames = static_cast<size_t>(m_data->frames_per_packet);
+        const size_t pending_frames = m_data->pcm_packetizer.pending() / m_data->channels;
+        if (pending_frames > 0)
+        {
+            const size_t fill = std::min(frame_count, packet_frames - pending_frames);
+            IEncoder::write_gap(fill);
+            frame_count -= fill;
+        }
 
-                m_data->op.packet = out_packet;
-                m_data->op.bytes = bytes;
-                m_data->op.b_o_s = 0;
-                m_data->op.e_o_s = 0;
-                m_data->op.granulepos = m_data->granule_pos;
-                m_data->op.packetno = m_data->packet_count++;
+        for (; frame_count >= packet_frames; frame_count -= packet_frames)
+            write_packet(&toc, 1, false);
 
-                ogg_stream_packetin(&m_data->os, &m_data->op);
-                flush_ogg_pages(false);
-            }
+        if (frame_count > 0)
+            IEncoder::write_gap(frame_count);
+    }
+
+    void opus_encoder::encode_packet(const float* pcm, bool end_of_stream)
+    {
+        int bytes = 0;
+        if (m_data->ms_encoder)
+        {
+            const uint8_t* order = vorbis_order[m_data->channels];
+            const size_t channels = m_data->channels;
+            float* reordered = m_data->reorder_buffer.data();
+            for (size_t frame = 0; frame < static_cast<size_t>(m_data->frames_per_packet); ++frame)
+                for (size_t c = 0; c < channels; ++c)
+                    reordered[frame * channels + c] = pcm[frame * channels + order[c]];
+
+            bytes = opus_multistream_encode_float(m_data->ms_encoder, reordered, m_data->frames_per_packet,
+                m_data->packet_buffer.data(), static_cast<opus_int32>(m_data->packet_buffer.size()));
+        }
+        else
+        {
+            bytes = opus_encode_float(m_data->encoder, pcm, m_data->frames_per_packet,
+                m_data->packet_buffer.data(), static_cast<opus_int32>(m_data->packet_buffer.size()));
+        }
+
+        if (bytes > 0)
+        {
+            if (!m_data->ms_encoder)
+                m_data->last_toc = m_data->packet_buffer[0];
+            write_packet(m_data->packet_buffer.data(), bytes, end_of_stream);
+        }
+        else if (bytes < 0)
+            log::error("Opus encoding error code: {}", bytes);
+    }
+
+    void opus_encoder::write_packet(unsigned char* packet, int bytes, bool end_of_stream)
+    {
+        m_data->granule_pos += (m_data->frames_per_packet * 48000) / m_data->sample_rate;
 
-            m_data->pcm_buffer.erase(m_data->pcm_buffer.begin(), m_data->pcm_buffer.begin() + samples_per_packet);
+        if (m_data->raw_packets)
+        {
+            m_data->sink->write_packet(packet, static_cast<size_t>(bytes), m_data->granule_pos);
+            return;
         }
+
+        m_data->op.packet = packet;
+        m_data->op.bytes = bytes;
+        m_data->op.b_o_s = 0;
+        m_data->op.e_o_s = end_of_stream ? 1 : 0;
+        m_data->op.granulepos = m_data->granule_pos;
+        m_data->op.packetno = m_data->packet_count++;
+
+        ogg_stream_packetin(&m_data->os, &m_data->op);
+
+        if (!end_of_stream)
+            flush_ogg_pages(false);
     }
 
     void opus_encoder::flush_ogg_pages(bool force_flush)
@@ -196,8 +391,8 @@ namespace myro
                                      : ogg_stream_pageout(&m_data->os, &m_data->og);
             if (result == 0) break;
             
-            m_data->file.write(reinterpret_cast<char*>(m_data->og.header), m_data->og.header_len);
-            m_data->file.write(reinterpret_cast<char*>(m_data->og.body), m_data->og.body_len);
+            m_data->sink->write(m_data->og.header, m_data->og.header_len);
+            m_data->sink->write(m_data->og.body, m_data->og.body_len);
         }
     }
 
@@ -205,38 +400,24 @@ namespace myro
     {
         if (!m_data->initialized) return;
 
-        if (!m_data->pcm_buffer.empty())
-        {
-            int samples_per_packet = m_data->frames_per_packet * m_data->channels;
-            m_data->pcm_buffer.resize(samples_per_packet, 0);
-
-            unsigned char out_packet[4000];
-            int bytes = opus_encode(m_data->encoder, m_data->pcm_buffer.data(), m_data->frames_per_packet, out_packet, sizeof(out_packet));
-            
-            if (bytes > 0)
-            {
-                m_data->granule_pos += (m_data->frames_per_packet * 48000) / m_data->sample_rate;
-
-                m_data->op.packet = out_packet;
-                m_data->op.bytes = bytes;
-                m_data->op.b_o_s = 0;
-                m_data->op.e_o_s = 1; // END OF STREAM signal!
-                m_data->op.granulepos = m_data->granule_pos;
-                m_data->op.packetno = m_data->packet_count++;
+        m_data->pcm_packetizer.flush([this](const float* pcm) { encode_packet(pcm, true); });
 
-                ogg_stream_packetin(&m_data->os, &m_data->op);
-            }
+        if (!m_data->raw_packets)
+        {
+            flush_ogg_pages(true);
+            ogg_stream_clear(&m_data->os);
         }
-
-        flush_ogg_pages(true);
-
-        ogg_stream_clear(&m_data->os);
         
         if (m_data->encoder)
             opus_encoder_destroy(m_data->encoder);
-
-        if (m_data->file.is_open())
-            m_data->file.close();
+        if (m_data->ms_encoder)
+            opus_multistream_encoder_destroy(m_data->ms_encoder);
+        m_data->encoder = nullptr;
+        m_data->ms_encoder = nullptr;
+
+        m_data->sink->flush();
+        m_data->sink->close();
+        m_data->sink = nullptr;
 
         m_data->initialized = false;
     }
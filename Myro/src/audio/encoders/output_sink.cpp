@@ -0,0 +1,362 @@
+#include "audio/encoders/output_sink.h"
+#include "core/log.h"
+
+#include "internal/detail.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace myro
+{
+    bool IOutputSink::write_packet(const void* data, size_t size, int64_t granule_position)
+    {
+        MYRO_UNUSED(granule_position);
+
+        const uint32_t length = static_cast<uint32_t>(size);
+        const unsigned char prefix[4] = {
+            static_cast<unsigned char>(length & 0xFF), static_cast<unsigned char>((length >> 8) & 0xFF),
+            static_cast<unsigned char>((length >> 16) & 0xFF), static_cast<unsigned char>((length >> 24) & 0xFF)
+        };
+
+        return write(prefix, sizeof(prefix)) && write(data, size);
+    }
+
+    std::shared_ptr<file_output_sink> file_output_sink::create(const std::filesystem::path& path)
+    {
+        FILE* file = detail::open_file(path, "wb");
+        if (!file)
+        {
+            log::error("File could not be created: {}", path.string());
+            return nullptr;
+        }
+
+        return std::make_shared<file_output_sink>(file);
+    }
+
+    file_output_sink::~file_output_sink()
+    {
+        close();
+    }
+
+    bool file_output_sink::write(const void* data, size_t size)
+    {
+        if (!m_file)
+            return false;
+
+        if (std::fwrite(data, 1, size, m_file) != size)
+        {
+            log::error("Failed to write {} bytes to file sink.", size);
+            return false;
+        }
+
+        m_position += size;
+        return true;
+    }
+
+    bool file_output_sink::seek(uint64_t position)
+    {
+        if (!m_file)
+            return false;
+
+        if (!detail::fseek_checked(m_file, static_cast<int64_t>(position), SEEK_SET))
+            return false;
+
+        m_position = position;
+        return true;
+    }
+
+    void file_output_sink::flush()
+    {
+        if (m_file)
+            std::fflush(m_file);
+    }
+
+    void file_output_sink::close()
+    {
+        if (!m_file)
+            return;
+
+        detail::fclose_checked(m_file);
+        m_file = nullptr;
+    }
+
+    namespace
+    {
+        constexpr size_t min_block_size = 4096;
+
+        using sink_clock = std::chrono::steady_clock;
+    }
+
+    struct _async_file_output_sink_data
+    {
+        struct block
+        {
+            std::unique_ptr<uint8_t[]> bytes;
+            size_t used = 0;
+        };
+
+        static constexpr size_t no_block = static_cast<size_t>(-1);
+
+        FILE* file = nullptr;
+        async_file_options options;
+        size_t block_size = 0;
+        std::vector<block> blocks;
+
+        // The active block belongs to the producer; queued blocks belong to the writer thread.
+        size_t active = no_block;
+        std::deque<size_t> free_blocks;
+        std::deque<size_t> full_blocks;
+        bool writing = false;
+        bool stopping = false;
+
+        std::mutex mutex;
+        std::condition_variable work_available;
+        std::condition_variable block_released;
+        std::thread writer;
+
+        std::atomic<bool> failed{ false };
+        uint64_t position = 0;
+        sink_clock::time_point last_submit = sink_clock::now();
+        sink_clock::time_point last_flush = sink_clock::now();
+
+        void writer_loop()
+        {
+            std::unique_lock lock(mutex);
+            while (true)
+            {
+                work_available.wait(lock, [this]() { return stopping || !full_blocks.empty(); });
+                if (full_blocks.empty())
+                    break;
+
+                const size_t index = full_blocks.front();
+                full_blocks.pop_front();
+                writing = true;
+                lock.unlock();
+
+                block& b = blocks[index];
+                if (!failed.load(std::memory_order_relaxed) && std::fwrite(b.bytes.get(), 1, b.used, file) != b.used)
+                {
+                    log::error("Async file sink failed to write {} bytes.", b.used);
+                    failed.store(true, std::memory_order_relaxed);
+                }
+
+                const auto now = sink_clock::now();
+                if (options.policy == flush_policy::every_block ||
+                    (options.policy == flush_policy::periodic && now - last_flush >= std::chrono::milliseconds(options.flush_interval_ms)))
+                {
+                    if (!failed.load(std::memory_order_relaxed))
+                        detail::sync_file(file);
+                    last_flush = now;
+                }
+
+                lock.lock();
+                b.used = 0;
+                free_blocks.push_back(index);
+                writing = false;
+                block_released.notify_all();
+            }
+        }
+
+        void submit_active()
+        {
+            std::scoped_lock lock(mutex);
+            full_blocks.push_back(active);
+            active = no_block;
+            last_submit = sink_clock::now();
+            work_available.notify_one();
+        }
+
+        // Blocks only when every block is queued for the disk.
+        void acquire_block()
+        {
+            std::unique_lock lock(mutex);
+            block_released.wait(lock, [this]() { return !free_blocks.empty(); });
+            active = free_blocks.front();
+            free_blocks.pop_front();
+        }
+
+        void drain()
+        {
+            if (active != no_block && blocks[active].used > 0)
+                submit_active();
+
+            std::unique_lock lock(mutex);
+            block_released.wait(lock, [this]() { return full_blocks.empty() && !writing; });
+        }
+    };
+
+    std::shared_ptr<async_file_output_sink> async_file_output_sink::create(const std::filesystem::path& path, const async_file_options& options)
+    {
+        FILE* file = detail::open_file(path, "wb");
+        if (!file)
+        {
+            log::error("File could not be created: {}", path.string());
+            return nullptr;
+        }
+
+        return std::make_shared<async_file_output_sink>(file, options);
+    }
+
+    async_file_output_sink::async_file_output_sink(FILE* file, const async_file_options& options) : m_data(new _async_file_output_sink_data())
+    {
+        m_data->file = file;
+        m_data->options = options;
+        m_data->block_size = std::max(options.block_size, min_block_size);
+
+        const uint32_t block_count = std::max(options.block_count, 2u);
+        m_data->blocks.resize(block_count);
+        for (size_t i = 0; i < block_count; ++i)
+        {
+            m_data->blocks[i].bytes = std::make_unique_for_overwrite<uint8_t[]>(m_data->block_size);
+            m_data->free_blocks.push_back(i);
+        }
+
+        m_data->writer = std::thread([data = m_data]() { data->writer_loop(); });
+    }
+
+    async_file_output_sink::~async_file_output_sink()
+    {
+        close();
+        delete m_data;
+    }
+
+    bool async_file_output_sink::write(const void* data, size_t size)
+    {
+        if (!m_data->file || m_data->failed.load(std::memory_order_relaxed))
+            return false;
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        m_data->position += size;
+
+        while (size > 0)
+        {
+            if (m_data->active == _async_file_output_sink_data::no_block)
+                m_data->acquire_block();
+
+            auto& block = m_data->blocks[m_data->active];
+            const size_t n = std::min(size, m_data->block_size - block.used);
+            std::memcpy(block.bytes.get() + block.used, bytes, n);
+            block.used += n;
+            bytes += n;
+            size -= n;
+
+            if (block.used == m_data->block_size)
+                m_data->submit_active();
+        }
+
+        // Bounds how much audio can sit in memory when the stream is slow to fill a block.
+        if (m_data->options.policy == flush_policy::periodic && m_data->active != _async_file_output_sink_data::no_block &&
+            sink_clock::now() - m_data->last_submit >= std::chrono::milliseconds(m_data->options.flush_interval_ms))
+        {
+            m_data->submit_active();
+        }
+
+        return true;
+    }
+
+    bool async_file_output_sink::seek(uint64_t position)
+    {
+        if (!m_data->file)
+            return false;
+
+        m_data->drain();
+        if (!detail::fseek_checked(m_data->file, static_cast<int64_t>(position), SEEK_SET))
+            return false;
+
+        m_data->position = position;
+        return true;
+    }
+
+    uint64_t async_file_output_sink::tell() const
+    {
+        return m_data->position;
+    }
+
+    bool async_file_output_sink::can_seek() const
+    {
+        return m_data->file != nullptr;
+    }
+
+    void async_file_output_sink::flush()
+    {
+        if (!m_data->file)
+            return;
+
+        m_data->drain();
+        detail::sync_file(m_data->file);
+    }
+
+    void async_file_output_sink::close()
+    {
+        if (!m_data->file)
+            return;
+
+        m_data->drain();
+        {
+            std::scoped_lock lock(m_data->mutex);
+            m_data->stopping = true;
+            m_data->work_available.notify_one();
+        }
+        m_data->writer.join();
+
+        if (!m_data->failed.load(std::memory_order_relaxed))
+            detail::sync_file(m_data->file);
+        detail::fclose_checked(m_data->file);
+        m_data->file = nullptr;
+    }
+
+    bool memory_output_sink::write(const void* data, size_t size)
+    {
+        const size_t end = static_cast<size_t>(m_position) + size;
+        if (end > m_buffer.size())
+            m_buffer.resize(end);
+
+        std::memcpy(m_buffer.data() + m_position, data, size);
+        m_position = end;
+        return true;
+    }
+
+    bool memory_output_sink::seek(uint64_t position)
+    {
+        if (position > m_buffer.size())
+            return false;
+
+        m_position = position;
+        return true;
+    }
+
+    std::vector<uint8_t> memory_output_sink::take()
+    {
+        m_position = 0;
+        return std::exchange(m_buffer, {});
+    }
+
+    bool callback_output_sink::write(const void* data, size_t size)
+    {
+        if (!m_on_write || !m_on_write(data, size))
+            return false;
+
+        m_position += size;
+        return true;
+    }
+
+    void callback_output_sink::close()
+    {
+        if (m_on_close)
+            m_on_close();
+    }
+
+    bool callback_output_sink::write_packet(const void* data, size_t size, int64_t granule_position)
+    {
+        if (m_on_packet)
+            return m_on_packet(data, size, granule_position);
+
+        return IOutputSink::write_packet(data, size, granule_position);
+    }
+}
@@ -0,0 +1,304 @@
+#include "audio/encoders/segmented_encoder.h"
+
+#include "core/log.h"
+#include "core/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <future>
+#include <utility>
+#include <vector>
+
+namespace myro
+{
+    struct _segmented_encoder_data
+    {
+        segmented_encoder_options options;
+        thread_pool worker{ 1 };
+
+        // Written only by the thread that feeds the encoder.
+        std::shared_ptr<IEncoder> current;
+        std::future<std::shared_ptr<IEncoder>> next;
+        uint64_t segment_frames = 0;
+        uint64_t frames_in_segment = 0;
+        std::atomic<uint64_t> segment_index{ 0 };
+        std::atomic<uint64_t> rotation_failures{ 0 };
+
+        // Touched only by the worker (and by init before the first segment opens). Oldest first,
+        // including the segments earlier sessions left in the directory.
+        std::deque<std::filesystem::path> closed_segments;
+
+        uint32_t sample_rate = 0;
+        uint16_t channels = 0;
+        uint16_t bits_per_sample = 16;
+        bool initialized = false;
+
+        std::filesystem::path segment_path(uint64_t index) const
+        {
+            std::string number = std::to_string(index);
+            if (number.size() < 6)
+                number.insert(0, 6 - number.size(), '0');
+
+            return options.directory / (options.base_name + "_" + number + get_file_extension(options.format));
+        }
+
+        // Segments already in the directory, e.g. from an earlier session, ordered by index.
+        std::vector<std::pair<uint64_t, std::filesystem::path>> existing_segments() const
+        {
+            const std::string prefix = options.base_name + "_";
+            const std::string extension = get_file_extension(options.format);
+            std::vector<std::pair<uint64_t, std::filesystem::path>> segments;
+
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(options.directory, ec))
+            {
+                const std::string stem = entry.path().stem().string();
+                if (entry.path().extension().string() != extension || !stem.starts_with(prefix) || stem.size() == prefix.size())
+                    continue;
+
+                const std::string number = stem.substr(prefix.size());
+                if (number.size() <= 18 && number.find_first_not_of("0123456789") == std::string::npos)
+                    segments.emplace_back(std::stoull(number), entry.path());
+            }
+
+            std::ranges::sort(segments);
+            return segments;
+        }
+
+        void apply_retention()
+        {
+            while (options.retention_count > 0 && closed_segments.size() > options.retention_count)
+            {
+                std::error_code ec;
+                if (!std::filesystem::remove(closed_segments.front(), ec) && ec)
+                    log::warn("Failed to remove old segment {}: {}", closed_segments.front().string(), ec.message());
+
+                closed_segments.pop_front();
+            }
+        }
+
+        std::shared_ptr<IEncoder> open_segment(uint64_t index) const
+        {
+            std::shared_ptr<IEncoder> encoder = options.encoder_factory ? options.encoder_factory() : create_encoder(options.format);
+            const std::filesystem::path path = segment_path(index);
+
+            if (!encoder || !encoder->init(path, sample_rate, channels))
+            {
+                log::error("Failed to open capture segment: {}", path.string());
+                return nullptr;
+            }
+
+            return encoder;
+        }
+
+        void close_segment(const std::shared_ptr<IEncoder>& encoder, const std::filesystem::path& path)
+        {
+            encoder->deinit();
+
+            if (options.on_segment_closed)
+                options.on_segment_closed(path);
+
+            closed_segments.push_back(path);
+            apply_retention();
+        }
+    };
+
+    segmented_encoder::segmented_encoder(const segmented_encoder_options& options) : m_data(new _segmented_encoder_data())
+    {
+        m_data->options = options;
+    }
+
+    segmented_encoder::~segmented_encoder()
+    {
+        deinit();
+        delete m_data;
+    }
+
+    bool segmented_encoder::init(unsigned int sample_rate, unsigned int channels)
+    {
+        if (m_data->initialized)
+            deinit();
+
+        const segmented_encoder_options& options = m_data->options;
+        if (options.segment_duration_ms == 0 || get_file_extension(options.format).empty())
+        {
+            log::warn("Segmented capture needs a known format and a non-zero segment duration!");
+            return false;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(options.directory, ec);
+        if (ec)
+        {
+            log::error("Segment directory could not be created: {} ({})", options.directory.string(), ec.message());
+            return false;
+        }
+
+        m_data->sample_rate = sample_rate;
+        m_data->channels = static_cast<uint16_t>(channels);
+        m_data->segment_frames = std::max<uint64_t>(static_cast<uint64_t>(sample_rate) * options.segment_duration_ms / 1000, 1);
+        m_data->frames_in_segment = 0;
+        m_data->rotation_failures = 0;
+
+        // Earlier sessions' segments count towards the retention too; numbering continues after them,
+        // so they are never overwritten.
+        m_data->closed_segments.clear();
+        uint64_t index = 0;
+        for (auto& [existing_index, path] : m_data->existing_segments())
+        {
+            m_data->closed_segments.push_back(std::move(path));
+            index = existing_index + 1;
+        }
+        m_data->apply_retention();
+
+        m_data->current = m_data->open_segment(index);
+        if (!m_data->current)
+            return false;
+
+        m_data->segment_index = index;
+        m_data->bits_per_sample = m_data->current->get_bits_per_sample();
+        m_data->next = m_data->worker.enqueue([data = m_data, index]() { return data->open_segment(index + 1); });
+        m_data->initialized = true;
+        return true;
+    }
+
+    bool segmented_encoder::init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels)
+    {
+        MYRO_UNUSED(sink);
+        MYRO_UNUSED(sample_rate);
+        MYRO_UNUSED(channels);
+        log::warn("segmented_encoder writes its own files; use init(sample_rate, channels).");
+        return false;
+    }
+
+    void segmented_encoder::deinit()
+    {
+        if (!m_data->initialized)
+            return;
+
+        m_data->initialized = false;
+
+        // The pre-opened segment was never written to, so it is discarded rather than kept as an empty file.
+        const uint64_t index = m_data->segment_index;
+        std::shared_ptr<IEncoder> unused = m_data->next.valid() ? m_data->next.get() : nullptr;
+        if (unused)
+        {
+            unused->deinit();
+            std::error_code ec;
+            std::filesystem::remove(m_data->segment_path(index + 1), ec);
+        }
+
+        if (m_data->current)
+        {
+            m_data->worker.enqueue([data = m_data, encoder = m_data->current, path = m_data->segment_path(index)]() { data->close_segment(encoder, path); }).wait();
+            m_data->current = nullptr;
+        }
+    }
+
+    bool segmented_encoder::initialized() const
+    {
+        return m_data->initialized;
+    }
+
+    uint32_t segmented_encoder::get_sample_rate() const
+    {
+        return m_data->sample_rate;
+    }
+
+    uint16_t segmented_encoder::get_channels() const
+    {
+        return m_data->channels;
+    }
+
+    uint16_t segmented_encoder::get_bits_per_sample() const
+    {
+        return m_data->bits_per_sample;
+    }
+
+    template <class WritePart>
+    void segmented_encoder::write_segmented(size_t frame_count, WritePart&& write_part)
+    {
+        size_t first = 0;
+        while (frame_count > 0 && m_data->current)
+        {
+            const size_t take = static_cast<size_t>(std::min<uint64_t>(frame_count, m_data->segment_frames - m_data->frames_in_segment));
+            write_part(*m_data->current, first, take);
+
+            first += take;
+            frame_count -= take;
+            m_data->frames_in_segment += take;
+
+            if (m_data->frames_in_segment == m_data->segment_frames)
+                rotate();
+        }
+    }
+
+    void segmented_encoder::write(const short* pcm_frames, size_t frame_count)
+    {
+        const size_t channels = m_data->channels;
+        write_segmented(frame_count, [pcm_frames, channels](IEncoder& encoder, size_t first, size_t count) { encoder.write(pcm_frames + first * channels, count); });
+    }
+
+    void segmented_encoder::write(const float* pcm_frames, size_t frame_count)
+    {
+        const size_t channels = m_data->channels;
+        write_segmented(frame_count, [pcm_frames, channels](IEncoder& encoder, size_t first, size_t count) { encoder.write(pcm_frames + first * channels, count); });
+    }
+
+    void segmented_encoder::write_gap(size_t frame_count)
+    {
+        write_segmented(frame_count, [](IEncoder& encoder, size_t, size_t count) { encoder.write_gap(count); });
+    }
+
+    uint64_t segmented_encoder::get_segment_index() const
+    {
+        return m_data->segment_index.load(std::memory_order_relaxed);
+    }
+
+    std::filesystem::path segmented_encoder::get_segment_path(uint64_t index) const
+    {
+        return m_data->segment_path(index);
+    }
+
+    uint64_t segmented_encoder::get_rotation_failures() const
+    {
+        return m_data->rotation_failures.load(std::memory_order_relaxed);
+    }
+
+    const segmented_encoder_options& segmented_encoder::get_options() const
+    {
+        return m_data->options;
+    }
+
+    bool segmented_encoder::rotate()
+    {
+        const uint64_t closing_index = m_data->segment_index;
+        const uint64_t index = closing_index + 1;
+
+        // Normally ready long ago; only blocks if the worker fell a whole segment behind.
+        std::shared_ptr<IEncoder> next = m_data->next.valid() ? m_data->next.get() : nullptr;
+        if (!next)
+            next = m_data->open_segment(index);
+
+        m_data->frames_in_segment = 0;
+
+        // The stream stays in the open segment instead of being dropped; it runs one more segment
+        // length before the next attempt, which the worker prepares meanwhile.
+        if (!next)
+        {
+            m_data->rotation_failures.fetch_add(1, std::memory_order_relaxed);
+            log::error("Segment rotation failed, still writing to {}", m_data->segment_path(closing_index).string());
+            m_data->next = m_data->worker.enqueue([data = m_data, index]() { return data->open_segment(index); });
+            return false;
+        }
+
+        std::shared_ptr<IEncoder> closing = std::exchange(m_data->current, std::move(next));
+        m_data->segment_index = index;
+
+        m_data->worker.enqueue([data = m_data, closing, path = m_data->segment_path(closing_index)]() { data->close_segment(closing, path); });
+        m_data->next = m_data->worker.enqueue([data = m_data, index]() { return data->open_segment(index + 1); });
+
+        return true;
+    }
+}
@@ -1,10 +1,12 @@
 ﻿#include "audio/encoders/speex_encoder.h"
 #include "core/log.h"
 
+#include "internal/packetizer.h"
+
+#include <algorithm>
 #include <vector>
 #include <cstring>
 #include <random>
-#include <fstream>
 
 #include <speex/speex.h>
 #include <speex/speex_header.h>
@@ -15,9 +17,10 @@ namespace myro
 {
     struct _speex_encoder_data
     {
-        std::ofstream file;
+        std::shared_ptr<IOutputSink> sink;
         
         bool initialized = false;
+        bool raw_packets = false;
         uint32_t sample_rate = 0;
         uint16_t channels = 0;
         
@@ -32,7 +35,15 @@ namespace myro
         int64_t packet_count = 0;
         int64_t granule_pos = 0;
 
-        std::vector<short> pcm_buffer;
+        packetizer<short> pcm_packetizer;
+        std::vector<short> frame_buffer;
+        std::vector<char> packet_buffer;
+
+        // Gap frames are real silence run through the encoder with VAD/DTX on, so its predictor state
+        // follows the stream the decoder sees; DTX keeps the packets tiny. gap_dtx is set while DTX
+        // is only on for a gap and goes off again with the next real audio.
+        std::vector<short> silence_frame;
+        bool gap_dtx = false;
     };
 
     speex_encoder::speex_encoder() : m_data(new _speex_encoder_data{}) {}
@@ -48,7 +59,7 @@ namespace myro
         }
     }
 
-    bool speex_encoder::init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels)
+    bool speex_encoder::init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels)
     {
         if (m_data->initialized)
         {
@@ -56,8 +67,14 @@ namespace myro
             return false;
         }
 
+        if (!sink)
+            return false;
+
         m_data->sample_rate = sample_rate;
         m_data->channels = static_cast<uint16_t>(channels);
+        m_data->raw_packets = m_output_mode == encoder_output_mode::raw_packets;
+        m_data->granule_pos = 0;
+        m_data->packet_count = 0;
 
         const SpeexMode* mode;
         if (sample_rate <= 8000)       mode = speex_lib_get_mode(SPEEX_MODEID_NB);
@@ -67,20 +84,24 @@ namespace myro
         m_data->speex_state = speex_encoder_init(mode);
         speex_bits_init(&m_data->bits);
 
-        int quality = 8;
-        speex_encoder_ctl(m_data->speex_state, SPEEX_SET_QUALITY, &quality);
+        configure_encoder();
         
         int actual_rate = static_cast<int>(sample_rate);
         speex_encoder_ctl(m_data->speex_state, SPEEX_SET_SAMPLING_RATE, &actual_rate);
         speex_encoder_ctl(m_data->speex_state, SPEEX_GET_FRAME_SIZE, &m_data->frame_size);
 
-        m_data->file.open(output_filepath, std::ios::binary);
-        if (!m_data->file.is_open())
+        m_data->pcm_packetizer.reset(static_cast<size_t>(m_data->frame_size) * m_data->channels);
+        m_data->frame_buffer.resize(m_data->pcm_packetizer.packet_size());
+        m_data->silence_frame.assign(m_data->pcm_packetizer.packet_size(), 0);
+        m_data->gap_dtx = false;
+
+        m_data->sink = sink;
+
+        // Raw packet consumers get the stream parameters out of band, so there are no header packets.
+        if (m_data->raw_packets)
         {
-            log::error("File could not be created for speex encoder: {}", output_filepath.string());
-            speex_encoder_destroy(m_data->speex_state);
-            speex_bits_destroy(&m_data->bits);
-            return false;
+            m_data->initialized = true;
+            return true;
         }
 
         ogg_stream_init(&m_data->os, static_cast<int>(std::random_device{}()));
@@ -89,7 +110,7 @@ namespace myro
         speex_init_header(&header, static_cast<int>(m_data->sample_rate), m_data->channels, mode);
         
         header.frames_per_packet = 1; 
-        header.vbr = 0;
+        header.vbr = (m_options.mode == bitrate_mode::vbr || m_options.mode == bitrate_mode::abr) ? 1 : 0;
 
         int header_size = 0;
         char* header_data = speex_header_to_packet(&header, &header_size);
@@ -135,6 +156,60 @@ namespace myro
         return true;
     }
 
+    void speex_encoder::configure_encoder()
+    {
+        const encoder_options& options = m_options;
+        void* state = m_data->speex_state;
+
+        const float quality = options.quality >= 0.0f ? 10.0f * std::min(options.quality, 1.0f) : 8.0f;
+        int int_quality = static_cast<int>(quality + 0.5f);
+        speex_encoder_ctl(state, SPEEX_SET_QUALITY, &int_quality);
+
+        switch (options.mode)
+        {
+        case bitrate_mode::vbr:
+        {
+            int vbr = 1;
+            float vbr_quality = quality;
+            speex_encoder_ctl(state, SPEEX_SET_VBR, &vbr);
+            speex_encoder_ctl(state, SPEEX_SET_VBR_QUALITY, &vbr_quality);
+            break;
+        }
+        case bitrate_mode::abr:
+        {
+            int abr = static_cast<int>(options.bitrate != 0 ? options.bitrate : 24000);
+            speex_encoder_ctl(state, SPEEX_SET_ABR, &abr);
+            break;
+        }
+        case bitrate_mode::cbr:
+            if (options.bitrate != 0)
+            {
+                int bitrate = static_cast<int>(options.bitrate);
+                speex_encoder_ctl(state, SPEEX_SET_BITRATE, &bitrate);
+            }
+            break;
+        case bitrate_mode::codec_default:
+            break;
+        }
+
+        if (options.complexity >= 0)
+        {
+            int complexity = std::clamp(options.complexity, 1, 10);
+            speex_encoder_ctl(state, SPEEX_SET_COMPLEXITY, &complexity);
+        }
+
+        if (options.dtx)
+            set_dtx(true);
+    }
+
+    void speex_encoder::set_dtx(bool enabled)
+    {
+        // DTX only kicks in for frames the voice activity detector marks as silence.
+        int value = enabled ? 1 : 0;
+        speex_encoder_ctl(m_data->speex_state, SPEEX_SET_VAD, &value);
+        speex_encoder_ctl(m_data->speex_state, SPEEX_SET_DTX, &value);
+    }
+
     void speex_encoder::deinit() { deinit_impl(); }
     bool speex_encoder::initialized() const { return m_data->initialized; }
     uint32_t speex_encoder::get_sample_rate() const { return m_data->sample_rate; }
@@ -145,100 +220,130 @@ namespace myro
     {
         if (!m_data->initialized || frame_count == 0) return;
 
-        m_data->pcm_buffer.insert(m_data->pcm_buffer.end(), pcm_frames, pcm_frames + (frame_count * m_data->channels));
-
-        int samples_per_frame = m_data->frame_size * m_data->channels;
-
-        while (m_data->pcm_buffer.size() >= static_cast<size_t>(samples_per_frame))
+        if (m_data->gap_dtx)
         {
-            speex_bits_reset(&m_data->bits);
-            std::vector<short> frame_copy(m_data->pcm_buffer.begin(), m_data->pcm_buffer.begin() + samples_per_frame);
-
-            if (m_data->channels == 2)
-            {
-                speex_encode_stereo_int(frame_copy.data(), m_data->frame_size, &m_data->bits);
-                speex_encode_int(m_data->speex_state, frame_copy.data(), &m_data->bits);
-            }
-            else
-            {
-                speex_encode_int(m_data->speex_state, frame_copy.data(), &m_data->bits);
-            }
+            m_data->gap_dtx = false;
+            set_dtx(false);
+        }
 
-            int bytes = speex_bits_nbytes(&m_data->bits);
-            std::vector<char> out_packet(bytes);
-            speex_bits_write(&m_data->bits, out_packet.data(), bytes);
+        m_data->pcm_packetizer.push(pcm_frames, frame_count * m_data->channels, [this](const short* frame) { encode_frame(frame, false); });
+    }
 
-            m_data->granule_pos += m_data->frame_size;
+    void speex_encoder::write_gap(size_t frame_count)
+    {
+        if (!m_data->initialized || frame_count == 0) return;
 
-            m_data->op.packet = reinterpret_cast<unsigned char*>(out_packet.data());
-            m_data->op.bytes = bytes;
-            m_data->op.b_o_s = 0;
-            m_data->op.e_o_s = 0;
-            m_data->op.granulepos = m_data->granule_pos;
-            m_data->op.packetno = m_data->packet_count++;
+        const size_t frame_frames = static_cast<size_t>(m_data->frame_size);
+        const size_t pending_frames = m_data->pcm_packetizer.pending() / m_data->channels;
+        if (pending_frames > 0)
+        {
+            const size_t fill = std::min(frame_count, frame_frames - pending_frames);
+            IEncoder::write_gap(fill);
+            frame_count -= fill;
+        }
 
-            ogg_stream_packetin(&m_data->os, &m_data->op);
-            flush_ogg_pages(false);
+        for (; frame_count >= frame_frames; frame_count -= frame_frames)
+            write_silence_frame();
 
-            m_data->pcm_buffer.erase(m_data->pcm_buffer.begin(), m_data->pcm_buffer.begin() + samples_per_frame);
-        }
+        if (frame_count > 0)
+            IEncoder::write_gap(frame_count);
     }
 
-    void speex_encoder::flush_ogg_pages(bool force_flush)
+    void speex_encoder::write_silence_frame()
     {
-        while (true)
+        if (!m_options.dtx && !m_data->gap_dtx)
         {
-            int result = force_flush ? ogg_stream_flush(&m_data->os, &m_data->og) 
-                                     : ogg_stream_pageout(&m_data->os, &m_data->og);
-            if (result == 0) break;
-            
-            m_data->file.write(reinterpret_cast<char*>(m_data->og.header), m_data->og.header_len);
-            m_data->file.write(reinterpret_cast<char*>(m_data->og.body), m_data->og.body_len);
+            m_data->gap_dtx = true;
+            set_dtx(true);
         }
+
+        encode_frame(m_data->silence_frame.data(), false);
     }
 
-    void speex_encoder::deinit_impl()
+    void speex_encoder::encode_frame(const short* frame, bool end_of_stream)
     {
-        if (!m_data->initialized) return;
-
-        int samples_per_frame = m_data->frame_size * m_data->channels;
-        m_data->pcm_buffer.resize(samples_per_frame, 0);
+        const int bytes = encode(frame);
+        emit_packet(m_data->packet_buffer.data(), bytes, end_of_stream);
+    }
 
+    int speex_encoder::encode(const short* frame)
+    {
         speex_bits_reset(&m_data->bits);
-        std::vector<short> frame_copy(m_data->pcm_buffer.begin(), m_data->pcm_buffer.begin() + samples_per_frame);
+
+        // Speex encodes in place (and downmixes stereo in place), so the caller's frame is copied first.
+        short* frame_copy = m_data->frame_buffer.data();
+        std::copy_n(frame, m_data->frame_buffer.size(), frame_copy);
 
         if (m_data->channels == 2)
         {
-            speex_encode_stereo_int(frame_copy.data(), m_data->frame_size, &m_data->bits);
-            speex_encode_int(m_data->speex_state, frame_copy.data(), &m_data->bits);
+            speex_encode_stereo_int(frame_copy, m_data->frame_size, &m_data->bits);
+            speex_encode_int(m_data->speex_state, frame_copy, &m_data->bits);
         }
         else
         {
-            speex_encode_int(m_data->speex_state, frame_copy.data(), &m_data->bits);
+            speex_encode_int(m_data->speex_state, frame_copy, &m_data->bits);
         }
 
         int bytes = speex_bits_nbytes(&m_data->bits);
-        std::vector<char> out_packet(bytes);
-        speex_bits_write(&m_data->bits, out_packet.data(), bytes);
+        if (m_data->packet_buffer.size() < static_cast<size_t>(bytes))
+            m_data->packet_buffer.resize(bytes);
+        speex_bits_write(&m_data->bits, m_data->packet_buffer.data(), bytes);
 
         m_data->granule_pos += m_data->frame_size;
+        return bytes;
+    }
+
+    void speex_encoder::emit_packet(const char* packet, int bytes, bool end_of_stream)
+    {
+        if (m_data->raw_packets)
+        {
+            m_data->sink->write_packet(packet, static_cast<size_t>(bytes), m_data->granule_pos);
+            return;
+        }
 
-        m_data->op.packet = reinterpret_cast<unsigned char*>(out_packet.data());
+        m_data->op.packet = reinterpret_cast<unsigned char*>(const_cast<char*>(packet));
         m_data->op.bytes = bytes;
         m_data->op.b_o_s = 0;
-        m_data->op.e_o_s = 1;
+        m_data->op.e_o_s = end_of_stream ? 1 : 0;
         m_data->op.granulepos = m_data->granule_pos;
         m_data->op.packetno = m_data->packet_count++;
-        
+
         ogg_stream_packetin(&m_data->os, &m_data->op);
-        flush_ogg_pages(true);
+        flush_ogg_pages(end_of_stream);
+    }
+
+    void speex_encoder::flush_ogg_pages(bool force_flush)
+    {
+        while (true)
+        {
+            int result = force_flush ? ogg_stream_flush(&m_data->os, &m_data->og) 
+                                     : ogg_stream_pageout(&m_data->os, &m_data->og);
+            if (result == 0) break;
+            
+            m_data->sink->write(m_data->og.header, m_data->og.header_len);
+            m_data->sink->write(m_data->og.body, m_data->og.body_len);
+        }
+    }
+
+    void speex_encoder::deinit_impl()
+    {
+        if (!m_data->initialized) return;
+
+        // The last packet carries the end of stream flag, so emit a silent one if nothing is pending.
+        if (!m_data->pcm_packetizer.flush([this](const short* frame) { encode_frame(frame, true); }))
+        {
+            std::vector<short> silence(m_data->pcm_packetizer.packet_size(), 0);
+            encode_frame(silence.data(), true);
+        }
 
-        ogg_stream_clear(&m_data->os);
+        if (!m_data->raw_packets)
+            ogg_stream_clear(&m_data->os);
         speex_bits_destroy(&m_data->bits);
         speex_encoder_destroy(m_data->speex_state);
 
-        if (m_data->file.is_open())
-            m_data->file.close();
+        m_data->sink->flush();
+        m_data->sink->close();
+        m_data->sink = nullptr;
 
         m_data->initialized = false;
     }
@@ -1,8 +1,9 @@
 ﻿#include "audio/encoders/vorbis_encoder.h"
 #include "core/log.h"
 
+#include <algorithm>
+#include <cstring>
 #include <random>
-#include <fstream>
 
 #include <vorbis/vorbisenc.h>
 
@@ -10,7 +11,7 @@ namespace myro
 {
     struct _vorbis_encoder_data
     {
-        std::ofstream file;
+        std::shared_ptr<IOutputSink> sink;
         
         bool initialized = false;
         uint32_t sample_rate = 0;
@@ -43,7 +44,7 @@ namespace myro
         }
     }
 
-    bool vorbis_encoder::init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels)
+    bool vorbis_encoder::init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels)
     {
         if (m_data->initialized)
         {
@@ -54,22 +55,37 @@ namespace myro
         m_data->sample_rate = sample_rate;
         m_data->channels = static_cast<uint16_t>(channels);
 
-        m_data->file.open(output_filepath, std::ios::binary);
-        if (!m_data->file.is_open())
-        {
-            log::error("File could not created for vorbis encoder: {}", output_filepath.string());
+        if (!sink)
             return false;
-        }
 
         vorbis_info_init(&m_data->vi);
-        int ret = vorbis_encode_init_vbr(&m_data->vi, m_data->channels, static_cast<long>(m_data->sample_rate), 0.4f);
+
+        const long rate = static_cast<long>(m_data->sample_rate);
+        const long bitrate = m_options.bitrate != 0 ? static_cast<long>(m_options.bitrate) : 128000;
+        int ret = 0;
+        switch (m_options.mode)
+        {
+        case bitrate_mode::cbr:
+            ret = vorbis_encode_init(&m_data->vi, m_data->channels, rate, bitrate, bitrate, bitrate);
+            break;
+        case bitrate_mode::abr:
+            ret = vorbis_encode_init(&m_data->vi, m_data->channels, rate, -1, bitrate, -1);
+            break;
+        case bitrate_mode::vbr:
+        case bitrate_mode::codec_default:
+            ret = vorbis_encode_init_vbr(&m_data->vi, m_data->channels, rate, m_options.quality >= 0.0f ? std::min(m_options.quality, 1.0f) : 0.4f);
+            break;
+        }
+
         if (ret != 0)
         {
-            log::error("Vorbis encoder could not initialized. (Invalid sample_rate or channels).");
+            log::error("Vorbis encoder could not initialized. (Invalid sample_rate, channels or bitrate).");
             vorbis_info_clear(&m_data->vi);
             return false;
         }
 
+        m_data->sink = sink;
+
         vorbis_comment_init(&m_data->vc);
         vorbis_comment_add_tag(&m_data->vc, "ENCODER", "Myro Audio Engine");
 
@@ -89,8 +105,8 @@ namespace myro
         {
             int result = ogg_stream_flush(&m_data->os, &m_data->og);
             if (result == 0) break;
-            m_data->file.write(reinterpret_cast<char*>(m_data->og.header), m_data->og.header_len);
-            m_data->file.write(reinterpret_cast<char*>(m_data->og.body), m_data->og.body_len);
+            m_data->sink->write(m_data->og.header, m_data->og.header_len);
+            m_data->sink->write(m_data->og.body, m_data->og.body_len);
         }
 
         m_data->initialized = true;
@@ -141,6 +157,55 @@ namespace myro
         flush_ogg_pages();
     }
 
+    void vorbis_encoder::write(const float* pcm_frames, size_t frame_count)
+    {
+        if (!m_data->initialized || frame_count == 0) return;
+
+        float** buffer = vorbis_analysis_buffer(&m_data->vd, static_cast<int>(frame_count));
+
+        for (uint16_t c = 0; c < m_data->channels; ++c)
+        {
+            float* out = buffer[c];
+            const float* in = pcm_frames + c;
+            for (size_t i = 0; i < frame_count; ++i, in += m_data->channels)
+                out[i] = *in;
+        }
+
+        vorbis_analysis_wrote(&m_data->vd, static_cast<int>(frame_count));
+
+        flush_ogg_pages();
+    }
+
+    void vorbis_encoder::write(const float* const* channels, size_t frame_count)
+    {
+        if (!m_data->initialized || frame_count == 0) return;
+
+        // libvorbis analyses planar float, so this is a straight copy per channel.
+        float** buffer = vorbis_analysis_buffer(&m_data->vd, static_cast<int>(frame_count));
+
+        for (uint16_t c = 0; c < m_data->channels; ++c)
+            std::memcpy(buffer[c], channels[c], frame_count * sizeof(float));
+
+        vorbis_analysis_wrote(&m_data->vd, static_cast<int>(frame_count));
+
+        flush_ogg_pages();
+    }
+
+    void vorbis_encoder::write(const int32_t* const* channels, size_t frame_count)
+    {
+        if (!m_data->initialized || frame_count == 0) return;
+
+        float** buffer = vorbis_analysis_buffer(&m_data->vd, static_cast<int>(frame_count));
+
+        for (uint16_t c = 0; c < m_data->channels; ++c)
+            for (size_t i = 0; i < frame_count; ++i)
+                buffer[c][i] = static_cast<float>(channels[c][i]) / 32768.f;
+
+        vorbis_analysis_wrote(&m_data->vd, static_cast<int>(frame_count));
+
+        flush_ogg_pages();
+    }
+
     void vorbis_encoder::flush_ogg_pages()
     {
         while (vorbis_analysis_blockout(&m_data->vd, &m_data->vb) == 1)
@@ -157,8 +222,8 @@ namespace myro
                     int result = ogg_stream_pageout(&m_data->os, &m_data->og);
                     if (result == 0) break;
                     
-                    m_data->file.write(reinterpret_cast<char*>(m_data->og.header), m_data->og.header_len);
-                    m_data->file.write(reinterpret_cast<char*>(m_data->og.body), m_data->og.body_len);
+                    m_data->sink->write(m_data->og.header, m_data->og.header_len);
+                    m_data->sink->write(m_data->og.body, m_data->og.body_len);
                 }
             }
         }
@@ -178,8 +243,9 @@ namespace myro
         vorbis_comment_clear(&m_data->vc);
         vorbis_info_clear(&m_data->vi);
 
-        if (m_data->file.is_open())
-            m_data->file.close();
+        m_data->sink->flush();
+        m_data->sink->close();
+        m_data->sink = nullptr;
 
         m_data->initialized = false;
     }
@@ -1,24 +1,64 @@
 #include "audio/encoders/wav_encoder.h"
 
-#include "internal/detail.h"
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 
 namespace myro
 {
-    bool wav_encoder::init(const std::filesystem::path& output_filepath, unsigned int sample_rate, unsigned int channels)
+    namespace
     {
-        if (m_out_file)
+        // RIFF header, a 28 byte JUNK chunk that becomes ds64 for RF64, fmt, fact (float only), data.
+        // fmt is 16 bytes for plain PCM, 18 for IEEE float and 40 for WAVE_FORMAT_EXTENSIBLE.
+        constexpr size_t junk_offset = 12;
+        constexpr size_t fmt_offset = 48;
+        constexpr uint32_t unknown_size = 0xFFFFFFFF;
+
+        constexpr uint16_t wave_format_pcm = 1;
+        constexpr uint16_t wave_format_ieee_float = 3;
+        constexpr uint16_t wave_format_extensible = 0xFFFE;
+
+        // KSDATAFORMAT_SUBTYPE_PCM / _IEEE_FLOAT without their first two bytes, which are the format tag.
+        constexpr uint8_t subformat_guid_tail[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+
+        // Speaker positions for the usual layouts (mono .. 7.1), in WAVE channel order.
+        uint32_t default_channel_mask(uint16_t channels)
+        {
+            constexpr uint32_t masks[] = { 0x0, 0x4, 0x3, 0x7, 0x33, 0x37, 0x3F, 0x70F, 0x63F };
+            return channels < std::size(masks) ? masks[channels] : 0;
+        }
+
+        void put_le(uint8_t* at, uint64_t value, size_t bytes)
+        {
+            for (size_t i = 0; i < bytes; ++i)
+                at[i] = static_cast<uint8_t>((value >> (8 * i)) & 0xFF);
+        }
+
+        void put_pcm24(uint8_t* at, int32_t sample)
+        {
+            put_le(at, static_cast<uint32_t>(sample), 3);
+        }
+
+        int32_t float_to_pcm24(float sample)
+        {
+            return static_cast<int32_t>(std::lrint(std::clamp(sample, -1.0f, 1.0f) * 8388607.0f));
+        }
+    }
+
+    bool wav_encoder::init(const std::shared_ptr<IOutputSink>& sink, unsigned int sample_rate, unsigned int channels)
+    {
+        if (m_sink)
         {
             deinit(); 
         }
 
+        if (!sink)
+            return false;
+
         m_sample_rate = sample_rate;
         m_channels = static_cast<uint16_t>(channels);
         m_data_bytes_written = 0;
-
-        m_out_file = detail::open_file(output_filepath, "wb");
-        if (!m_out_file) 
-            return false;
+        m_sink = sink;
 
         write_header_placeholder();
         return true;
@@ -26,45 +66,207 @@ namespace myro
 
     void wav_encoder::deinit()
     {
-        if (!m_out_file) 
+        if (!m_sink) 
             return;
         update_header();
-        detail::fclose_checked(m_out_file);
-        m_out_file = nullptr;
+        m_sink->flush();
+        m_sink->close();
+        m_sink = nullptr;
     }
 
     bool wav_encoder::initialized() const
     {
-        return static_cast<bool>(m_out_file);
+        return static_cast<bool>(m_sink);
+    }
+
+    uint16_t wav_encoder::get_bits_per_sample() const
+    {
+        switch (m_options.format)
+        {
+        case wav_sample_format::pcm24:   return 24;
+        case wav_sample_format::float32: return 32;
+        default:                         return 16;
+        }
     }
 
     void wav_encoder::write(const short* pcm_frames, size_t frame_count)
     {
-        if (!m_out_file) return;
-        size_t bytes_to_write = frame_count * m_channels * (m_bits_per_sample / 8);
-        detail::fwrite_checked(pcm_frames, 1, bytes_to_write, m_out_file);
-        m_data_bytes_written += static_cast<uint32_t>(bytes_to_write);
+        if (!m_sink) return;
+        const size_t count = frame_count * m_channels;
+
+        switch (m_options.format)
+        {
+        case wav_sample_format::pcm16:
+            write_data(pcm_frames, count * sizeof(short));
+            break;
+        case wav_sample_format::pcm24:
+            m_conversion_buffer.resize(count * 3);
+            for (size_t i = 0; i < count; ++i)
+                put_pcm24(m_conversion_buffer.data() + i * 3, static_cast<int32_t>(pcm_frames[i]) * 256);
+            write_data(m_conversion_buffer.data(), m_conversion_buffer.size());
+            break;
+        case wav_sample_format::float32:
+            m_conversion_buffer.resize(count * sizeof(float));
+            for (size_t i = 0; i < count; ++i)
+            {
+                const float sample = static_cast<float>(pcm_frames[i]) / 32768.0f;
+                std::memcpy(m_conversion_buffer.data() + i * sizeof(float), &sample, sizeof(float));
+            }
+            write_data(m_conversion_buffer.data(), m_conversion_buffer.size());
+            break;
+        }
+    }
+
+    void wav_encoder::write(const float* pcm_frames, size_t frame_count)
+    {
+        if (!m_sink) return;
+        const size_t count = frame_count * m_channels;
+
+        switch (m_options.format)
+        {
+        case wav_sample_format::pcm16:
+            IEncoder::write(pcm_frames, frame_count);
+            break;
+        case wav_sample_format::pcm24:
+            m_conversion_buffer.resize(count * 3);
+            for (size_t i = 0; i < count; ++i)
+                put_pcm24(m_conversion_buffer.data() + i * 3, float_to_pcm24(pcm_frames[i]));
+            write_data(m_conversion_buffer.data(), m_conversion_buffer.size());
+            break;
+        case wav_sample_format::float32:
+            write_data(pcm_frames, count * sizeof(float));
+            break;
+        }
+    }
+
+    void wav_encoder::write(const int32_t* const* channels, size_t frame_count)
+    {
+        if (!m_sink) return;
+
+        if (m_options.format != wav_sample_format::pcm24)
+        {
+            IEncoder::write(channels, frame_count);
+            return;
+        }
+
+        m_conversion_buffer.resize(frame_count * m_channels * 3);
+        uint8_t* out = m_conversion_buffer.data();
+        for (size_t i = 0; i < frame_count; ++i)
+            for (size_t c = 0; c < m_channels; ++c, out += 3)
+                put_pcm24(out, std::clamp(channels[c][i], -8388608, 8388607));
+
+        write_data(m_conversion_buffer.data(), m_conversion_buffer.size());
+    }
+
+    void wav_encoder::write_data(const void* bytes, size_t size)
+    {
+        m_sink->write(bytes, size);
+        m_data_bytes_written += size;
     }
 
     void wav_encoder::write_header_placeholder()
 	{
-        std::memcpy(m_header, "RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0\0\0\0\0\0\0\0\0\0\0\x02\0\x10\0data\0\0\0\0", 44);
-        *reinterpret_cast<uint16_t*>(m_header + 22) = m_channels;
-        *reinterpret_cast<uint32_t*>(m_header + 24) = m_sample_rate;
-        *reinterpret_cast<uint32_t*>(m_header + 28) = m_sample_rate * m_channels * (m_bits_per_sample / 8);
-        *reinterpret_cast<uint16_t*>(m_header + 32) = m_channels * (m_bits_per_sample / 8);
-        detail::fwrite_checked(m_header, 1, 44, m_out_file);
+        const uint16_t bits_per_sample = get_bits_per_sample();
+        const uint16_t block_align = m_channels * (bits_per_sample / 8);
+        const bool is_float = m_options.format == wav_sample_format::float32;
+
+        // More than two channels or PCM deeper than 16 bits need WAVE_FORMAT_EXTENSIBLE to be read unambiguously.
+        const bool extensible = m_channels > 2 || (!is_float && bits_per_sample > 16);
+        const uint16_t format_tag = is_float ? wave_format_ieee_float : wave_format_pcm;
+        const size_t fmt_size = extensible ? 40 : (is_float ? 18 : 16);
+
+        // Every non-PCM format needs a fact chunk holding the frame count.
+        m_fact_offset = is_float ? fmt_offset + 8 + fmt_size : 0;
+        m_data_offset = fmt_offset + 8 + fmt_size + (is_float ? 12 : 0);
+        m_header_size = m_data_offset + 8;
+
+        std::memset(m_header, 0, sizeof(m_header));
+        std::memcpy(m_header, "RIFF", 4);
+        std::memcpy(m_header + 8, "WAVE", 4);
+
+        std::memcpy(m_header + junk_offset, "JUNK", 4);
+        put_le(m_header + junk_offset + 4, 28, 4);
+
+        uint8_t* fmt = m_header + fmt_offset;
+        std::memcpy(fmt, "fmt ", 4);
+        put_le(fmt + 4, fmt_size, 4);
+        put_le(fmt + 8, extensible ? wave_format_extensible : format_tag, 2);
+        put_le(fmt + 10, m_channels, 2);
+        put_le(fmt + 12, m_sample_rate, 4);
+        put_le(fmt + 16, static_cast<uint64_t>(m_sample_rate) * block_align, 4);
+        put_le(fmt + 20, block_align, 2);
+        put_le(fmt + 22, bits_per_sample, 2);
+        if (fmt_size > 16)
+            put_le(fmt + 24, fmt_size - 18, 2); // cbSize
+        if (extensible)
+        {
+            put_le(fmt + 26, bits_per_sample, 2); // valid bits
+            put_le(fmt + 28, default_channel_mask(m_channels), 4);
+            put_le(fmt + 32, format_tag, 2);
+            std::memcpy(fmt + 34, subformat_guid_tail, sizeof(subformat_guid_tail));
+        }
+
+        if (m_fact_offset != 0)
+        {
+            std::memcpy(m_header + m_fact_offset, "fact", 4);
+            put_le(m_header + m_fact_offset + 4, 4, 4);
+        }
+
+        std::memcpy(m_header + m_data_offset, "data", 4);
+
+        // Sinks that cannot seek keep the "unknown length" sizes that streaming WAV readers accept.
+        if (!m_sink->can_seek())
+        {
+            put_le(m_header + 4, unknown_size, 4);
+            put_le(m_header + m_data_offset + 4, unknown_size, 4);
+            if (m_fact_offset != 0)
+                put_le(m_header + m_fact_offset + 8, unknown_size, 4);
+        }
+
+        m_sink->write(m_header, m_header_size);
 	}
 
     void wav_encoder::update_header()
     {
-        if (!m_out_file) 
+        if (!m_sink || !m_sink->can_seek()) 
             return;
 
-        uint32_t chunkSize = 36 + m_data_bytes_written;
-        *reinterpret_cast<uint32_t*>(m_header + 4) = chunkSize;
-        *reinterpret_cast<uint32_t*>(m_header + 40) = m_data_bytes_written;
-        detail::fseek_checked(m_out_file, 0, SEEK_SET);
-        detail::fwrite_checked(m_header, 1, 44, m_out_file);
+        // Odd sized chunks are followed by a pad byte that is not part of the chunk size.
+        if (m_data_bytes_written % 2 != 0)
+        {
+            const uint8_t pad = 0;
+            m_sink->write(&pad, 1);
+        }
+
+        const uint64_t block_align = static_cast<uint64_t>(m_channels) * (get_bits_per_sample() / 8);
+        const uint64_t frames = block_align ? m_data_bytes_written / block_align : 0;
+        const uint64_t riff_size = m_header_size - 8 + m_data_bytes_written + m_data_bytes_written % 2;
+        if (riff_size <= unknown_size - 1)
+        {
+            put_le(m_header + 4, riff_size, 4);
+            put_le(m_header + m_data_offset + 4, m_data_bytes_written, 4);
+            if (m_fact_offset != 0)
+                put_le(m_header + m_fact_offset + 8, frames, 4);
+        }
+        else
+        {
+            std::memcpy(m_header, "RF64", 4);
+            put_le(m_header + 4, unknown_size, 4);
+
+            std::memcpy(m_header + junk_offset, "ds64", 4);
+            put_le(m_header + junk_offset + 8, riff_size, 8);
+            put_le(m_header + junk_offset + 16, m_data_bytes_written, 8);
+            put_le(m_header + junk_offset + 24, frames, 8); // the 64-bit fact sample count
+            put_le(m_header + junk_offset + 32, 0, 4); // table length
+
+            put_le(m_header + m_data_offset + 4, unknown_size, 4);
+            if (m_fact_offset != 0)
+                put_le(m_header + m_fact_offset + 8, unknown_size, 4);
+        }
+
+        const uint64_t end = m_sink->tell();
+        m_sink->seek(0);
+        m_sink->write(m_header, m_header_size);
+        m_sink->seek(end);
     }
 }
@@ -0,0 +1,138 @@
+#include "audio/engine_stats.h"
+#include "core/log.h"
+
+#include "internal/detail.h"
+
+#include <sstream>
+#include <system_error>
+
+namespace myro
+{
+	namespace
+	{
+		std::string codec_name(audio_file_format format)
+		{
+			const std::string extension = get_file_extension(format);
+			return extension.empty() ? "unknown" : extension.substr(1);
+		}
+
+		void json_histogram(std::ostringstream& out, const histogram& h)
+		{
+			size_t used = histogram::bucket_count;
+			while (used > 0 && h.buckets[used - 1] == 0)
+				--used;
+
+			out << "{\"count\": " << h.count << ", \"mean\": " << h.mean() << ", \"p50\": " << h.percentile(0.5)
+				<< ", \"p90\": " << h.percentile(0.9) << ", \"p99\": " << h.percentile(0.99) << ", \"max\": " << h.max << ", \"buckets\": [";
+			for (size_t i = 0; i < used; ++i)
+				out << (i > 0 ? ", " : "") << h.buckets[i];
+			out << "]}";
+		}
+
+		void text_histogram(std::ostringstream& out, const char* name, const histogram& h)
+		{
+			out << name << ": count " << h.count << ", mean " << h.mean() << " us, p50 " << h.percentile(0.5)
+				<< " us, p99 " << h.percentile(0.99) << " us, max " << h.max << " us\n";
+		}
+	}
+
+	std::string to_text(const engine_stats& stats)
+	{
+		std::ostringstream out;
+		out << "uptime: " << stats.uptime_seconds << " s\n"
+			<< "loads: " << stats.loads << " (" << stats.loads_per_second << "/s)\n";
+		text_histogram(out, "upload time", stats.upload_time_us);
+
+		for (const codec_stats& codec : stats.codecs)
+		{
+			if (codec.loads == 0 && codec.failures == 0)
+				continue;
+
+			out << codec_name(codec.format) << ": " << codec.loads << " loads, " << codec.failures << " failures, "
+				<< codec.bytes_decoded << " bytes decoded\n";
+			text_histogram(out, "  decode time", codec.decode_time_us);
+		}
+
+		out << "resident pcm: " << stats.resident_pcm_bytes << " bytes\n"
+			<< "retained pcm: " << stats.retained_pcm_bytes << " bytes\n"
+			<< "sources: " << stats.live_sources << " live, " << stats.al_sources << " al, " << stats.tracked_sources << " tracked\n"
+			<< "thread pool: " << stats.pool_threads << " threads, " << stats.pool_queue_depth << " queued\n";
+		text_histogram(out, "task wait", stats.pool_wait_time_us);
+		out << "capture: " << stats.capture_overruns << " overruns, " << stats.capture_dropped_frames << " dropped frames, backlog "
+			<< stats.encoder_backlog_frames << " frames (peak " << stats.peak_encoder_backlog_frames << ")\n";
+
+		return out.str();
+	}
+
+	std::string to_json(const engine_stats& stats)
+	{
+		std::ostringstream out;
+		out << "{\n"
+			<< "  \"uptime_seconds\": " << stats.uptime_seconds << ",\n"
+			<< "  \"loads\": " << stats.loads << ",\n"
+			<< "  \"loads_per_second\": " << stats.loads_per_second << ",\n"
+			<< "  \"upload_time_us\": ";
+		json_histogram(out, stats.upload_time_us);
+
+		out << ",\n  \"codecs\": {";
+		for (size_t i = 0; i < stats.codecs.size(); ++i)
+		{
+			const codec_stats& codec = stats.codecs[i];
+			out << (i > 0 ? "," : "") << "\n    \"" << codec_name(codec.format) << "\": {\"loads\": " << codec.loads
+				<< ", \"failures\": " << codec.failures << ", \"bytes_decoded\": " << codec.bytes_decoded << ", \"decode_time_us\": ";
+			json_histogram(out, codec.decode_time_us);
+			out << "}";
+		}
+
+		out << "\n  },\n"
+			<< "  \"resident_pcm_bytes\": " << stats.resident_pcm_bytes << ",\n"
+			<< "  \"retained_pcm_bytes\": " << stats.retained_pcm_bytes << ",\n"
+			<< "  \"live_sources\": " << stats.live_sources << ",\n"
+			<< "  \"al_sources\": " << stats.al_sources << ",\n"
+			<< "  \"tracked_sources\": " << stats.tracked_sources << ",\n"
+			<< "  \"pool_threads\": " << stats.pool_threads << ",\n"
+			<< "  \"pool_queue_depth\": " << stats.pool_queue_depth << ",\n"
+			<< "  \"pool_wait_time_us\": ";
+		json_histogram(out, stats.pool_wait_time_us);
+		out << ",\n"
+			<< "  \"capture_overruns\": " << stats.capture_overruns << ",\n"
+			<< "  \"capture_dropped_frames\": " << stats.capture_dropped_frames << ",\n"
+			<< "  \"encoder_backlog_frames\": " << stats.encoder_backlog_frames << ",\n"
+			<< "  \"peak_encoder_backlog_frames\": " << stats.peak_encoder_backlog_frames << "\n"
+			<< "}\n";
+
+		return out.str();
+	}
+
+	bool write_stats(const std::filesystem::path& path, const engine_stats& stats, stats_format format)
+	{
+		const std::string text = format == stats_format::json ? to_json(stats) : to_text(stats);
+
+		// Written next to the target and renamed over it, so a reader never sees half a file.
+		std::filesystem::path temp = path;
+		temp += ".tmp";
+
+		FILE* file = detail::open_file(temp, "wb");
+		if (!file)
+		{
+			log::error("Could not write engine stats to {}", temp);
+			return false;
+		}
+
+		const bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+		detail::fclose_checked(file);
+
+		std::error_code error;
+		if (written)
+			std::filesystem::rename(temp, path, error);
+
+		if (!written || error)
+		{
+			log::error("Could not write engine stats to {}", path);
+			std::filesystem::remove(temp, error);
+			return false;
+		}
+
+		return true;
+	}
+}
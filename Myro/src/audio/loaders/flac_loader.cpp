@@ -1,6 +1,7 @@
 #include "audio/loaders/flac_loader.h"
 
 #include "audio/loaders/ogg_loader.h"
+#include "core/trace.h"
 #include "internal/audio_data.h"
 #include "internal/detail.h"
 #include "internal/openal_backend.h"
@@ -88,6 +89,7 @@ namespace myro
 
         raw_buffer decode_flac(const std::filesystem::path& filepath, bool is_ogg)
         {
+            MYRO_TRACE_SCOPE(is_ogg ? "decode ogg flac" : "decode flac");
             std::string debug_name = is_ogg ? "Ogg - FLAC" : "FLAC";
             auto stream_init_func = is_ogg ? FLAC__stream_decoder_init_ogg_stream : FLAC__stream_decoder_init_stream;
 
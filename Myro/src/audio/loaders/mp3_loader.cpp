@@ -1,5 +1,6 @@
 #include "audio/loaders/mp3_loader.h"
 
+#include "core/trace.h"
 #include "internal/openal_backend.h"
 #include "internal/audio_data.h"
 #include "internal/detail.h"
@@ -28,6 +29,7 @@ namespace myro
 
 	raw_buffer mp3_loader::load(const std::filesystem::path& filepath)
 	{
+		MYRO_TRACE_SCOPE("decode mp3");
 		mp3dec_file_info_t info;
 		std::string fname = filepath.string();
 		int load_result = mp3dec_load(&s_data.mp3_decoder, fname.c_str(), &info, nullptr, nullptr);
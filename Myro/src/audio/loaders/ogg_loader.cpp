@@ -3,6 +3,7 @@
 #include "audio/loaders/speex_loader.h"
 #include "audio/loaders/flac_loader.h"
 
+#include "core/trace.h"
 #include "internal/audio_data.h"
 #include "internal/detail.h"
 #include "internal/openal_backend.h"
@@ -13,6 +14,7 @@
 #include <fstream>
 #include <string_view>
 #include <cmath>
+#include <vector>
 
 namespace myro
 {
@@ -48,6 +50,7 @@ namespace myro
     
         raw_buffer load_vorbis(const std::filesystem::path& filepath)
         {
+            MYRO_TRACE_SCOPE("decode vorbis");
             std::string fname = filepath.string();
             FILE* file = fopen(fname.c_str(), "rb");
     
@@ -140,6 +143,7 @@ namespace myro
 
     ogg_codec_type ogg_loader::detect_ogg_codec_robust(const std::filesystem::path& path)
     {
+        MYRO_TRACE_SCOPE("probe ogg");
         std::ifstream file(path, std::ios::binary);
         if (!file)
             return ogg_codec_type::unknown;
@@ -1,5 +1,6 @@
 #include "audio/loaders/opus_loader.h"
 
+#include "core/trace.h"
 #include "internal/audio_data.h"
 #include "internal/detail.h"
 #include "internal/openal_backend.h"
@@ -33,6 +34,7 @@ namespace myro
 
     raw_buffer opus_loader::load_ogg_opus(const std::filesystem::path& filepath)
     {
+        MYRO_TRACE_SCOPE("decode opus");
         std::string fname = filepath.string();
 
         int test_error = 0;
@@ -1,6 +1,7 @@
 #include "audio/loaders/speex_loader.h"
 #include "audio/loaders/ogg_loader.h"
 
+#include "core/trace.h"
 #include "internal/audio_data.h"
 #include "internal/openal_backend.h"
 
@@ -33,6 +34,7 @@ namespace myro
 
     raw_buffer speex_loader::load_ogg_speex(const std::filesystem::path& filepath)
     {
+        MYRO_TRACE_SCOPE("decode speex");
         std::ifstream file(filepath, std::ios::binary);
         if (!file.is_open())
         {
@@ -1,5 +1,6 @@
 #include "audio/loaders/wav_loader.h"
 
+#include "core/trace.h"
 #include "internal/openal_backend.h"
 #include "internal/audio_data.h"
 #include "internal/detail.h"
@@ -22,9 +23,11 @@ namespace myro
 
 	raw_buffer wav_loader::load(const std::filesystem::path& filepath)
 	{
+		MYRO_TRACE_SCOPE("decode wav");
 		std::string fname = filepath.string();
 
-		ma_decoder_config config = ma_decoder_config_init_default();
+		// The buffer below is sized for 16-bit samples, so 24-bit and float files are converted on read.
+		ma_decoder_config config = ma_decoder_config_init(ma_format_s16, 0, 0);
 		ma_decoder decoder;
 
 		ma_result result = ma_decoder_init_file(fname.c_str(), &config, &decoder);
@@ -1,67 +1,259 @@
 #include "core/log.h"
+#include "core/ring_buffer.h"
 
 #include <dtlog.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 namespace myro
 {
-	namespace 
+	namespace
 	{
-		struct
+		constexpr size_t queue_capacity = 64 * 1024;
+		constexpr auto writer_interval = std::chrono::milliseconds(10);
+
+		struct thread_queue
+		{
+			spsc_ring_buffer<uint8_t> ring{ queue_capacity };
+			std::atomic<uint64_t> dropped{ 0 };
+			std::atomic<bool> orphaned{ false };	// the thread has exited; removed once drained
+		};
+
+		// Lives until process exit on purpose: statics destroyed after us may still log.
+		struct log_context
 		{
-			std::mutex mut;
 			dtlog::logger<> logger{ "Myro Log", "[%T - %D] %N: %V\n" };
-			uint8_t active_log_levels;
-		}g_logger_context;
+
+			std::mutex registry_mutex;
+			std::vector<std::shared_ptr<thread_queue>> queues;
+
+			// Serializes draining and writing between the writer thread, flush() and critical().
+			std::mutex write_mutex;
+			std::vector<uint8_t> batch;
+			std::vector<std::pair<int64_t, size_t>> order;	// timestamp, offset into batch
+			uint64_t dropped_total = 0;
+
+			std::thread writer;
+			std::mutex wake_mutex;
+			std::condition_variable wake;
+			bool stopping = false;
+			std::atomic<bool> stopped{ false };
+
+			void emit(uint8_t level, std::string_view message)
+			{
+				// dtlog only takes std::string; short messages stay in its small buffer.
+				const std::string text(message);
+
+				switch (level)
+				{
+				case log::level_trace:		logger.trace(text); break;
+				case log::level_info:		logger.info(text); break;
+				case log::level_debug:		logger.debug(text); break;
+				case log::level_warn:		logger.warning(text); break;
+				case log::level_error:		logger.error(text); break;
+				case log::level_critical:	logger.critical(text); break;
+				default: break;
+				}
+			}
+
+			// Caller holds write_mutex.
+			void drain()
+			{
+				std::vector<std::shared_ptr<thread_queue>> snapshot;
+				{
+					std::scoped_lock lock(registry_mutex);
+					snapshot = queues;
+				}
+
+				batch.clear();
+				order.clear();
+				uint64_t dropped = 0;
+				for (const auto& queue : snapshot)
+				{
+					dropped += queue->dropped.exchange(0, std::memory_order_relaxed);
+
+					// Records are written whole, so a visible header means its payload is there too.
+					while (queue->ring.size() >= sizeof(log_record))
+					{
+						const size_t offset = batch.size();
+						batch.resize(offset + sizeof(log_record));
+						queue->ring.read(batch.data() + offset, sizeof(log_record));
+
+						log_record record;
+						std::memcpy(&record, batch.data() + offset, sizeof(log_record));
+						batch.resize(offset + sizeof(log_record) + record.payload_size);
+						queue->ring.read(batch.data() + offset + sizeof(log_record), record.payload_size);
+						order.emplace_back(record.timestamp, offset);
+					}
+				}
+
+				// Each thread's records are in order already; interleave the threads by time.
+				std::ranges::stable_sort(order, {}, &std::pair<int64_t, size_t>::first);
+				for (const auto& [timestamp, offset] : order)
+				{
+					log_record record;
+					std::memcpy(&record, batch.data() + offset, sizeof(log_record));
+
+					format_buffer text;
+					record.decode(batch.data() + offset + sizeof(log_record), { record.format, record.format_size }, text);
+					emit(record.level, text.view());
+				}
+
+				if (dropped > 0)
+				{
+					dropped_total += dropped;
+					format_buffer text;
+					formatter::format_to(text, "{} log messages were dropped because a log queue was full.", dropped);
+					emit(log::level_warn, text.view());
+				}
+
+				std::scoped_lock lock(registry_mutex);
+				std::erase_if(queues, [](const std::shared_ptr<thread_queue>& queue)
+					{
+						return queue->orphaned.load(std::memory_order_acquire) && queue->ring.size() == 0;
+					});
+			}
+
+			void writer_loop()
+			{
+				std::unique_lock lock(wake_mutex);
+				while (!stopping)
+				{
+					wake.wait_for(lock, writer_interval);
+					lock.unlock();
+					{
+						std::scoped_lock write_lock(write_mutex);
+						drain();
+					}
+					lock.lock();
+				}
+			}
+
+			std::shared_ptr<thread_queue> register_queue()
+			{
+				auto queue = std::make_shared<thread_queue>();
+
+				std::scoped_lock lock(registry_mutex);
+				queues.push_back(queue);
+				if (!writer.joinable() && !stopped.load(std::memory_order_relaxed))
+					writer = std::thread([this]() { writer_loop(); });
+
+				return queue;
+			}
+
+			void stop()
+			{
+				{
+					std::scoped_lock lock(wake_mutex);
+					stopping = true;
+				}
+				wake.notify_one();
+
+				std::thread thread;
+				{
+					std::scoped_lock lock(registry_mutex);
+					stopped.store(true, std::memory_order_relaxed);
+					thread = std::move(writer);
+				}
+				if (thread.joinable())
+					thread.join();
+
+				std::scoped_lock write_lock(write_mutex);
+				drain();
+			}
+		};
+
+		log_context& context()
+		{
+			static log_context* ctx = new log_context();
+			return *ctx;
+		}
+
+		// Writes out what is still queued when the process exits normally.
+		struct log_shutdown
+		{
+			log_shutdown() { context(); }
+			~log_shutdown() { context().stop(); }
+		} g_log_shutdown;
+
+		struct thread_queue_handle
+		{
+			thread_queue_handle() : queue(context().register_queue()) {}
+			~thread_queue_handle() { queue->orphaned.store(true, std::memory_order_release); }
+
+			thread_queue_handle(const thread_queue_handle&) = delete;
+			thread_queue_handle& operator=(const thread_queue_handle&) = delete;
+
+			std::shared_ptr<thread_queue> queue;
+		};
+
+		thread_queue& this_thread_queue()
+		{
+			thread_local thread_queue_handle handle;
+			return *handle.queue;
+		}
 	}
 
 	void log::set_logger_activity(uint8_t active_log_levels)
 	{
-		std::lock_guard<std::mutex> lock(g_logger_context.mut);
-		g_logger_context.active_log_levels = active_log_levels;
+		s_active_log_levels.store(active_log_levels, std::memory_order_relaxed);
 	}
 
-	bool log::is_logger_active(level_ level)
+	void log::prepare_thread()
 	{
-		std::lock_guard<std::mutex> lock(g_logger_context.mut);
-		return g_logger_context.active_log_levels & static_cast<uint8_t>(level);
+		this_thread_queue();
 	}
 
-	void log::_trace(const std::string& message)
+	void log::flush()
 	{
-		if (!is_logger_active(level_trace)) return;
-		g_logger_context.logger.trace(message);
+		log_context& ctx = context();
+		std::scoped_lock lock(ctx.write_mutex);
+		ctx.drain();
 	}
 
-	void log::_info(const std::string& message)
+	uint64_t log::get_dropped_count()
 	{
-		if (!is_logger_active(level_info)) return;
-		g_logger_context.logger.info(message);
+		log_context& ctx = context();
+		std::scoped_lock lock(ctx.write_mutex);
+		return ctx.dropped_total;
 	}
 
-	void log::_debug(const std::string& message)
+	void log::enqueue(log_record& record, uint8_t* staging, size_t size)
 	{
-		if (!is_logger_active(level_debug)) return;
-		g_logger_context.logger.debug(message);
-	}
+		record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		std::memcpy(staging, &record, sizeof(log_record));
 
-	void log::_warn(const std::string& message)
-	{
-		if (!is_logger_active(level_warn)) return;
-		g_logger_context.logger.warning(message);
-	}
+		log_context& ctx = context();
+		if (ctx.stopped.load(std::memory_order_relaxed))
+		{
+			// No writer thread any more (process exit): format in place.
+			format_buffer text;
+			record.decode(staging + sizeof(log_record), { record.format, record.format_size }, text);
+			write_now(static_cast<level_>(record.level), text.view());
+			return;
+		}
 
-	void log::_error(const std::string& message)
-	{
-		if (!is_logger_active(level_error)) return;
-		g_logger_context.logger.error(message);
+		thread_queue& queue = this_thread_queue();
+		if (queue.ring.write_available() < size)
+		{
+			queue.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		queue.ring.write(staging, size);
 	}
 
-	void log::_critical(const std::string& message)
+	void log::write_now(level_ level, std::string_view message)
 	{
-		if (!is_logger_active(level_critical)) return;
-		g_logger_context.logger.critical(message);
+		log_context& ctx = context();
+		std::scoped_lock lock(ctx.write_mutex);
+		ctx.drain();
+		ctx.emit(static_cast<uint8_t>(level), message);
 	}
-
-}
\ No newline at end of file
+}
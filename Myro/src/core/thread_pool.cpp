@@ -0,0 +1,44 @@
+#include "core/thread_pool.h"
+#include "core/trace.h"
+
+void thread_pool::worker_loop()
+{
+    MYRO_TRACE_THREAD_NAME("myro pool");
+
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_queue_mutex);
+            m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+
+            if (m_stop && m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front().run);
+            const clock::time_point enqueued = m_tasks.front().enqueued;
+            const clock::time_point started = clock::now();
+            m_wait_times.record(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(started - enqueued).count()));
+#ifdef MYRO_ENABLE_TRACING
+            if (myro::trace::is_recording())
+            {
+                const auto ns = [](clock::time_point t) { return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count(); };
+                myro::trace::record("pool queue wait", ns(enqueued), ns(started));
+            }
+#endif
+            m_tasks.pop();
+            m_queue_depth.store(m_tasks.size(), std::memory_order_relaxed);
+        }
+
+        try
+        {
+            MYRO_TRACE_SCOPE("pool task");
+            task();
+        }
+        catch (thread_stop)
+        {
+            return;
+        }
+    }
+}
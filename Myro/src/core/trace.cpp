@@ -0,0 +1,268 @@
+#include "core/trace.h"
+#include "core/log.h"
+#include "core/ring_buffer.h"
+
+#include "internal/detail.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace myro
+{
+	namespace
+	{
+		constexpr size_t events_per_thread = 16 * 1024;
+
+		struct trace_event
+		{
+			const char* name;
+			int64_t start;
+			int64_t duration;
+		};
+
+		struct thread_events
+		{
+			spsc_ring_buffer<trace_event> ring{ events_per_thread };
+			uint32_t tid = 0;
+			std::atomic<const char*> name{ nullptr };
+			std::atomic<uint64_t> dropped{ 0 };
+			std::atomic<bool> orphaned{ false };	// the thread has exited; removed once collected
+		};
+
+		struct collected_event
+		{
+			trace_event event;
+			uint32_t tid;
+		};
+
+		// Leaked for the same reason as the log context: thread_local handles may outlive statics.
+		struct trace_context
+		{
+			std::mutex registry_mutex;
+			std::vector<std::shared_ptr<thread_events>> threads;
+			uint32_t next_tid = 1;
+
+			// Guards the session: collected events, thread names and the origin.
+			std::mutex session_mutex;
+			std::vector<collected_event> events;
+			std::vector<std::pair<uint32_t, const char*>> thread_names;
+			int64_t origin = 0;
+			uint64_t dropped_total = 0;
+
+			std::shared_ptr<thread_events> register_thread()
+			{
+				auto events = std::make_shared<thread_events>();
+
+				std::scoped_lock lock(registry_mutex);
+				events->tid = next_tid++;
+				threads.push_back(events);
+				return events;
+			}
+
+			// Caller holds session_mutex.
+			void collect()
+			{
+				std::vector<std::shared_ptr<thread_events>> snapshot;
+				{
+					std::scoped_lock lock(registry_mutex);
+					snapshot = threads;
+				}
+
+				for (const auto& thread : snapshot)
+				{
+					dropped_total += thread->dropped.exchange(0, std::memory_order_relaxed);
+
+					if (const char* name = thread->name.load(std::memory_order_relaxed))
+					{
+						auto it = std::ranges::find(thread_names, thread->tid, &std::pair<uint32_t, const char*>::first);
+						if (it == thread_names.end())
+							thread_names.emplace_back(thread->tid, name);
+						else
+							it->second = name;
+					}
+
+					thread->ring.read(thread->ring.size(), [&](const trace_event* data, size_t count)
+						{
+							for (size_t i = 0; i < count; ++i)
+								events.push_back({ data[i], thread->tid });
+						});
+				}
+
+				std::scoped_lock lock(registry_mutex);
+				std::erase_if(threads, [](const std::shared_ptr<thread_events>& thread)
+					{
+						return thread->orphaned.load(std::memory_order_acquire) && thread->ring.size() == 0;
+					});
+			}
+		};
+
+		trace_context& context()
+		{
+			static trace_context* ctx = new trace_context();
+			return *ctx;
+		}
+
+		struct thread_events_handle
+		{
+			thread_events_handle() : events(context().register_thread()) {}
+			~thread_events_handle() { events->orphaned.store(true, std::memory_order_release); }
+
+			thread_events_handle(const thread_events_handle&) = delete;
+			thread_events_handle& operator=(const thread_events_handle&) = delete;
+
+			std::shared_ptr<thread_events> events;
+		};
+
+		thread_events& this_thread_events()
+		{
+			thread_local thread_events_handle handle;
+			return *handle.events;
+		}
+
+		void append_json_string(std::string& out, const char* text)
+		{
+			out += '"';
+			for (; *text; ++text)
+			{
+				if (*text == '"' || *text == '\\')
+					out += '\\';
+				if (static_cast<unsigned char>(*text) >= 0x20)
+					out += *text;
+			}
+			out += '"';
+		}
+
+		// Microseconds with nanosecond digits, which is what the trace viewers expect.
+		void append_micros(std::string& out, int64_t ns)
+		{
+			ns = std::max<int64_t>(ns, 0);
+			const int64_t fraction = ns % 1000;
+			out += std::to_string(ns / 1000);
+			out += '.';
+			out += static_cast<char>('0' + fraction / 100);
+			out += static_cast<char>('0' + fraction / 10 % 10);
+			out += static_cast<char>('0' + fraction % 10);
+		}
+	}
+
+	void trace::start()
+	{
+		trace_context& ctx = context();
+		{
+			std::scoped_lock lock(ctx.session_mutex);
+			ctx.collect();
+			ctx.events.clear();
+			ctx.origin = now();
+		}
+		s_recording.store(true, std::memory_order_relaxed);
+	}
+
+	void trace::stop()
+	{
+		s_recording.store(false, std::memory_order_relaxed);
+	}
+
+	void trace::collect()
+	{
+		trace_context& ctx = context();
+		std::scoped_lock lock(ctx.session_mutex);
+		ctx.collect();
+	}
+
+	void trace::clear()
+	{
+		trace_context& ctx = context();
+		std::scoped_lock lock(ctx.session_mutex);
+		ctx.collect();
+		ctx.events.clear();
+		ctx.dropped_total = 0;
+	}
+
+	uint64_t trace::get_dropped_count()
+	{
+		trace_context& ctx = context();
+		std::scoped_lock lock(ctx.session_mutex);
+		ctx.collect();
+		return ctx.dropped_total;
+	}
+
+	void trace::prepare_thread()
+	{
+		this_thread_events();
+	}
+
+	void trace::set_thread_name(const char* name)
+	{
+		this_thread_events().name.store(name, std::memory_order_relaxed);
+	}
+
+	int64_t trace::now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void trace::record(const char* name, int64_t start_ns, int64_t end_ns)
+	{
+		thread_events& events = this_thread_events();
+		const trace_event event{ name, start_ns, end_ns - start_ns };
+		if (events.ring.write(&event, 1) == 0)
+			events.dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	bool trace::write_chrome_trace(const std::filesystem::path& path)
+	{
+		std::string out;
+		{
+			trace_context& ctx = context();
+			std::scoped_lock lock(ctx.session_mutex);
+			ctx.collect();
+
+			std::ranges::stable_sort(ctx.events, {}, [](const collected_event& e) { return e.event.start; });
+			out.reserve(128 + ctx.events.size() * 96);
+			out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+			bool first = true;
+			for (const auto& [tid, name] : ctx.thread_names)
+			{
+				out += first ? "" : ",\n";
+				first = false;
+				out += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + std::to_string(tid) + ",\"args\":{\"name\":";
+				append_json_string(out, name);
+				out += "}}";
+			}
+
+			for (const collected_event& e : ctx.events)
+			{
+				out += first ? "" : ",\n";
+				first = false;
+				out += "{\"ph\":\"X\",\"cat\":\"myro\",\"name\":";
+				append_json_string(out, e.event.name);
+				out += ",\"pid\":1,\"tid\":" + std::to_string(e.tid) + ",\"ts\":";
+				append_micros(out, e.event.start - ctx.origin);
+				out += ",\"dur\":";
+				append_micros(out, e.event.duration);
+				out += '}';
+			}
+
+			out += "\n]}\n";
+		}
+
+		FILE* file = detail::open_file(path, "wb");
+		if (!file)
+		{
+			log::error("Could not write the trace to {}", path);
+			return false;
+		}
+
+		const bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+		detail::fclose_checked(file);
+		if (!written)
+			log::error("Could not write the trace to {}", path);
+
+		return written;
+	}
+}
@@ -0,0 +1,164 @@
+#include "convolver.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace myro
+{
+	void partitioned_convolver::reset(const float* impulse_response, size_t length, size_t block_size, size_t max_partition)
+	{
+		m_block_size = block_size;
+		m_levels.clear();
+
+		size_t offset = 0;
+		size_t partition = block_size;
+		while (offset < length)
+		{
+			// The next level may start once the response reaches twice its partition size: one partition
+			// to fill, one to spread the work over while the result is not due yet.
+			const size_t next = std::max(std::min(partition * 8, max_partition), partition);
+			const size_t end = next > partition ? std::min(2 * next, length) : length;
+
+			level& l = m_levels.emplace_back();
+			l.partition = partition;
+			l.blocks = partition / block_size;
+			l.offset = offset;
+			l.count = (end - offset + partition - 1) / partition;
+			l.fft.reset(2 * partition);
+
+			const size_t bins = partition + 1;
+			l.filter_re.resize(l.count * bins);
+			l.filter_im.resize(l.count * bins);
+			std::vector<float> segment(2 * partition);
+			for (size_t p = 0; p < l.count; ++p)
+			{
+				const size_t first = offset + p * partition;
+				const size_t taps = std::min(partition, length - std::min(first, length));
+				std::fill(segment.begin(), segment.end(), 0.0f);
+				std::copy_n(impulse_response + first, taps, segment.begin());
+				l.fft.forward(segment.data(), l.filter_re.data() + p * bins, l.filter_im.data() + p * bins);
+			}
+
+			l.delay_re.resize(l.count * bins);
+			l.delay_im.resize(l.count * bins);
+			l.input.resize(2 * partition);
+			l.acc_re.resize(bins);
+			l.acc_im.resize(bins);
+			l.time.resize(2 * partition);
+
+			offset = end;
+			partition = next;
+		}
+
+		// A level writes up to offset + block_size frames ahead of the current block.
+		size_t reach = block_size;
+		for (const level& l : m_levels)
+			reach = std::max(reach, l.offset + block_size);
+		m_tail.resize(std::bit_ceil(reach));
+
+		clear();
+	}
+
+	void partitioned_convolver::clear()
+	{
+		for (level& l : m_levels)
+		{
+			std::ranges::fill(l.delay_re, 0.0f);
+			std::ranges::fill(l.delay_im, 0.0f);
+			std::ranges::fill(l.input, 0.0f);
+			l.delay_pos = 0;
+			l.fill = 0;
+			l.step = 0;
+			l.done = 0;
+			l.busy = false;
+		}
+		std::ranges::fill(m_tail, 0.0f);
+		m_tail_pos = 0;
+	}
+
+	void partitioned_convolver::run_unit(level& l, size_t unit)
+	{
+		const size_t bins = l.partition + 1;
+		if (unit == 0)
+		{
+			// Newest spectrum goes in front of the oldest; partition p of the filter meets the input p partitions ago.
+			l.delay_pos = (l.delay_pos + l.count - 1) % l.count;
+			l.fft.forward(l.input.data(), l.delay_re.data() + l.delay_pos * bins, l.delay_im.data() + l.delay_pos * bins);
+			std::ranges::fill(l.acc_re, 0.0f);
+			std::ranges::fill(l.acc_im, 0.0f);
+
+			std::copy_n(l.input.data() + l.partition, l.partition, l.input.data());
+			l.fill = 0;
+		}
+		else if (unit <= l.count)
+		{
+			const size_t p = unit - 1;
+			const size_t slot = (l.delay_pos + p) % l.count;
+			simd::complex_multiply_add(l.delay_re.data() + slot * bins, l.delay_im.data() + slot * bins,
+				l.filter_re.data() + p * bins, l.filter_im.data() + p * bins, l.acc_re.data(), l.acc_im.data(), bins);
+		}
+		else
+		{
+			// Overlap-save: the second half of the circular result is the linear convolution.
+			l.fft.inverse(l.acc_re.data(), l.acc_im.data(), l.time.data());
+
+			const size_t mask = m_tail.size() - 1;
+			size_t pos = l.due;
+			for (size_t j = 0; j < l.partition;)
+			{
+				const size_t n = std::min(l.partition - j, m_tail.size() - pos);
+				simd::add(l.time.data() + l.partition + j, m_tail.data() + pos, n);
+				j += n;
+				pos = (pos + n) & mask;
+			}
+		}
+	}
+
+	void partitioned_convolver::process(const float* in, float* out)
+	{
+		if (m_levels.empty())
+		{
+			std::fill_n(out, m_block_size, 0.0f);
+			return;
+		}
+
+		const size_t mask = m_tail.size() - 1;
+		for (level& l : m_levels)
+		{
+			std::copy_n(in, m_block_size, l.input.data() + l.partition + l.fill);
+			l.fill += m_block_size;
+		}
+
+		for (level& l : m_levels)
+		{
+			// The partition that just ended is due offset - partition frames after this block; the head
+			// level's is due now. The forward FFT runs right away, the multiplies and the inverse FFT
+			// are spread evenly over the blocks until the next partition ends.
+			if (l.fill == l.partition)
+			{
+				l.busy = true;
+				l.step = 0;
+				l.done = 0;
+				l.due = (m_tail_pos + m_block_size + l.offset - l.partition) & mask;
+			}
+
+			if (!l.busy)
+				continue;
+
+			const size_t units = l.count + 2;
+			const size_t target = std::min((units * (l.step + 1) + l.blocks - 1) / l.blocks, units);
+			while (l.done < target)
+				run_unit(l, l.done++);
+			l.busy = ++l.step < l.blocks;
+		}
+
+		for (size_t j = 0; j < m_block_size; ++j)
+		{
+			float& tail = m_tail[(m_tail_pos + j) & mask];
+			out[j] = tail;
+			tail = 0.0f;
+		}
+		m_tail_pos = (m_tail_pos + m_block_size) & mask;
+	}
+}
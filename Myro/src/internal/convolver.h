@@ -0,0 +1,63 @@
+#pragma once
+
+#include "fft.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace myro
+{
+	// Non-uniformly partitioned overlap-save FFT convolution of a mono signal with a fixed impulse
+	// response. The head of the response uses partitions of block_size, so the output has no latency
+	// beyond the block; later parts use partitions eight times larger per level (up to max_partition),
+	// which cuts the per-sample cost of long responses. Each level is a uniformly partitioned
+	// convolution with a frequency-domain delay line. A level starts no earlier in the response than
+	// twice its partition size, so after its forward FFT the spectral multiplies and the inverse FFT
+	// can be spread over the blocks of the next partition and still land before they are due; a large
+	// partition then costs a little every block instead of a spike every few.
+	class partitioned_convolver
+	{
+	public:
+		// block_size and max_partition must be powers of two.
+		void reset(const float* impulse_response, size_t length, size_t block_size, size_t max_partition);
+		// Clears the signal history, keeps the response.
+		void clear();
+
+		// Exactly block_size() frames. out may alias in.
+		void process(const float* in, float* out);
+
+		[[nodiscard]] size_t block_size() const { return m_block_size; }
+		[[nodiscard]] size_t level_count() const { return m_levels.size(); }
+	private:
+		struct level
+		{
+			size_t partition = 0;
+			size_t blocks = 0;			// partition / block_size
+			size_t offset = 0;			// first response tap this level covers
+			size_t count = 0;			// partitions
+			real_fft fft;				// 2 * partition points
+			std::vector<float> filter_re, filter_im;	// count spectra of partition + 1 bins
+			std::vector<float> delay_re, delay_im;		// the last count input spectra, a ring
+			size_t delay_pos = 0;
+			std::vector<float> input;	// previous and current partition of input
+			size_t fill = 0;			// frames of the current partition
+			std::vector<float> acc_re, acc_im;
+			std::vector<float> time;
+
+			// The convolution in flight: count + 2 units (forward FFT, one multiply per partition,
+			// inverse FFT into the tail at due) spread over blocks steps.
+			bool busy = false;
+			size_t step = 0;
+			size_t done = 0;
+			size_t due = 0;
+		};
+
+		void run_unit(level& l, size_t unit);
+
+		size_t m_block_size = 0;
+		std::vector<level> m_levels;
+		// Output of the levels, indexed by frame time modulo its size.
+		std::vector<float> m_tail;
+		size_t m_tail_pos = 0;
+	};
+}
@@ -6,6 +6,12 @@
 #include <cerrno>
 #include <system_error>
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace myro::detail
 {
 	void display_file_info(const std::string& filename, int64_t channels, int64_t sample_rate, uint64_t size)
@@ -63,7 +69,8 @@ namespace myro::detail
         return fopen(ansi_path.c_str(), mode);
     #endif // defined(_MSC_VER) || defined(__MINGW64__) || !defined(__STRICT_ANSI__)
 #else // defined(_WIN32)
-        std::string utf8_path(path.u8string().begin(), path.u8string().end());
+        const std::u8string u8_path = path.u8string();
+        std::string utf8_path(u8_path.begin(), u8_path.end());
         return fopen(utf8_path.c_str(), mode);
 #endif // defined(_WIN32)
     }
@@ -77,9 +84,15 @@ namespace myro::detail
         }
     }
     
-    void fseek_checked(FILE* stream, long offset, int origin)
+    bool fseek_checked(FILE* stream, int64_t offset, int origin)
     {
-        if (std::fseek(stream, offset, origin) != 0)
+        // 64-bit offsets: RF64 recordings seek back to their header from well past 4 GB.
+#ifdef _WIN32
+        const int result = _fseeki64(stream, offset, origin);
+#else
+        const int result = fseeko(stream, static_cast<off_t>(offset), origin);
+#endif
+        if (result != 0)
         {
             std::error_code ec(errno, std::system_category());
             
@@ -89,7 +102,10 @@ namespace myro::detail
     
             log::error("Failed to seek file (offset: {}, origin: {}). Reason: {}", 
                              offset, origin_str, ec.message());
+            return false;
         }
+
+        return true;
     }
     
     void fwrite_checked(void const* buf, size_t elem_size, size_t elem_count, FILE* stream)
@@ -102,4 +118,20 @@ namespace myro::detail
             log::error("Failed to write to file. Expected {} elements, wrote {}. Reason: {}",  elem_count, written, ec.message());
         }
     }
+
+    bool sync_file(FILE* stream)
+    {
+#ifdef _WIN32
+        const bool synced = std::fflush(stream) == 0 && _commit(_fileno(stream)) == 0;
+#else
+        const bool synced = std::fflush(stream) == 0 && fsync(fileno(stream)) == 0;
+#endif
+        if (!synced)
+        {
+            std::error_code ec(errno, std::system_category());
+            log::error("Failed to sync file to disk. Reason: {}", ec.message());
+        }
+
+        return synced;
+    }
 }
@@ -11,7 +11,9 @@ namespace myro
 		void display_file_info(const std::string& filename, int64_t channels, int64_t sample_rate, uint64_t size);
 		FILE* open_file(const std::filesystem::path& path, const char* mode);
 		void fclose_checked(FILE* stream);
-		void fseek_checked(FILE* stream, long offset, int origin);
+		bool fseek_checked(FILE* stream, int64_t offset, int origin);
 		void fwrite_checked(void const* buf, size_t elem_size, size_t elem_count, FILE* stream);
+		// fflush, then fsync (_commit on Windows): the data is on the disk, not just in the OS cache.
+		bool sync_file(FILE* stream);
 	}
 }
\ No newline at end of file
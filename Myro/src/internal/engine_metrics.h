@@ -0,0 +1,46 @@
+#pragma once
+
+#include "audio/audio_file_format.h"
+#include "core/histogram.h"
+
+#include <array>
+#include <atomic>
+#include <bit>
+
+namespace myro
+{
+	// Process wide counters behind audio_engine::get_stats(). Everything is a relaxed atomic,
+	// so loader threads and the capture callback update them without locking.
+	struct engine_metrics
+	{
+		struct codec
+		{
+			std::atomic<uint64_t> loads{ 0 };
+			std::atomic<uint64_t> failures{ 0 };
+			std::atomic<uint64_t> bytes_decoded{ 0 };
+			atomic_histogram decode_time_us;
+		};
+
+		std::array<codec, 6> codecs;
+		atomic_histogram upload_time_us;
+		std::atomic<uint64_t> loads{ 0 };
+
+		std::atomic<int64_t> resident_pcm_bytes{ 0 };
+		std::atomic<int64_t> retained_pcm_bytes{ 0 };
+		std::atomic<int64_t> live_sources{ 0 };
+		std::atomic<int64_t> al_sources{ 0 };
+
+		std::atomic<uint64_t> capture_overruns{ 0 };
+		std::atomic<uint64_t> capture_dropped_frames{ 0 };
+		std::atomic<int64_t> encoder_backlog_frames{ 0 };
+		std::atomic<uint64_t> peak_encoder_backlog_frames{ 0 };
+
+		static engine_metrics& get();
+
+		// ogg .. spx map to 0 .. 5, the order of engine_stats::codecs.
+		static size_t codec_index(audio_file_format format)
+		{
+			return static_cast<size_t>(std::countr_zero(static_cast<unsigned>(format))) - 1;
+		}
+	};
+}
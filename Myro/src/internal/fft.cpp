@@ -0,0 +1,112 @@
+#include "fft.h"
+#include "simd.h"
+
+#include <numbers>
+
+namespace myro
+{
+	void real_fft::reset(size_t size)
+	{
+		m_size = size;
+		const size_t half = size / 2;
+
+		size_t bits = 0;
+		while ((static_cast<size_t>(1) << bits) < half)
+			++bits;
+
+		m_bit_reverse.resize(half);
+		for (size_t i = 0; i < half; ++i)
+		{
+			size_t reversed = 0;
+			for (size_t b = 0; b < bits; ++b)
+				reversed |= ((i >> b) & 1) << (bits - 1 - b);
+			m_bit_reverse[i] = reversed;
+		}
+
+		m_twiddles.resize(half / 2);
+		for (size_t k = 0; k < m_twiddles.size(); ++k)
+			m_twiddles[k] = std::polar(1.0f, static_cast<float>(-2.0 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(half)));
+
+		m_split_twiddles.resize(half + 1);
+		for (size_t k = 0; k <= half; ++k)
+			m_split_twiddles[k] = std::polar(1.0f, static_cast<float>(-2.0 * std::numbers::pi * static_cast<double>(k) / static_cast<double>(size)));
+
+		m_work.resize(half);
+		m_re.resize(half + 1);
+		m_im.resize(half + 1);
+	}
+
+	void real_fft::power_spectrum(const float* input, float* power)
+	{
+		forward(input, m_re.data(), m_im.data());
+		simd::power(m_re.data(), m_im.data(), power, m_size / 2 + 1);
+	}
+
+	void real_fft::forward(const float* input, float* re, float* im)
+	{
+		const size_t half = m_size / 2;
+
+		// Even samples become the real part, odd samples the imaginary part.
+		for (size_t i = 0; i < half; ++i)
+			m_work[m_bit_reverse[i]] = { input[2 * i], input[2 * i + 1] };
+
+		transform();
+
+		// X[k] = (Z[k] + conj(Z[N/2-k])) / 2 - i * W^k * (Z[k] - conj(Z[N/2-k])) / 2
+		for (size_t k = 0; k <= half; ++k)
+		{
+			const std::complex<float> z = m_work[k == half ? 0 : k];
+			const std::complex<float> zc = std::conj(m_work[k == 0 ? 0 : half - k]);
+			const std::complex<float> even = (z + zc) * 0.5f;
+			const std::complex<float> odd = (z - zc) * std::complex<float>(0.0f, -0.5f);
+			const std::complex<float> x = even + m_split_twiddles[k] * odd;
+			re[k] = x.real();
+			im[k] = x.imag();
+		}
+	}
+
+	void real_fft::inverse(const float* re, const float* im, float* output)
+	{
+		const size_t half = m_size / 2;
+		const float scale = 1.0f / static_cast<float>(half);
+
+		// Undo the split: E[k] = (X[k] + conj(X[N/2-k])) / 2, O[k] = (X[k] - conj(X[N/2-k])) / (2 W^k),
+		// then Z[k] = E[k] + i O[k]. The inverse transform runs forward on the conjugate.
+		for (size_t k = 0; k < half; ++k)
+		{
+			const std::complex<float> x(re[k], im[k]);
+			const std::complex<float> xc(re[half - k], -im[half - k]);
+			const std::complex<float> even = (x + xc) * 0.5f;
+			const std::complex<float> odd = (x - xc) * 0.5f * std::conj(m_split_twiddles[k]);
+			m_work[m_bit_reverse[k]] = std::conj(even + std::complex<float>(0.0f, 1.0f) * odd);
+		}
+
+		transform();
+
+		for (size_t i = 0; i < half; ++i)
+		{
+			output[2 * i] = m_work[i].real() * scale;
+			output[2 * i + 1] = -m_work[i].imag() * scale;
+		}
+	}
+
+	void real_fft::transform()
+	{
+		const size_t half = m_size / 2;
+		for (size_t length = 2; length <= half; length <<= 1)
+		{
+			const size_t step = half / length;
+			const size_t span = length / 2;
+			for (size_t start = 0; start < half; start += length)
+			{
+				for (size_t k = 0; k < span; ++k)
+				{
+					const std::complex<float> t = m_twiddles[k * step] * m_work[start + k + span];
+					const std::complex<float> u = m_work[start + k];
+					m_work[start + k] = u + t;
+					m_work[start + k + span] = u - t;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace myro
+{
+	// Real-input radix-2 FFT. A size N transform runs as an N/2 point complex FFT plus a split pass,
+	// with the twiddles and bit-reversal table computed once in reset().
+	class real_fft
+	{
+	public:
+		// size must be a power of two, at least 4.
+		void reset(size_t size);
+
+		[[nodiscard]] size_t size() const { return m_size; }
+		[[nodiscard]] size_t bin_count() const { return m_size / 2 + 1; }
+
+		// Writes bin_count() bins of |X[k]|^2 for size() real input samples.
+		void power_spectrum(const float* input, float* power);
+
+		// bin_count() bins, real and imaginary parts in separate arrays.
+		void forward(const float* input, float* re, float* im);
+		// Scaled so that inverse(forward(x)) == x. Writes size() samples.
+		void inverse(const float* re, const float* im, float* output);
+	private:
+		// In place N/2 point FFT of m_work, input in bit-reversed order.
+		void transform();
+
+		size_t m_size = 0;
+		std::vector<size_t> m_bit_reverse;
+		std::vector<std::complex<float>> m_twiddles;       // e^(-2*pi*i*k/(N/2)), k < N/4
+		std::vector<std::complex<float>> m_split_twiddles; // e^(-2*pi*i*k/N), k <= N/2
+		std::vector<std::complex<float>> m_work;
+		std::vector<float> m_re;
+		std::vector<float> m_im;
+	};
+}
@@ -8,6 +8,7 @@
 #endif // _MSC_VER
 
 #include <AL/alext.h>
+#include <AL/efx.h>
 
 #ifdef _MSC_VER
 #pragma warning(pop)
@@ -33,7 +34,9 @@ namespace myro
             return false;
         }
 
-        ALCcontext* context = alcCreateContext(s_data.audio_device, nullptr);
+        // The default of two sends is too few once sources feed effect buses.
+        const ALCint attributes[] = { ALC_MAX_AUXILIARY_SENDS, 4, 0 };
+        ALCcontext* context = alcCreateContext(s_data.audio_device, attributes);
         if (context == nullptr || alcMakeContextCurrent(context) == ALC_FALSE)
         {
             if (context != nullptr)
@@ -82,5 +85,13 @@ namespace myro
     {
         return s_data.audio_device;
     }
+
+    int openal_backend::get_max_auxiliary_sends()
+    {
+        ALCint sends = 0;
+        if (s_data.audio_device)
+            alcGetIntegerv(s_data.audio_device, ALC_MAX_AUXILIARY_SENDS, 1, &sends);
+        return sends;
+    }
 }
 
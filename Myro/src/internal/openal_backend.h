@@ -24,5 +24,6 @@ namespace myro
 
 		static ALenum get_openAL_format(uint32_t channels, uint32_t bits_per_sample = 16);
 		static ALCdevice* get_device();
+		static int get_max_auxiliary_sends();
 	};
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace myro
+{
+	// Cuts an arbitrary stream of interleaved samples into fixed size codec frames.
+	// Whole frames are handed to emit(const T*) straight from the caller's buffer; only the
+	// remainder that straddles two write() calls is staged, so nothing is ever shifted.
+	template <class T>
+		requires std::is_trivially_copyable_v<T>
+	class packetizer
+	{
+	public:
+		void reset(size_t samples_per_packet)
+		{
+			m_staging.assign(samples_per_packet, T{});
+			m_fill = 0;
+		}
+
+		[[nodiscard]] size_t packet_size() const { return m_staging.size(); }
+		[[nodiscard]] size_t pending() const { return m_fill; }
+
+		template <class Emit>
+		void push(const T* samples, size_t count, Emit&& emit)
+		{
+			const size_t packet = m_staging.size();
+			if (packet == 0)
+				return;
+
+			if (m_fill > 0)
+			{
+				const size_t take = std::min(count, packet - m_fill);
+				std::memcpy(m_staging.data() + m_fill, samples, take * sizeof(T));
+				m_fill += take;
+				samples += take;
+				count -= take;
+
+				if (m_fill < packet)
+					return;
+
+				emit(static_cast<const T*>(m_staging.data()));
+				m_fill = 0;
+			}
+
+			for (; count >= packet; samples += packet, count -= packet)
+				emit(samples);
+
+			if (count > 0)
+			{
+				std::memcpy(m_staging.data(), samples, count * sizeof(T));
+				m_fill = count;
+			}
+		}
+
+		// Hands the staged remainder to emit(const T*, size_t count) as is, without padding.
+		template <class Emit>
+		void drain(Emit&& emit)
+		{
+			if (m_fill == 0)
+				return;
+
+			const size_t count = m_fill;
+			m_fill = 0;
+			emit(static_cast<const T*>(m_staging.data()), count);
+		}
+
+		// Pads the staged remainder with silence and emits it. Returns false if nothing was pending.
+		template <class Emit>
+		bool flush(Emit&& emit)
+		{
+			if (m_fill == 0)
+				return false;
+
+			std::fill(m_staging.begin() + static_cast<std::ptrdiff_t>(m_fill), m_staging.end(), T{});
+			m_fill = 0;
+			emit(static_cast<const T*>(m_staging.data()));
+			return true;
+		}
+	private:
+		std::vector<T> m_staging;
+		size_t m_fill = 0;
+	};
+}
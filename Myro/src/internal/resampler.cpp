@@ -0,0 +1,172 @@
+#include "resampler.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <numeric>
+
+namespace myro
+{
+	namespace
+	{
+		constexpr uint32_t max_phases = 1024;
+		constexpr double stopband_db = 96.0;
+
+		// Zeroth order modified Bessel function of the first kind, for the Kaiser window.
+		double bessel_i0(double x)
+		{
+			double sum = 1.0;
+			double term = 1.0;
+			for (int k = 1; k < 64 && term > sum * 1e-12; ++k)
+			{
+				const double half = x / (2.0 * k);
+				term *= half * half;
+				sum += term;
+			}
+			return sum;
+		}
+	}
+
+	bool sinc_resampler::init(uint32_t in_rate, uint32_t out_rate, uint16_t channels, uint32_t taps)
+	{
+		if (in_rate == 0 || out_rate == 0 || channels == 0 || taps == 0)
+			return false;
+
+		const uint32_t divisor = std::gcd(in_rate, out_rate);
+		m_up = out_rate / divisor;
+		m_down = in_rate / divisor;
+		m_phases = std::min(m_up, max_phases);
+		m_channels = channels;
+
+		// Downsampling moves the cutoff below the output Nyquist; more taps keep the transition band as steep.
+		const double ratio = std::min(1.0, static_cast<double>(m_up) / m_down);
+		m_taps = static_cast<size_t>(std::ceil(taps / ratio));
+		m_taps = std::max<size_t>((m_taps + 7) & ~static_cast<size_t>(7), 8);
+
+		// Kaiser design: the stopband starts at the lower Nyquist, in cycles per input sample.
+		const double beta = 0.1102 * (stopband_db - 8.7);
+		const double transition = (stopband_db - 7.95) / (14.36 * static_cast<double>(m_taps - 1));
+		const double cutoff = std::max(0.5 * ratio - transition / 2.0, 0.05 * ratio);
+		const double half = static_cast<double>(m_taps) / 2.0;
+		const double window_scale = 1.0 / bessel_i0(beta);
+
+		m_filters.resize((m_phases + 1) * m_taps);
+		std::vector<double> kernel(m_taps);
+		for (uint32_t p = 0; p <= m_phases; ++p)
+		{
+			const double fraction = static_cast<double>(p) / m_phases;
+			double sum = 0.0;
+			for (size_t k = 0; k < m_taps; ++k)
+			{
+				// Distance from tap k to the output's position between input frames half - 1 and half.
+				const double d = static_cast<double>(k) - (half - 1.0) - fraction;
+				const double x = 2.0 * cutoff * d;
+				const double sinc = x == 0.0 ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+				const double edge = d / half;
+				const double window = edge * edge < 1.0 ? bessel_i0(beta * std::sqrt(1.0 - edge * edge)) * window_scale : 0.0;
+				kernel[k] = sinc * window;
+				sum += kernel[k];
+			}
+			// Unity gain at DC for every phase, or the phases would modulate a constant signal.
+			float* filter = m_filters.data() + p * m_taps;
+			for (size_t k = 0; k < m_taps; ++k)
+				filter[k] = static_cast<float>(kernel[k] / sum);
+		}
+
+		m_history.assign(m_channels, {});
+		reset();
+		return true;
+	}
+
+	void sinc_resampler::reset()
+	{
+		// Frame 0 sits at the window's centre, so the first output needs no look behind.
+		m_fill = m_taps / 2 - 1;
+		for (auto& history : m_history)
+			history.assign(m_fill, 0.0f);
+		m_start = 0;
+		m_fraction = 0;
+	}
+
+	size_t sinc_resampler::max_output_frames(size_t frame_count) const
+	{
+		const size_t fill = m_fill + frame_count;
+		if (fill < m_start + m_taps)
+			return 0;
+		// Outputs j = 0.. while the window start floor((m_fraction + j * M) / L) stays <= fill - taps - m_start.
+		const uint64_t last_start = fill - m_taps - m_start;
+		return static_cast<size_t>(((last_start + 1) * m_up - 1 - m_fraction) / m_down + 1);
+	}
+
+	size_t sinc_resampler::process(const float* in, size_t frame_count, float* out)
+	{
+		const size_t produced = max_output_frames(frame_count);
+
+		for (uint16_t c = 0; c < m_channels; ++c)
+		{
+			std::vector<float>& history = m_history[c];
+			history.resize(m_fill + frame_count);
+			for (size_t i = 0; i < frame_count; ++i)
+				history[m_fill + i] = in[i * m_channels + c];
+		}
+		m_fill += frame_count;
+
+		const bool exact = m_phases == m_up;
+		for (size_t j = 0; j < produced; ++j)
+		{
+			float* frame = out + j * m_channels;
+			if (exact)
+			{
+				const float* filter = m_filters.data() + m_fraction * m_taps;
+				for (uint16_t c = 0; c < m_channels; ++c)
+					frame[c] = simd::dot(m_history[c].data() + m_start, filter, m_taps);
+			}
+			else
+			{
+				// Between two table phases: blend their outputs rather than building a kernel per frame.
+				const uint64_t scaled = static_cast<uint64_t>(m_fraction) * m_phases;
+				const size_t phase = static_cast<size_t>(scaled / m_up);
+				const float weight = static_cast<float>(scaled % m_up) / static_cast<float>(m_up);
+				const float* lower = m_filters.data() + phase * m_taps;
+				const float* upper = lower + m_taps;
+				for (uint16_t c = 0; c < m_channels; ++c)
+				{
+					const float* window = m_history[c].data() + m_start;
+					const float a = simd::dot(window, lower, m_taps);
+					const float b = simd::dot(window, upper, m_taps);
+					frame[c] = a + (b - a) * weight;
+				}
+			}
+
+			m_fraction += m_down;
+			m_start += m_fraction / m_up;
+			m_fraction %= m_up;
+		}
+
+		// Drop what no future window reaches; what remains is under one window long.
+		const size_t consumed = std::min(m_start, m_fill);
+		for (auto& history : m_history)
+			history.erase(history.begin(), history.begin() + static_cast<std::ptrdiff_t>(consumed));
+		m_fill -= consumed;
+		m_start -= consumed;
+		return produced;
+	}
+
+	std::vector<float> sinc_resampler::resample(const float* in, size_t frame_count, uint16_t channels, uint32_t in_rate, uint32_t out_rate)
+	{
+		sinc_resampler resampler;
+		if (!resampler.init(in_rate, out_rate, channels))
+			return {};
+
+		const size_t flush = resampler.latency_frames();
+		std::vector<float> out((resampler.max_output_frames(frame_count + flush) + 1) * channels);
+		size_t produced = resampler.process(in, frame_count, out.data());
+		const std::vector<float> silence(flush * channels, 0.0f);
+		produced += resampler.process(silence.data(), flush, out.data() + produced * channels);
+
+		const size_t expected = static_cast<size_t>((static_cast<uint64_t>(frame_count) * out_rate + in_rate - 1) / in_rate);
+		out.resize(std::min(produced, expected) * channels);
+		return out;
+	}
+}
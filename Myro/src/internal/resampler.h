@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace myro
+{
+	// Polyphase windowed-sinc sample rate converter for interleaved float frames. The ratio is
+	// reduced to L/M and one Kaiser-windowed sinc is precomputed per output phase (interpolating
+	// between 1024 phases when L is larger), each applied as one SIMD dot product per channel.
+	// The cutoff sits just below the lower of the two Nyquist frequencies with about 96 dB of
+	// stopband attenuation, so downsampling does not alias. Output frame k is aligned with input
+	// time k * M / L; the converter holds back taps() / 2 input frames until the next call.
+	class sinc_resampler
+	{
+	public:
+		// taps is the filter length at unity ratio; downsampling lengthens it by the ratio to keep
+		// the transition band fixed in output terms. Returns false for a zero rate or channel count.
+		bool init(uint32_t in_rate, uint32_t out_rate, uint16_t channels, uint32_t taps = 128);
+		// Clears the signal history, keeps the filter.
+		void reset();
+
+		// Upper bound of the frames process() writes for frame_count input frames.
+		[[nodiscard]] size_t max_output_frames(size_t frame_count) const;
+		// Consumes every input frame; out needs room for max_output_frames(frame_count). Returns the frames written.
+		size_t process(const float* in, size_t frame_count, float* out);
+
+		// Input frames held back, i.e. the delay the converter adds before output can appear.
+		[[nodiscard]] size_t latency_frames() const { return m_taps / 2; }
+		[[nodiscard]] size_t taps() const { return m_taps; }
+		[[nodiscard]] uint16_t get_channels() const { return m_channels; }
+
+		// Converts a whole signal at once: the held back tail is flushed and the result is exactly
+		// ceil(frame_count * out_rate / in_rate) frames long.
+		static std::vector<float> resample(const float* in, size_t frame_count, uint16_t channels, uint32_t in_rate, uint32_t out_rate);
+	private:
+		uint32_t m_up = 1;			// L
+		uint32_t m_down = 1;		// M
+		uint32_t m_phases = 1;		// filters in the table; == L unless interpolating
+		size_t m_taps = 0;
+		uint16_t m_channels = 0;
+		std::vector<float> m_filters;	// m_phases + 1 filters of m_taps, the last one is phase 0 one frame later
+
+		std::vector<std::vector<float>> m_history;	// per channel, planar
+		size_t m_fill = 0;			// frames in each history buffer
+		size_t m_start = 0;			// first frame of the next output's window
+		uint32_t m_fraction = 0;	// position within the input frame, in 1/L
+	};
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#include <xmmintrin.h>
+	#define MYRO_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define MYRO_SIMD_NEON 1
+#endif
+
+namespace myro::simd
+{
+	// Largest |x[i]|.
+	inline float max_abs(const float* x, size_t n)
+	{
+		size_t i = 0;
+		float result = 0.0f;
+#if defined(MYRO_SIMD_SSE2)
+		const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		__m128 acc = _mm_setzero_ps();
+		for (; i + 4 <= n; i += 4)
+			acc = _mm_max_ps(acc, _mm_and_ps(_mm_loadu_ps(x + i), sign_mask));
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, acc);
+		result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#elif defined(MYRO_SIMD_NEON)
+		float32x4_t acc = vdupq_n_f32(0.0f);
+		for (; i + 4 <= n; i += 4)
+			acc = vmaxq_f32(acc, vabsq_f32(vld1q_f32(x + i)));
+		float lanes[4];
+		vst1q_f32(lanes, acc);
+		result = std::max(std::max(lanes[0], lanes[1]), std::max(lanes[2], lanes[3]));
+#endif
+		for (; i < n; ++i)
+			result = std::max(result, std::fabs(x[i]));
+		return result;
+	}
+
+	// Sum of x[i]^2.
+	inline float sum_squares(const float* x, size_t n)
+	{
+		size_t i = 0;
+		float result = 0.0f;
+#if defined(MYRO_SIMD_SSE2)
+		__m128 acc = _mm_setzero_ps();
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128 v = _mm_loadu_ps(x + i);
+			acc = _mm_add_ps(acc, _mm_mul_ps(v, v));
+		}
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, acc);
+		result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(MYRO_SIMD_NEON)
+		float32x4_t acc = vdupq_n_f32(0.0f);
+		for (; i + 4 <= n; i += 4)
+		{
+			const float32x4_t v = vld1q_f32(x + i);
+			acc = vmlaq_f32(acc, v, v);
+		}
+		float lanes[4];
+		vst1q_f32(lanes, acc);
+		result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+		for (; i < n; ++i)
+			result += x[i] * x[i];
+		return result;
+	}
+
+	// Sum of a[i] * b[i].
+	inline float dot(const float* a, const float* b, size_t n)
+	{
+		size_t i = 0;
+		float result = 0.0f;
+#if defined(MYRO_SIMD_SSE2)
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		for (; i + 8 <= n; i += 8)
+		{
+			acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+			acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+		}
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+		result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(MYRO_SIMD_NEON)
+		float32x4_t acc0 = vdupq_n_f32(0.0f);
+		float32x4_t acc1 = vdupq_n_f32(0.0f);
+		for (; i + 8 <= n; i += 8)
+		{
+			acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+			acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+		}
+		float lanes[4];
+		vst1q_f32(lanes, vaddq_f32(acc0, acc1));
+		result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+		for (; i < n; ++i)
+			result += a[i] * b[i];
+		return result;
+	}
+
+	// out[i] = a[i] * b[i]. out may alias a or b.
+	inline void multiply(const float* a, const float* b, float* out, size_t n)
+	{
+		size_t i = 0;
+#if defined(MYRO_SIMD_SSE2)
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+#elif defined(MYRO_SIMD_NEON)
+		for (; i + 4 <= n; i += 4)
+			vst1q_f32(out + i, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+#endif
+		for (; i < n; ++i)
+			out[i] = a[i] * b[i];
+	}
+
+	// out[i] = re[i]^2 + im[i]^2.
+	inline void power(const float* re, const float* im, float* out, size_t n)
+	{
+		size_t i = 0;
+#if defined(MYRO_SIMD_SSE2)
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128 r = _mm_loadu_ps(re + i);
+			const __m128 m = _mm_loadu_ps(im + i);
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m)));
+		}
+#elif defined(MYRO_SIMD_NEON)
+		for (; i + 4 <= n; i += 4)
+		{
+			const float32x4_t r = vld1q_f32(re + i);
+			const float32x4_t m = vld1q_f32(im + i);
+			vst1q_f32(out + i, vmlaq_f32(vmulq_f32(r, r), m, m));
+		}
+#endif
+		for (; i < n; ++i)
+			out[i] = re[i] * re[i] + im[i] * im[i];
+	}
+
+	// acc[i] += a[i] * b[i] over complex numbers kept as separate real and imaginary arrays.
+	inline void complex_multiply_add(const float* a_re, const float* a_im, const float* b_re, const float* b_im, float* acc_re, float* acc_im, size_t n)
+	{
+		size_t i = 0;
+#if defined(MYRO_SIMD_SSE2)
+		for (; i + 4 <= n; i += 4)
+		{
+			const __m128 ar = _mm_loadu_ps(a_re + i);
+			const __m128 ai = _mm_loadu_ps(a_im + i);
+			const __m128 br = _mm_loadu_ps(b_re + i);
+			const __m128 bi = _mm_loadu_ps(b_im + i);
+			_mm_storeu_ps(acc_re + i, _mm_add_ps(_mm_loadu_ps(acc_re + i), _mm_sub_ps(_mm_mul_ps(ar, br), _mm_mul_ps(ai, bi))));
+			_mm_storeu_ps(acc_im + i, _mm_add_ps(_mm_loadu_ps(acc_im + i), _mm_add_ps(_mm_mul_ps(ar, bi), _mm_mul_ps(ai, br))));
+		}
+#elif defined(MYRO_SIMD_NEON)
+		for (; i + 4 <= n; i += 4)
+		{
+			const float32x4_t ar = vld1q_f32(a_re + i);
+			const float32x4_t ai = vld1q_f32(a_im + i);
+			const float32x4_t br = vld1q_f32(b_re + i);
+			const float32x4_t bi = vld1q_f32(b_im + i);
+			vst1q_f32(acc_re + i, vmlsq_f32(vmlaq_f32(vld1q_f32(acc_re + i), ar, br), ai, bi));
+			vst1q_f32(acc_im + i, vmlaq_f32(vmlaq_f32(vld1q_f32(acc_im + i), ar, bi), ai, br));
+		}
+#endif
+		for (; i < n; ++i)
+		{
+			acc_re[i] += a_re[i] * b_re[i] - a_im[i] * b_im[i];
+			acc_im[i] += a_re[i] * b_im[i] + a_im[i] * b_re[i];
+		}
+	}
+
+	// out[i] += in[i]
+	inline void add(const float* in, float* out, size_t n)
+	{
+		size_t i = 0;
+#if defined(MYRO_SIMD_SSE2)
+		for (; i + 4 <= n; i += 4)
+			_mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_loadu_ps(in + i)));
+#elif defined(MYRO_SIMD_NEON)
+		for (; i + 4 <= n; i += 4)
+			vst1q_f32(out + i, vaddq_f32(vld1q_f32(out + i), vld1q_f32(in + i)));
+#endif
+		for (; i < n; ++i)
+			out[i] += in[i];
+	}
+
+	// out[i] = in[i] / 32768.
+	inline void short_to_float(const int16_t* in, float* out, size_t n)
+	{
+		constexpr float scale = 1.0f / 32768.0f;
+		size_t i = 0;
+#if defined(MYRO_SIMD_SSE2)
+		const __m128 s = _mm_set1_ps(scale);
+		for (; i + 8 <= n; i += 8)
+		{
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+			const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+			_mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+		}
+#elif defined(MYRO_SIMD_NEON)
+		for (; i + 8 <= n; i += 8)
+		{
+			const int16x8_t v = vld1q_s16(in + i);
+			vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+			vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+		}
+#endif
+		for (; i < n; ++i)
+			out[i] = static_cast<float>(in[i]) * scale;
+	}
+
+	// out[i] = in[i] * 32768, rounded and saturated to 16 bits.
+	inline void float_to_short(const float* in, int16_t* out, size_t n)
+	{
+		size_t i = 0;
+#if defined(MYRO_SIMD_SSE2)
+		const __m128 s = _mm_set1_ps(32768.0f);
+		for (; i + 8 <= n; i += 8)
+		{
+			const __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), s));
+			const __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i + 4), s));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(lo, hi));
+		}
+#elif defined(MYRO_SIMD_NEON)
+		for (; i + 8 <= n; i += 8)
+		{
+			const int32x4_t lo = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(in + i), 32768.0f));
+			const int32x4_t hi = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(in + i + 4), 32768.0f));
+			vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+		}
+#endif
+		for (; i < n; ++i)
+			out[i] = static_cast<int16_t>(std::clamp(std::lrint(in[i] * 32768.0f), -32768L, 32767L));
+	}
+
+	// Flushes denormals to zero on the calling thread; decaying filter state otherwise slows to a crawl.
+	inline void flush_denormals()
+	{
+#if defined(MYRO_SIMD_SSE2)
+		_mm_setcsr(_mm_getcsr() | 0x8040);	// FTZ | DAZ
+#endif
+	}
+}
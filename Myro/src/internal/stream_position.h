@@ -0,0 +1,92 @@
+#pragma once
+
+#include "core/ring_buffer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace myro
+{
+	// Frame counts shared by a render worker and the OpenAL callback that plays its ring. All three
+	// only grow; frames written before the stale mark are skipped by the reader instead of played.
+	// Any thread may ask the writer to restart from another frame; the reader plays silence until
+	// the writer has marked the old frames stale and rendered from there.
+	struct stream_position
+	{
+		std::atomic<uint64_t> written{ 0 };
+		std::atomic<uint64_t> read{ 0 };
+		std::atomic<uint64_t> stale{ 0 };
+
+		std::atomic<uint64_t> restart_frame{ 0 };
+		std::atomic<uint64_t> restarts_requested{ 0 };
+		std::atomic<uint64_t> restarts_done{ 0 };
+
+		void reset()
+		{
+			written.store(0, std::memory_order_relaxed);
+			read.store(0, std::memory_order_relaxed);
+			stale.store(0, std::memory_order_relaxed);
+			restarts_done.store(restarts_requested.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		// Any thread. The newest request wins when several arrive before the writer looks.
+		void request_restart(uint64_t frame)
+		{
+			restart_frame.store(frame, std::memory_order_relaxed);
+			restarts_requested.fetch_add(1, std::memory_order_release);
+		}
+
+		// Writer side: the frame to restart from, and the request to pass to finish_restart.
+		[[nodiscard]] bool restart_pending(uint64_t& frame, uint64_t& request) const
+		{
+			request = restarts_requested.load(std::memory_order_acquire);
+			frame = restart_frame.load(std::memory_order_relaxed);
+			return request != restarts_done.load(std::memory_order_relaxed);
+		}
+
+		// Writer side, once the old frames are stale and the new ones are written.
+		void finish_restart(uint64_t request)
+		{
+			restarts_done.store(request, std::memory_order_release);
+		}
+
+		// Reader side: the ring still holds the old position; play silence rather than that.
+		[[nodiscard]] bool restarting() const
+		{
+			return restarts_done.load(std::memory_order_acquire) != restarts_requested.load(std::memory_order_acquire);
+		}
+
+		// Writer side: everything written so far is dropped, e.g. on a rewind.
+		void mark_stale()
+		{
+			stale.store(written.load(std::memory_order_relaxed), std::memory_order_release);
+		}
+
+		// Writer side: frames rendered and not yet played or skipped. A reader that is ahead of the
+		// writer reads as an empty queue, with the gap in shortfall, rather than wrapping around.
+		[[nodiscard]] uint64_t pending(uint64_t& shortfall) const
+		{
+			const uint64_t produced = written.load(std::memory_order_relaxed);
+			const uint64_t consumed = std::max(read.load(std::memory_order_acquire), stale.load(std::memory_order_relaxed));
+			shortfall = consumed > produced ? consumed - produced : 0;
+			return produced - std::min(consumed, produced);
+		}
+
+		// Reader side: drops the stale frames at the front of ring, then reads up to wanted frames.
+		// caught_up is false while stale frames the writer has yet to push are still owed.
+		template <class T>
+		size_t read_frames(spsc_ring_buffer<T>& ring, T* out, size_t wanted, uint16_t channels, bool& caught_up)
+		{
+			uint64_t position = read.load(std::memory_order_relaxed);
+			const uint64_t mark = stale.load(std::memory_order_acquire);
+			if (position < mark)
+				position += ring.skip(std::min<uint64_t>(mark - position, ring.size() / channels) * channels) / channels;
+
+			caught_up = position >= mark;
+			const size_t produced = caught_up ? ring.read(out, std::min(ring.size() / channels, wanted) * channels) / channels : 0;
+			read.store(position + produced, std::memory_order_release);
+			return produced;
+		}
+	};
+}
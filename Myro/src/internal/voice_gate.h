@@ -0,0 +1,130 @@
+#pragma once
+
+#include "audio/audio_capture.h"
+#include "packetizer.h"
+
+#include <cmath>
+#include <vector>
+
+namespace myro
+{
+	// Energy gate in front of an encoder. The stream is judged in fixed blocks; a block whose RMS
+	// reaches the threshold opens the gate, and it stays open for the hangover afterwards. While
+	// closed, the most recent pre-roll blocks are held back so the onset of speech is not clipped.
+	// Every input frame leaves through exactly one of on_audio(const short*, frames) or
+	// on_gap(frames), in order, so the timeline is preserved with a delay of at most the pre-roll.
+	class voice_gate
+	{
+	public:
+		void configure(const voice_gate_options& options, uint32_t sample_rate, uint16_t channels)
+		{
+			m_channels = channels;
+			m_block_frames = std::max<size_t>(static_cast<size_t>(sample_rate) * std::max(options.block_ms, 1u) / 1000, 1);
+			m_blocks.reset(m_block_frames * channels);
+
+			const double threshold = std::pow(10.0, static_cast<double>(options.threshold_db) / 20.0) * 32768.0;
+			m_threshold_sum = threshold * threshold * static_cast<double>(m_block_frames * channels);
+
+			m_hangover_blocks = (options.hangover_ms + std::max(options.block_ms, 1u) - 1) / std::max(options.block_ms, 1u);
+			m_pre_roll_blocks = (options.pre_roll_ms + std::max(options.block_ms, 1u) - 1) / std::max(options.block_ms, 1u);
+			m_pre_roll.assign(static_cast<size_t>(m_pre_roll_blocks) * m_blocks.packet_size(), 0);
+			m_pre_roll_head = 0;
+			m_pre_roll_count = 0;
+			m_hangover_left = 0;
+			m_open = false;
+		}
+
+		[[nodiscard]] bool is_open() const { return m_open; }
+
+		template <class Audio, class Gap>
+		void process(const short* samples, size_t frame_count, Audio&& on_audio, Gap&& on_gap)
+		{
+			m_blocks.push(samples, frame_count * m_channels, [&](const short* block) { process_block(block, on_audio, on_gap); });
+		}
+
+		// Releases everything held back: the pre-roll was silence, the partial block follows the gate state.
+		template <class Audio, class Gap>
+		void flush(Audio&& on_audio, Gap&& on_gap)
+		{
+			for (; m_pre_roll_count > 0; --m_pre_roll_count)
+				on_gap(m_block_frames);
+
+			m_blocks.drain([&](const short* samples, size_t count)
+			{
+				if (m_open)
+					on_audio(samples, count / m_channels);
+				else
+					on_gap(count / m_channels);
+			});
+		}
+	private:
+		template <class Audio, class Gap>
+		void process_block(const short* block, Audio& on_audio, Gap& on_gap)
+		{
+			double sum = 0.0;
+			for (size_t i = 0, n = m_blocks.packet_size(); i < n; ++i)
+				sum += static_cast<double>(block[i]) * block[i];
+
+			if (sum >= m_threshold_sum)
+			{
+				if (!m_open)
+					release_pre_roll(on_audio);
+
+				m_open = true;
+				m_hangover_left = m_hangover_blocks;
+				on_audio(block, m_block_frames);
+				return;
+			}
+
+			if (m_open && m_hangover_left > 0)
+			{
+				--m_hangover_left;
+				on_audio(block, m_block_frames);
+				return;
+			}
+
+			m_open = false;
+			if (m_pre_roll_blocks == 0)
+			{
+				on_gap(m_block_frames);
+				return;
+			}
+
+			// The oldest held block falls out of the pre-roll window and becomes a gap.
+			if (m_pre_roll_count == m_pre_roll_blocks)
+			{
+				on_gap(m_block_frames);
+				m_pre_roll_head = (m_pre_roll_head + 1) % m_pre_roll_blocks;
+				--m_pre_roll_count;
+			}
+
+			const size_t slot = (m_pre_roll_head + m_pre_roll_count) % m_pre_roll_blocks;
+			std::copy_n(block, m_blocks.packet_size(), m_pre_roll.data() + slot * m_blocks.packet_size());
+			++m_pre_roll_count;
+		}
+
+		template <class Audio>
+		void release_pre_roll(Audio& on_audio)
+		{
+			for (; m_pre_roll_count > 0; --m_pre_roll_count)
+			{
+				on_audio(static_cast<const short*>(m_pre_roll.data() + m_pre_roll_head * m_blocks.packet_size()), m_block_frames);
+				m_pre_roll_head = (m_pre_roll_head + 1) % m_pre_roll_blocks;
+			}
+		}
+	private:
+		packetizer<short> m_blocks;
+		size_t m_channels = 1;
+		size_t m_block_frames = 0;
+		double m_threshold_sum = 0.0;
+
+		uint32_t m_hangover_blocks = 0;
+		uint32_t m_hangover_left = 0;
+		bool m_open = false;
+
+		std::vector<short> m_pre_roll;
+		uint32_t m_pre_roll_blocks = 0;
+		uint32_t m_pre_roll_count = 0;
+		size_t m_pre_roll_head = 0;
+	};
+}